@@ -65,18 +65,109 @@
 #include "samb11_xplained_pro.h"
 #include "startup_template_app.h"
 
+/* The frame format, parser and CRC are the EFM32's own sources, built into
+ * this project as well, so the two ends cannot drift apart
+ */
+#include "../../repo_updated/src/link_proto.h"
+
 void configure_gpio_pins(void);
+static void configure_usart(uint32_t baud_rate);
 
 struct uart_module uart_instance;
 
 struct dma_resource uart_dma_resource_tx;
 struct dma_resource uart_dma_resource_rx;
 
+/* Payload offsets */
+#define TEMP_LED_BYTE   4
+#define STATS_MEAN_BYTE 0
+#define STATS_LED_BYTE  12
+#define BATCH_BASE_BYTE 0
+#define BATCH_HDR_LEN   4
+#define BATCH_ENTRY_LEN 5
+#define BATCH_DT_BYTE   0
+#define BATCH_TEMP_BYTE 2
+#define BATCH_FLAG_BYTE 4
+#define BATCH_FLAG_LED  0x02
+
+/* Readings waiting for an HTP notification; a power of two, room for
+ * two full batches, since a resend can deliver two frames back to back
+ */
+#define READING_QUEUE_LEN 32
+
+struct efm32_reading {
+	bool timed;         /* time_ms is valid: the reading came in a batch */
+	uint32_t time_ms;   /* since the EFM32 booted */
+	float temp_C;
+};
+
+#if READING_QUEUE_LEN < (2 * LINK_BATCH_MAX)
+#error "READING_QUEUE_LEN must hold two full batches"
+#endif
+
+/* The UART RX DMA hands over one byte at a time */
+#define RX_DMA_LEN    1
 #define BUFFER_LEN    5
-#define LED_STATUS_BYTE 4
 #define BAUD_RATE 9600
+
+/* Link rates by index, as on the EFM32 (leuart_rate). The low one is
+ * the idle rate; the EFM32 asks for a higher one for bulk transfers.
+ */
+#define LINK_RATES      3
+#define LINK_RATE_LOW   0
+#define LINK_RATE_LIST  {BAUD_RATE, 57600, 115200}
+
+/* Timer ticks without a good frame before a higher rate falls back to
+ * BAUD_RATE on its own, in case the EFM32 missed an ack.
+ */
+#define LINK_RATE_IDLE_TICKS 3
+
+/* link_rate_pending when no rate change is waiting for the main loop */
+#define LINK_RATE_NONE  0xFF
+
+/* Spin long enough for the last character to leave the shift register */
+#define UART_DRAIN_SPIN 10000
+
+/* Command frames to the EFM32 (leuart.h on that side): start frame,
+ * command, 14 bit value as two 7 bit bytes (low first), signal frame.
+ */
+#define EFM32_CMD_START_FRAME   0xF0
+#define EFM32_CMD_SIG_FRAME     0xF1
+#define EFM32_CMD_FRAME_LEN     5
+#define EFM32_CMD_VALUE_MAX     0x3FFF
+#define EFM32_CMD_SAMPLE_PERIOD 0x01  /* value: period in 10 ms units */
+#define EFM32_CMD_OVERSAMPLE    0x02  /* value: conversions per reading */
+#define EFM32_CMD_SENSORS       0x03  /* value: sensor enable mask */
+#define EFM32_CMD_LINK_RATE     0x04  /* value: rate index, the ack of a
+                                       * LINK_MSG_RATE request */
+#define EFM32_CMD_BATCH_K       0x05  /* value: readings per batch */
 static uint8_t string_tx[BUFFER_LEN] = {0};
-static uint8_t string_rx[BUFFER_LEN] = {0};
+static uint8_t string_rx[RX_DMA_LEN] = {0};
+
+/* Frame and error counts are in link_rx.count */
+static link_parser link_rx;
+
+static const uint32_t link_rate_baud[LINK_RATES] = LINK_RATE_LIST;
+static volatile uint8_t link_rate = LINK_RATE_LOW;
+static volatile uint8_t link_idle_ticks = 0;
+
+/* Rate change asked for from interrupt context, made by the main loop;
+ * link_rate_ack when it is the EFM32's request and wants the ack
+ */
+static volatile uint8_t link_rate_pending = LINK_RATE_NONE;
+static volatile bool link_rate_ack = false;
+
+/* Filled by the UART RX callback, drained in order by the main loop */
+static struct efm32_reading reading_queue[READING_QUEUE_LEN];
+static volatile uint8_t reading_head = 0;
+static volatile uint8_t reading_tail = 0;
+volatile uint32_t readings_dropped = 0;
+
+/* A notification is out and its AT_BLE_HTPT_TEMP_SEND_CFM not in yet;
+ * the reading stays queued until it is confirmed
+ */
+static bool htp_send_busy = false;
+volatile uint32_t htp_send_errors = 0;
 	
 struct dma_descriptor example_descriptor_tx;
 struct dma_descriptor example_descriptor_rx;
@@ -86,6 +177,33 @@ at_ble_handle_t htpt_conn_handle;
 volatile bool Timer_Flag = false;
 volatile bool Temp_Notification_Flag = false;
 
+/* Function: void efm32_send_command(uint8_t cmd, uint16_t value)
+ * Parameters:
+ *      uint8_t cmd: one of the EFM32_CMD_* commands
+ *      uint16_t value: its argument, at most EFM32_CMD_VALUE_MAX
+ * Return:
+ *      void
+ * Description:
+ *    - Send one command frame to the EFM32. Its receiver wakes the core
+ *      only once the signal frame is in, so this costs it one interrupt.
+ */
+static void efm32_send_command(uint8_t cmd, uint16_t value)
+{
+	uint8_t frame[EFM32_CMD_FRAME_LEN];
+
+	if(value > EFM32_CMD_VALUE_MAX) {
+		value = EFM32_CMD_VALUE_MAX;
+	}
+
+	frame[0] = EFM32_CMD_START_FRAME;
+	frame[1] = cmd & 0x7F;
+	frame[2] = value & 0x7F;
+	frame[3] = (value >> 7) & 0x7F;
+	frame[4] = EFM32_CMD_SIG_FRAME;
+
+	uart_write_buffer_wait(&uart_instance, frame, EFM32_CMD_FRAME_LEN);
+}
+
 /* Function: void transfer_done_tx(struct dma_resource* const resource )
  * Parameters:
  *      struct dma_resource: a structure of type dma_resource
@@ -101,31 +219,228 @@ static void transfer_done_tx(struct dma_resource* const resource )
 	dma_start_transfer_job(&uart_dma_resource_rx);
 }
 
-/* Function: void transfer_done_rx(struct dma_resource* const resource )
+/* Function: void link_set_rate(uint8_t rate)
  * Parameters:
- *      struct dma_resource: a structure of type dma_resource
+ *      uint8_t rate: index into link_rate_baud
  * Return:
- *      void
+ *      static void
  * Description:
- *    - This is a callback function that will reset the dma call
- *      and make sure that it is ready to recive the next set of 
- *      data bytes on the rx.
- *    - This will also handle the toggling of the LEDs based on 
- *      data reception.
+ *    - Main loop only. Let the UART finish what it is sending, then
+ *      re-initialize it at the new rate and re-arm the RX DMA on it.
  */
-static void transfer_done_rx(struct dma_resource* const resource )
+static void link_set_rate(uint8_t rate)
 {
-	/* Start parsing the data here! */
+	while (!(uart_instance.hw->TRANSMIT_STATUS.reg & UART_TRANSMIT_STATUS_TX_FIFO_EMPTY));
+	for (volatile uint32_t i = 0; i < UART_DRAIN_SPIN; i++);
+
+	configure_usart(link_rate_baud[rate]);
+	link_rate = rate;
+	link_idle_ticks = 0;
+
+	/* Still armed if the change came from the timer, BUSY is fine then */
 	dma_start_transfer_job(&uart_dma_resource_rx);
-	
-	if(string_rx[LED_STATUS_BYTE] == 1) {
+}
+
+/* Function: void link_rate_request(uint8_t rate, bool ack)
+ * Parameters:
+ *      uint8_t rate: index into link_rate_baud
+ *      bool ack: the EFM32 asked for it and waits for the ack
+ * Return:
+ *      static void
+ * Description:
+ *    - Interrupt context. Leave the change to link_rate_poll() and wake
+ *      the main loop out of ble_event_task() for it. A change the EFM32
+ *      asked for replaces an idle fall back that is still waiting.
+ */
+static void link_rate_request(uint8_t rate, bool ack)
+{
+	if(ack == false && link_rate_pending != LINK_RATE_NONE) {
+		return;
+	}
+
+	link_rate_ack = ack;
+	link_rate_pending = rate;
+	send_plf_int_msg_ind(USER_TIMER_CALLBACK, TIMER_EXPIRED_CALLBACK_TYPE_DETECT, NULL, 0);
+}
+
+/* Function: void link_rate_poll(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      static void
+ * Description:
+ *    - Main loop. Ack at the old rate if the EFM32 asked, then follow it.
+ */
+static void link_rate_poll(void)
+{
+	uint8_t rate;
+	bool ack;
+
+	__disable_irq();
+	rate = link_rate_pending;
+	ack = link_rate_ack;
+	link_rate_pending = LINK_RATE_NONE;
+	__enable_irq();
+
+	if(rate == LINK_RATE_NONE) {
+		return;
+	}
+
+	if(ack) {
+		efm32_send_command(EFM32_CMD_LINK_RATE, rate);
+	}
+	link_set_rate(rate);
+}
+
+/* Function: void reading_push(bool timed, uint32_t time_ms, float temp_C)
+ * Parameters:
+ *      the reading, see struct efm32_reading
+ * Return:
+ *      static void
+ * Description:
+ *    - Producer side, UART RX callback only. A full queue drops the new
+ *      reading and counts it.
+ */
+static void reading_push(bool timed, uint32_t time_ms, float temp_C)
+{
+	struct efm32_reading *slot;
+
+	if((uint8_t)(reading_head - reading_tail) >= READING_QUEUE_LEN) {
+		readings_dropped++;
+		return;
+	}
+
+	slot = &reading_queue[reading_head & (READING_QUEUE_LEN - 1)];
+	slot->timed = timed;
+	slot->time_ms = time_ms;
+	slot->temp_C = temp_C;
+	reading_head++;
+}
+
+/* Function: bool reading_peek(struct efm32_reading *reading)
+ * Parameters:
+ *      struct efm32_reading *: where the oldest reading goes
+ * Return:
+ *      bool: false if the queue is empty
+ * Description:
+ *    - Consumer side, main loop only. The reading stays queued until
+ *      reading_release().
+ */
+static bool reading_peek(struct efm32_reading *reading)
+{
+	if(reading_head == reading_tail) {
+		return false;
+	}
+
+	*reading = reading_queue[reading_tail & (READING_QUEUE_LEN - 1)];
+	return true;
+}
+
+/* Function: void reading_release(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      static void
+ * Description:
+ *    - Consumer side, main loop only. Drop the oldest reading.
+ */
+static void reading_release(void)
+{
+	if(reading_head != reading_tail) {
+		reading_tail++;
+	}
+}
+
+/* Function: void link_handle_frame(const link_frame *frame)
+ * Parameters:
+ *      const link_frame *frame: a frame that just passed the CRC
+ * Return:
+ *      static void
+ * Description:
+ *    - Queue the readings for the HTP notifications, oldest first, and
+ *      follow the LED status of the EFM32's latest reading.
+ */
+static void link_handle_frame(const link_frame *frame)
+{
+	const uint8_t *payload = frame->payload;
+	const uint8_t *entry;
+	uint8_t led_status;
+	uint8_t count;
+	uint8_t i;
+	uint32_t base_ms;
+	uint16_t dt_10ms;
+	int16_t temp_cC;
+	float temp_C;
+
+	link_idle_ticks = 0;
+
+	if(frame->type == LINK_MSG_RATE) {
+		/* The EFM32 holds TX until the ack, so the main loop has time */
+		if(payload[0] < LINK_RATES) {
+			link_rate_request(payload[0], true);
+		}
+		return;
+	}
+
+	if(frame->type == LINK_MSG_BATCH) {
+		if(frame->len < BATCH_HDR_LEN + BATCH_ENTRY_LEN) {
+			return;
+		}
+		count = (frame->len - BATCH_HDR_LEN) / BATCH_ENTRY_LEN;
+		memcpy(&base_ms, &payload[BATCH_BASE_BYTE], sizeof(base_ms));
+		for(i = 0; i < count; i++) {
+			entry = &payload[BATCH_HDR_LEN + i * BATCH_ENTRY_LEN];
+			memcpy(&dt_10ms, &entry[BATCH_DT_BYTE], sizeof(dt_10ms));
+			memcpy(&temp_cC, &entry[BATCH_TEMP_BYTE], sizeof(temp_cC));
+			reading_push(true, base_ms + dt_10ms * 10, temp_cC / 100.0f);
+		}
+		led_status = (entry[BATCH_FLAG_BYTE] & BATCH_FLAG_LED) ? 1 : 0;
+	} else if(frame->type == LINK_MSG_STATS_SUMMARY) {
+		memcpy(&temp_cC, &payload[STATS_MEAN_BYTE], sizeof(temp_cC));
+		reading_push(false, 0, temp_cC / 100.0f);
+		led_status = payload[STATS_LED_BYTE];
+	} else {
+		memcpy(&temp_C, payload, sizeof(temp_C));
+		reading_push(false, 0, temp_C);
+		led_status = payload[TEMP_LED_BYTE];
+	}
+
+	if(led_status == 1) {
 		/* Toggle the LED to 0 */
 		GPIO1->DATAOUT.reg |= (1 << (LED_0_PIN % 16)); // Turn OFF
-		} else {
+	} else {
 		/* Let the LED be ON */
 		GPIO1->DATAOUT.reg &= ~(1 << (LED_0_PIN % 16)); // Turn ON
 	}
 }
+
+/* Function: void transfer_done_rx(struct dma_resource* const resource )
+ * Parameters:
+ *      struct dma_resource: a structure of type dma_resource
+ * Return:
+ *      void
+ * Description:
+ *    - This is a callback function that will reset the dma call
+ *      and make sure that it is ready to recive the next byte on
+ *      the rx.
+ *    - Every byte goes through the link parser; a complete frame
+ *      updates the temperature and the LED.
+ *    - After a rate request the job is left for link_set_rate() to
+ *      re-arm, once the UART runs at the new rate.
+ */
+static void transfer_done_rx(struct dma_resource* const resource )
+{
+	uint8_t byte = string_rx[0];
+	link_frame frame;
+
+	if(Link_Parse_Byte(&link_rx, byte, &frame)) {
+		link_handle_frame(&frame);
+	}
+
+	if(link_rate_pending == LINK_RATE_NONE || link_rate_ack == false) {
+		dma_start_transfer_job(&uart_dma_resource_rx);
+	}
+}
 	
 /* Function: void configure_dma_resource_tx(struct dma_resource *resource)
  * Parameters:
@@ -200,27 +515,27 @@ static void setup_transfer_descriptor_rx(struct dma_descriptor *descriptor)
 {
 	dma_descriptor_get_config_defaults(descriptor);
 
-	descriptor->buffer_size = BUFFER_LEN;
+	descriptor->buffer_size = RX_DMA_LEN;
 	descriptor->read_start_addr =
 	(uint32_t)(&uart_instance.hw->RECEIVE_DATA.reg);
 	descriptor->write_start_addr = (uint32_t)string_rx;
 }
 
-/* Function: void configure_usart(void)
+/* Function: void configure_usart(uint32_t baud_rate)
  * Parameters:
- *        void
+ *        uint32_t baud_rate: the link rate
  * Return:
  *      static void
  * Description:
  *      - Do the basic configuration for the usart.
  */
-static void configure_usart(void)
+static void configure_usart(uint32_t baud_rate)
 {
 	struct uart_config config_uart;
 
 	uart_get_config_defaults(&config_uart);
 
-	config_uart.baud_rate = BAUD_RATE;
+	config_uart.baud_rate = baud_rate;
 	config_uart.pin_number_pad[0] = EDBG_CDC_SERCOM_PIN_PAD0;
 	config_uart.pin_number_pad[1] = EDBG_CDC_SERCOM_PIN_PAD1;
 	config_uart.pin_number_pad[2] = EDBG_CDC_SERCOM_PIN_PAD2;
@@ -339,6 +654,8 @@ static at_ble_status_t ble_paired_cb (void *param)
 static at_ble_status_t ble_disconnected_cb (void *param)
 {
 	printf("\nAssignment 3.2: Application disconnected "); 
+	/* The confirmation of a notification in flight will not come */
+	htp_send_busy = false;
 	ble_advertise();
 	ALL_UNUSED(param);
 	return AT_BLE_SUCCESS;
@@ -392,17 +709,24 @@ static void timer_callback_handler(void)
 	hw_timer_stop();
 	/* Set timer Alarm flag */
 	Timer_Flag = true;
+	/* Nothing from the EFM32 for a while at a bulk rate: back to idle */
+	if(link_rate != LINK_RATE_LOW && ++link_idle_ticks > LINK_RATE_IDLE_TICKS) {
+		link_rate_request(LINK_RATE_LOW, false);
+	}
 	/* Restart Timer */
 	hw_timer_start(10);
 }
 
 
-/* Sending the temperature value after reading it from IO1 Xplained Pro */
-static void htp_temperature_send(void)
+/* Sending the temperature value after reading it from IO1 Xplained Pro.
+ * Returns false if the stack did not take the notification.
+ */
+static bool htp_temperature_send(const struct efm32_reading *reading)
 {
 	at_ble_prf_date_time_t timestamp;
-	float *temp; 
-	temp = &string_rx;
+	float value = reading->temp_C;
+	float *temp = &value;
+	uint32_t secs = reading->time_ms / 1000;
 	#ifdef HTPT_FAHRENHEIT
 	temperature = (((temperature * 9.0)/5.0) + 32.0);
 	#endif
@@ -413,8 +737,15 @@ static void htp_temperature_send(void)
 	timestamp.month = 8;
 	timestamp.sec = 36;
 	timestamp.year = 15;
+	if(reading->timed) {
+		/* Time since the EFM32 booted, counting from day 1 */
+		timestamp.day = 1 + secs / 86400;
+		timestamp.hour = (secs / 3600) % 24;
+		timestamp.min = (secs / 60) % 60;
+		timestamp.sec = secs % 60;
+	}
 	/* Read Temperature Value from IO1 Xplained Pro */
-	if(at_ble_htpt_temp_send(convert_ieee754_ieee11073_float((float)*temp),
+	status = at_ble_htpt_temp_send(convert_ieee754_ieee11073_float((float)*temp),
 	&timestamp,
 	#ifdef HTPT_FAHRENHEIT
 	(at_ble_htpt_temp_flags)(HTPT_FLAG_FAHRENHEIT | HTPT_FLAG_TYPE),
@@ -423,8 +754,28 @@ static void htp_temperature_send(void)
 	#endif
 	HTP_TYPE_ARMPIT,
 	1
-	) == AT_BLE_SUCCESS) {
-  }
+	);
+	if(status != AT_BLE_SUCCESS) {
+		htp_send_errors++;
+		return false;
+	}
+	return true;
+}
+
+/* The stack is done with the last notification: the next one can go.
+ * One that failed keeps its reading queued and goes again.
+ */
+static at_ble_status_t app_htpt_temp_send_cfm_handler(void *params)
+{
+	at_ble_htpt_temp_send_cfm_t *cfm_params = params;
+
+	htp_send_busy = false;
+	if(cfm_params->status == AT_BLE_SUCCESS) {
+		reading_release();
+	} else {
+		htp_send_errors++;
+	}
+	return AT_BLE_SUCCESS;
 }
 
 
@@ -440,17 +791,33 @@ static at_ble_status_t app_htpt_cfg_indntf_ind_handler(void *params)
 	else {
 		printf("HTP Temperature Notification Stopped");
 		Temp_Notification_Flag = false;
+		htp_send_busy = false;
 	}
 	return AT_BLE_SUCCESS;
 }
 
 
+/* The collector changed the measurement interval (in seconds): have
+ * the EFM32 sample at that period.
+ */
+static at_ble_status_t app_htpt_meas_intv_chg_handler(void *params)
+{
+	at_ble_htpt_meas_intv_chg_ind_t *intv_params = params;
+	uint32_t period_10ms = (uint32_t)intv_params->intv * 100;
+
+	if(period_10ms > EFM32_CMD_VALUE_MAX) {
+		period_10ms = EFM32_CMD_VALUE_MAX;
+	}
+	efm32_send_command(EFM32_CMD_SAMPLE_PERIOD, (uint16_t)period_10ms);
+	return AT_BLE_SUCCESS;
+}
+
 static const ble_event_callback_t app_htpt_handle[] = {
 	NULL, // AT_BLE_HTPT_CREATE_DB_CFM
 	NULL, // AT_BLE_HTPT_ERROR_IND
 	NULL, // AT_BLE_HTPT_DISABLE_IND
-	NULL, // AT_BLE_HTPT_TEMP_SEND_CFM
-	NULL, // AT_BLE_HTPT_MEAS_INTV_CHG_IND
+	app_htpt_temp_send_cfm_handler, // AT_BLE_HTPT_TEMP_SEND_CFM
+	app_htpt_meas_intv_chg_handler, // AT_BLE_HTPT_MEAS_INTV_CHG_IND
 	app_htpt_cfg_indntf_ind_handler, // AT_BLE_HTPT_CFG_INDNTF_IND
 	NULL, // AT_BLE_HTPT_ENABLE_RSP
 	NULL, // AT_BLE_HTPT_MEAS_INTV_UPD_RSP
@@ -476,6 +843,8 @@ static void register_ble_callbacks (void)
 
 int main (void)
 {
+	struct efm32_reading reading;
+
 	platform_driver_init();
 	acquire_sleep_lock();
 	/* Initialize serial console */
@@ -489,7 +858,7 @@ int main (void)
 	hw_timer_init();
 	
 	/* Do the initialization for the GPIO */
-	configure_usart();
+	configure_usart(BAUD_RATE);
 
 	// Configure the GPIO pins for the LED
 	configure_gpio_pins();
@@ -520,6 +889,7 @@ int main (void)
 	/* Start Advertising process */
 	ble_advertise();
 	
+	Link_Parser_Init(&link_rx);
 	dma_start_transfer_job(&uart_dma_resource_rx);
 
 	/* Register Bluetooth events Callbacks */
@@ -527,9 +897,15 @@ int main (void)
 	
 	while(true) {
 		ble_event_task(655);
+		link_rate_poll();
 		if (Timer_Flag & Temp_Notification_Flag)
 		{
-			htp_temperature_send();
+			/* One notification per reading, in the order they were taken,
+			 * and only one in flight: the next waits for the confirmation
+			 */
+			if(htp_send_busy == false && reading_peek(&reading)) {
+				htp_send_busy = htp_temperature_send(&reading);
+			}
 		}
 	}
 }
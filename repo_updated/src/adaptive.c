@@ -0,0 +1,141 @@
+/*
+ * adaptive.c
+ *
+ *  Created on: Apr 17, 2017
+ *      Author: vidursarin
+ */
+
+#include "adaptive.h"
+
+void Adapt_Init(adapt_ctrl *ctrl)
+{
+  ctrl->conversions = ADAPT_MAX_CONVERSIONS;
+  ctrl->period_ms = ADAPT_DEFAULT_PERIOD_MS;
+  ctrl->last_temp_mC = 0;
+  ctrl->primed = false;
+
+  return;
+}
+
+void Adapt_Update(adapt_ctrl *ctrl, int32_t temp_mC, uint32_t std_dev_mC)
+{
+  uint32_t ratio = 0;
+  uint32_t conversions = 0;
+  int32_t delta = 0;
+
+  /* std/sqrt(N) <= target  =>  N >= (std/target)^2 */
+  ratio = std_dev_mC / ADAPT_TARGET_NOISE_MC;
+  conversions = (ratio + 1) * (ratio + 1);
+  if(conversions < ADAPT_MIN_CONVERSIONS) {
+    conversions = ADAPT_MIN_CONVERSIONS;
+  } else if(conversions > ADAPT_MAX_CONVERSIONS) {
+    conversions = ADAPT_MAX_CONVERSIONS;
+  }
+  ctrl->conversions = conversions;
+
+  if(ctrl->primed == false) {
+    ctrl->last_temp_mC = temp_mC;
+    ctrl->primed = true;
+    return;
+  }
+
+  delta = temp_mC - ctrl->last_temp_mC;
+  if(delta < 0) {
+    delta = -delta;
+  }
+  ctrl->last_temp_mC = temp_mC;
+
+  if(delta > ADAPT_FAST_STEP_MC) {
+    /* Things are moving: react fast and with the full burst */
+    ctrl->period_ms = ctrl->period_ms / 2;
+    ctrl->conversions = ADAPT_MAX_CONVERSIONS;
+  } else if(delta < ADAPT_STABLE_STEP_MC) {
+    ctrl->period_ms = ctrl->period_ms + (ctrl->period_ms / 4);
+  }
+
+  if(ctrl->period_ms < ADAPT_MIN_PERIOD_MS) {
+    ctrl->period_ms = ADAPT_MIN_PERIOD_MS;
+  } else if(ctrl->period_ms > ADAPT_MAX_PERIOD_MS) {
+    ctrl->period_ms = ADAPT_MAX_PERIOD_MS;
+  }
+
+  return;
+}
+
+void Adapt_Replay(const int32_t *temp_mC, const uint32_t *std_dev_mC,\
+                  uint32_t n, uint32_t trace_period_ms, adapt_replay *result)
+{
+  adapt_ctrl ctrl;
+  uint64_t now_ms = 0;
+  uint64_t end_ms = (uint64_t)n * trace_period_ms;
+  uint64_t error_sum = 0;
+  uint32_t index = 0;
+  uint32_t next = 0;
+  uint32_t covered = 0;
+  uint32_t error = 0;
+  uint32_t last_period_ms = 0;
+  int32_t held_mC = 0;
+
+  result->readings = 0;
+  result->conversions = 0;
+  result->fixed_readings = 0;
+  result->fixed_conversions = 0;
+  result->energy_permille = 0;
+  result->max_error_mC = 0;
+  result->mean_error_mC = 0;
+  result->cut_period_ms = 0;
+  result->max_period_ms = 0;
+
+  if((n == 0) || (trace_period_ms == 0)) {
+    return;
+  }
+
+  Adapt_Init(&ctrl);
+
+  while(now_ms < end_ms) {
+    /* The trace entry that covers this point in time */
+    index = now_ms / trace_period_ms;
+
+    result->conversions += ctrl.conversions;
+    result->readings++;
+
+    last_period_ms = ctrl.period_ms;
+    Adapt_Update(&ctrl, temp_mC[index], std_dev_mC[index]);
+    held_mC = temp_mC[index];
+    now_ms += ctrl.period_ms;
+
+    if((ctrl.period_ms < last_period_ms) &&\
+       ((result->cut_period_ms == 0) ||\
+        (ctrl.period_ms < result->cut_period_ms))) {
+      result->cut_period_ms = ctrl.period_ms;
+    }
+    if(ctrl.period_ms > result->max_period_ms) {
+      result->max_period_ms = ctrl.period_ms;
+    }
+
+    /* The trace entries up to the next reading only see this one */
+    next = (now_ms < end_ms) ? ((now_ms + trace_period_ms - 1)\
+                                / trace_period_ms) : n;
+    for(; covered < next; covered++) {
+      error = (temp_mC[covered] > held_mC) ? (temp_mC[covered] - held_mC)\
+                                           : (held_mC - temp_mC[covered]);
+      error_sum += error;
+      if(error > result->max_error_mC) {
+        result->max_error_mC = error;
+      }
+    }
+  }
+
+  result->mean_error_mC = error_sum / n;
+
+  result->fixed_readings = end_ms / ADAPT_DEFAULT_PERIOD_MS;
+  if(result->fixed_readings == 0) {
+    result->fixed_readings = 1;
+  }
+  result->fixed_conversions = (uint64_t)result->fixed_readings\
+                              * ADAPT_MAX_CONVERSIONS;
+  result->energy_permille = (result->conversions * 1000)\
+                            / result->fixed_conversions;
+
+  return;
+}
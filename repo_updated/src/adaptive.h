@@ -0,0 +1,104 @@
+/*
+ * adaptive.h
+ *
+ *  Created on: Apr 17, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_ADAPTIVE_H_
+#define SRC_ADAPTIVE_H_
+
+#include<stdint.h>
+#include<stdbool.h>
+
+/* Bounds on the number of conversions per burst. The upper one is the
+ * fixed burst, MAX_CONVERSION in adc.h; main.c checks they agree.
+ */
+#define ADAPT_MIN_CONVERSIONS 32
+#define ADAPT_MAX_CONVERSIONS 500
+
+/* Bounds on the sample period; 65 s is the LETIMER0 limit on ULFRCO */
+#define ADAPT_MIN_PERIOD_MS 1000
+#define ADAPT_MAX_PERIOD_MS 60000
+#define ADAPT_DEFAULT_PERIOD_MS 4250
+
+/* Noise allowed on the averaged reading (std. dev. of the mean) */
+#define ADAPT_TARGET_NOISE_MC 50
+
+/* Thresholds on the change between two readings. Above FAST the period
+ * is halved, below STABLE it grows by a quarter, in between it is kept.
+ * Going by the step rather than the slope lets the period settle where
+ * the temperature moves about FAST per reading, which bounds how far the
+ * last reading lags behind: a room swinging by a few mC/s is followed at
+ * tens of seconds, not at ADAPT_MAX_PERIOD_MS. STABLE sits above the
+ * difference of two readings at the target noise (sqrt(2) * 50 mC).
+ */
+#define ADAPT_FAST_STEP_MC 200
+#define ADAPT_STABLE_STEP_MC 100
+
+/* State of the controller */
+typedef struct adaptive_controller {
+  uint16_t conversions;   /* conversions for the next burst */
+  uint32_t period_ms;     /* time until the next reading */
+  int32_t last_temp_mC;
+  bool primed;
+} adapt_ctrl;
+
+/* Outcome of Adapt_Replay() */
+typedef struct adaptive_replay_result {
+  uint32_t readings;          /* readings the controller took */
+  uint32_t fixed_readings;    /* readings at the fixed period */
+  uint64_t conversions;       /* conversions the controller used */
+  uint64_t fixed_conversions; /* conversions at the fixed settings */
+  uint16_t energy_permille;   /* ADC energy relative to the fixed setup */
+  uint32_t max_error_mC;      /* worst lag of the last reading behind the trace */
+  uint32_t mean_error_mC;     /* and its average over the trace */
+  uint32_t cut_period_ms;     /* shortest period a cut went down to, 0: none */
+  uint32_t max_period_ms;     /* longest period the controller went to */
+} adapt_replay;
+
+/* Function: Adapt_Init(adapt_ctrl *ctrl)
+ * Parameters:
+ *      - adapt_ctrl *ctrl: the controller to initialize
+ * Return:
+ *      void
+ * Description:
+ *      - Start from the compile time settings (full burst, default period).
+ */
+void Adapt_Init(adapt_ctrl *ctrl);
+
+/* Function: Adapt_Update(adapt_ctrl *ctrl, int32_t temp_mC,
+ *                        uint32_t std_dev_mC)
+ * Parameters:
+ *      - adapt_ctrl *ctrl: the controller
+ *      - int32_t temp_mC: the latest reading
+ *      - uint32_t std_dev_mC: std. dev. of the samples behind it
+ * Return:
+ *      void
+ * Description:
+ *      - Size the next burst so that the noise of the mean stays at
+ *        ADAPT_TARGET_NOISE_MC, and stretch or shrink the period from
+ *        the change between the last two readings.
+ */
+void Adapt_Update(adapt_ctrl *ctrl, int32_t temp_mC, uint32_t std_dev_mC);
+
+/* Function: Adapt_Replay(const int32_t *temp_mC, const uint32_t *std_dev_mC,
+ *                        uint32_t n, uint32_t trace_period_ms,
+ *                        adapt_replay *result)
+ * Parameters:
+ *      - temp_mC, std_dev_mC: a recorded trace of readings
+ *      - n: number of entries in the trace
+ *      - trace_period_ms: time between two entries of the trace
+ *      - adapt_replay *result: filled with the outcome
+ * Return:
+ *      void
+ * Description:
+ *      - Run the controller over a recorded trace and compare the ADC
+ *        conversions it needs with the fixed MAX_CONVERSION/CYCLE_PERIOD
+ *        setup, and how far its last reading is from every entry of the
+ *        trace. Has no hardware dependencies, so it runs on the host too.
+ */
+void Adapt_Replay(const int32_t *temp_mC, const uint32_t *std_dev_mC,\
+                  uint32_t n, uint32_t trace_period_ms, adapt_replay *result);
+
+#endif /* SRC_ADAPTIVE_H_ */
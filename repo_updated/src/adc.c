@@ -16,8 +16,13 @@
 #include "adc.h"
 #include "em_int.h"
 #include "em_core.h"
+#include "sleep_modes.h"
+#include "nvm.h"
 
-volatile int16_t ADC0_DMArambuffer[MAX_CONVERSION] = {0};
+volatile int16_t ADC0_DMArambuffer[ADC0_BUFFER_SAMPLES] = {0};
+
+/* Sum, then average, of the polled burst */
+int32_t conversion_val = 0;
 
 /* This is a global definition for the DMA callback function
  * configuration.
@@ -28,11 +33,133 @@ static DMA_CB_TypeDef dma_cb_config = {
   .primary = true
 };
 
+/* Callback configuration for the ping-pong acquisition */
+static DMA_CB_TypeDef dma_pingpong_cb_config = {
+  .cbFunc = cb_ADC0_PingPong,
+  .userPtr = NULL,
+  .primary = true
+};
+
+/* Callback configuration for the PRS triggered acquisition */
+static DMA_CB_TypeDef dma_prs_cb_config = {
+  .cbFunc = cb_ADC0_PRS,
+  .userPtr = NULL,
+  .primary = true
+};
+
+/* Callback configuration for the multi-channel sequence */
+static DMA_CB_TypeDef dma_scan_cb_config = {
+  .cbFunc = cb_ADC0_Scan,
+  .userPtr = NULL,
+  .primary = true
+};
+
+/* Input and reference of every channel in the sequence */
+static const ADC_SingleInput_TypeDef adc0_seq_input[ADC_SEQ_CHANNELS] = {
+  ADC0_CHANNEL,
+  adcSingleInputVDDDiv3,
+  ADC0_LIGHT_INPUT
+};
+
+static const ADC_Ref_TypeDef adc0_seq_reference[ADC_SEQ_CHANNELS] = {
+  ADC0_REFERENCE,
+  adcRef1V25,
+  adcRefVDD
+};
+
+/* SINGLECTRL of every channel, written to the ADC by the DMA */
+static uint32_t adc0_seq_ctrl[ADC_SEQ_CHANNELS];
+
+/* Scatter-gather tasks: a read per channel, a SINGLECTRL write between */
+#define ADC0_SEQ_TASKS ((2 * ADC_SEQ_CHANNELS) - 1)
+static DMA_DESCRIPTOR_TypeDef adc0_seq_tasks[ADC0_SEQ_TASKS];
+
+static uint32_t seq_cycles = 0;
+
+/* Per channel statistics of the last sequence */
+sensor_stats adc0_seq_stats[ADC_SEQ_CHANNELS];
+
+/* Supply voltage measured by the last sequence */
+uint32_t adc0_vdd_mV = 0;
+
+/* Conversions per reading for the polled and ping-pong paths. Can be
+ * changed at runtime (adaptive sampling) up to MAX_CONVERSION.
+ */
+uint16_t adc0_conversions = MAX_CONVERSION;
+
+/* The last published reading in milli degrees */
+int32_t adc0_last_reading_mC = 0;
+
+/* Cost of the last reading, filled in by whichever path produced it */
+adc_profile adc0_profile = {0};
+
+/* Result of ADC0_Conv_Benchmark() */
+temp_conv_bench adc0_conv_bench = {0};
+
+/* Results of ADC0_Benchmark(), one entry per strategy */
+adc_bench adc0_bench[ADC_STRATEGY_COUNT] = {{0}};
+
+/* Calibration in use; factory until ADC0_Cal_Init() has run */
+adc_cal adc0_cal = {0};
+
+/* Reduction used on the DMA buffer */
+filter_kind adc0_filter = ADC0_FILTER;
+
+/* Results of ADC0_Filter_Benchmark(), one entry per kernel */
+filter_bench adc0_filter_bench[FILTER_COUNT] = {0};
+
+/* Raw ADC codes of the burst behind the last reading */
+sensor_stats adc0_burst_stats;
+
+/* The readings themselves, in milli degrees; never reset */
+sensor_stats adc0_reading_stats;
+
+/* Set by the asynchronous paths once the reading has been published */
+volatile bool adc0_reading_done = false;
+
+/* Awake cycles spent on the oversampled reading in progress */
+static uint32_t ovs_cycles = 0;
+
+/* Burst of the PRS chain in progress, armed until its DMA callback */
+static volatile bool adc0_prs_armed = false;
+static uint16_t adc0_prs_conversions = 0;
+
+/* Ping-pong bookkeeping for the reading in progress */
+static uint8_t pingpong_blocks_done = 0;
+static uint8_t pingpong_blocks_armed = 0;
+static uint8_t pingpong_blocks_total = 0;
+static uint32_t pingpong_cycles = 0;
+static uint16_t pingpong_wakeups = 0;
+
+/* Function: ADC0_Cal_Apply(ADC_Ref_TypeDef reference)
+ * Parameters:
+ *    - reference: the reference ADC_InitSingle() has just been called with
+ * Return:
+ *    void
+ * Description:
+ *    - ADC_InitSingle() reloads the factory values, so put the measured
+ *      ones back on top. Only valid for ADC0_REFERENCE.
+ */
+static void ADC0_Cal_Apply(ADC_Ref_TypeDef reference)
+{
+  if((adc0_cal.source != ADC_CAL_FACTORY) && (reference == ADC0_REFERENCE)) {
+    ADC0->CAL = (ADC0->CAL & ~ADC0_CAL_SINGLE_MASK) | adc0_cal.single_cal;
+  }
+
+  return;
+}
+
 void ADC0_Init(void)
 {
   /* Do the timebase calculation */
   int8_t calc_timebase = ADC_TimebaseCalc(CMU_ClockFreqGet(cmuClock_HFPER));
 
+  /* Cache the factory calibration of the temperature sensor */
+  Temp_Cal_Init((DEVINFO->CAL & _DEVINFO_CAL_TEMP_MASK)\
+                  >> _DEVINFO_CAL_TEMP_SHIFT,\
+                (DEVINFO->ADC0CAL2 & _DEVINFO_ADC0CAL2_TEMP1V25_MASK)\
+                  >> _DEVINFO_ADC0CAL2_TEMP1V25_SHIFT);
+
   /* Initialize the ADC struct */
   ADC_Init_TypeDef adc_init = {
     .ovsRateSel       = adcOvsRateSel2,
@@ -60,6 +187,7 @@ void ADC0_Init(void)
 
   /* Initialize the Single Input ADC Mode */
   ADC_InitSingle(ADC0, &adc_single_init);
+  ADC0_Cal_Apply(adc_single_init.reference);
 
   /* Do the ADC interrupt configuration */
 
@@ -69,6 +197,148 @@ void ADC0_Init(void)
   /* Enabling the requisite interrupts */
   ADC0->IEN = ADC_IFS_SINGLE;//0x1; //set the SINGLE bit in the register
 
+  /* The polled path reads the flag itself, keep the IRQ off */
+  NVIC_DisableIRQ(ADC0_IRQn);
+
+  return;
+}
+
+/* Function: ADC0_Cal_Convert(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    - the result of one single conversion
+ * Description:
+ *    - Polled conversion used by the calibration searches.
+ */
+static uint32_t ADC0_Cal_Convert(void)
+{
+  ADC_Start(ADC0, adcStartSingle);
+  while(!(ADC0->IF & ADC_IFS_SINGLE));
+  ADC_IntClear(ADC0, ADC_IFC_SINGLE);
+
+  return ADC0->SINGLEDATA;
+}
+
+/* Function: ADC0_Calibrate(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    - the single offset and gain fields for ADC0->CAL
+ * Description:
+ *    - Binary search of both fields with oversampled conversions on the
+ *      internal inputs (AN0021). Offset first: the smallest offset for
+ *      which VSS reads 0 (a larger offset lowers the result). Then gain:
+ *      the smallest gain for which Vref/2 reads at least half scale.
+ *      Leaves the ADC in the calibration setup, call ADC0_Init() after.
+ */
+uint32_t ADC0_Calibrate(void)
+{
+  int8_t calc_timebase = ADC_TimebaseCalc(CMU_ClockFreqGet(cmuClock_HFPER));
+  uint32_t cal = 0;
+  uint8_t low = 0;
+  uint8_t high = 0;
+  uint8_t mid = 0;
+
+  ADC_Init_TypeDef adc_init = {
+    .ovsRateSel       = ADC0_CAL_OVS_RATE,
+    .lpfMode          = ADC0_FILTER_TYPE,
+    .warmUpMode       = ADC0_WARMUP_OPTION,
+    .timebase         = calc_timebase,
+    .prescale         = CALC_PRESCALE_VAL,
+    .tailgate         = false
+  };
+
+  ADC_Init(ADC0, &adc_init);
+
+  ADC_InitSingle_TypeDef adc_single_init = {
+    .acqTime = adcAcqTime16,
+    .diff = false,
+    .input = adcSingleInputVSS,
+    .leftAdjust = false,
+    .prsEnable = false,
+    .reference = ADC0_REFERENCE,
+    .rep = false,
+    .resolution = adcResOVS
+  };
+
+  ADC_InitSingle(ADC0, &adc_single_init);
+  ADC0->IFC = 0xFF;
+
+  /* Offset: 7 bit two's complement, searched as mid - 64 */
+  low = 0;
+  high = 127;
+  while(low < high) {
+    mid = low + ((high - low) >> 1);
+    cal = ADC0->CAL & ~_ADC_CAL_SINGLEOFFSET_MASK;
+    ADC0->CAL = cal | ((uint32_t)((mid - 64) & 0x7F)\
+                       << _ADC_CAL_SINGLEOFFSET_SHIFT);
+    if(ADC0_Cal_Convert() > 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  cal = ADC0->CAL & ~_ADC_CAL_SINGLEOFFSET_MASK;
+  ADC0->CAL = cal | ((uint32_t)((low - 64) & 0x7F)\
+                     << _ADC_CAL_SINGLEOFFSET_SHIFT);
+
+  /* Gain: 7 bit unsigned, only the input changes */
+  ADC0->SINGLECTRL = (ADC0->SINGLECTRL & ~_ADC_SINGLECTRL_INPUTSEL_MASK)\
+                     | (adcSingleInputVrefDiv2 << _ADC_SINGLECTRL_INPUTSEL_SHIFT);
+  low = 0;
+  high = 127;
+  while(low < high) {
+    mid = low + ((high - low) >> 1);
+    cal = ADC0->CAL & ~_ADC_CAL_SINGLEGAIN_MASK;
+    ADC0->CAL = cal | ((uint32_t)mid << _ADC_CAL_SINGLEGAIN_SHIFT);
+    if(ADC0_Cal_Convert() < ADC0_CAL_GAIN_TARGET) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  cal = ADC0->CAL & ~_ADC_CAL_SINGLEGAIN_MASK;
+  ADC0->CAL = cal | ((uint32_t)low << _ADC_CAL_SINGLEGAIN_SHIFT);
+
+  return (ADC0->CAL & ADC0_CAL_SINGLE_MASK);
+}
+
+/* Function: ADC0_Cal_Init(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Load the calibration record from flash. Only if there is none (or
+ *      it is from an older layout, or corrupt) measure it and store it.
+ *      Ends with ADC0_Init() so the ADC is ready with the calibration
+ *      applied. The boot time this took is kept in adc0_cal.cycles.
+ */
+void ADC0_Cal_Init(void)
+{
+  uint32_t start = Profile_Get_Cycles();
+  uint32_t single_cal = 0;
+
+  adc0_cal.store_status = mscReturnOk;
+
+  if(Nvm_Record_Read(NVM_ADC_CAL_PAGE, ADC0_CAL_MAGIC, ADC0_CAL_VERSION,\
+                     &single_cal, sizeof(single_cal))) {
+    adc0_cal.source = ADC_CAL_FLASH;
+  } else {
+    single_cal = ADC0_Calibrate();
+    adc0_cal.source = ADC_CAL_MEASURED;
+    adc0_cal.store_status = Nvm_Record_Write(NVM_ADC_CAL_PAGE, ADC0_CAL_MAGIC,\
+                                             ADC0_CAL_VERSION, &single_cal,\
+                                             sizeof(single_cal));
+  }
+  adc0_cal.single_cal = single_cal & ADC0_CAL_SINGLE_MASK;
+
+  /* Back to the normal setup, now with the calibration on top */
+  ADC0_Init();
+
+  adc0_cal.cycles = Profile_Get_Cycles() - start;
+
   return;
 }
 
@@ -85,9 +355,6 @@ void ADC0_Init(void)
  */
 void cb_ADC0_DMA(unsigned int channel, bool primary, void *user)
 {
-  
-  uint16_t cnt = 0;
-  uint32_t sum = 0;
 
   INT_Disable();
 
@@ -98,19 +365,15 @@ void cb_ADC0_DMA(unsigned int channel, bool primary, void *user)
   ADC0->CMD = ADC_CMD_SINGLESTOP;
 
   /* unblock the EM1 sleep now, ADC ops done! */
-  unblockSleepMode(ADC_SLEEP_MODE);
-
-  /*Store the values in the DMA buffer */
-  while(cnt != MAX_CONVERSION) {
-    sum += ADC0_DMArambuffer[cnt++];
-  }
-
-  /*Get the average and convert to celsius */
-  sum = sum/MAX_CONVERSION;
+  unblockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
 
-  float C_temp = convertToCelsius(sum);
+  /* Reduce the DMA buffer to a reading in milli degrees */
+  int32_t C_temp = Temp_Path_Reduce(&adc0_burst_stats, ADC0_DMArambuffer,\
+                                    MAX_CONVERSION, adc0_filter);
+  ADC0_Stats_Add_Reading(C_temp);
   
-  if ((C_temp < LOWER_TEMP_BOUND) || (C_temp > UPPER_TEMP_BOUND)) {
+  if ((C_temp < (LOWER_TEMP_BOUND * 1000)) ||\
+      (C_temp > (UPPER_TEMP_BOUND * 1000))) {
     /*Turn on the LED*/
     GPIO_PinOutSet(LED_PORT,LED_1_PIN);
   } else {
@@ -123,6 +386,103 @@ void cb_ADC0_DMA(unsigned int channel, bool primary, void *user)
   return;
 }
 
+/* Function: convertToCelsius(int32_t adcSample)
+ * Parameters:
+ *    adcSample: pass the value returned by the ADC to this function
+ * Return:
+ *    - a value of the temperature converted to celsius
+ * Description:
+ *    - Use this function to convert the value that is read from the 
+ *      adc to a celsius value in floating point.
+ *    - Kept as the reference for the fixed point Temp_Code_To_mC(),
+ *      which is what the acquisition paths use.
+ * IP Credits: 
+ *      This routine is credited to Silicon Labs
+ */
+float convertToCelsius(int32_t adcSample)
+{
+  float temp = 0;
+
+  /* Factory calibration of temperature from the device information page */
+  float cal_temp_0 = (float)((DEVINFO->CAL & _DEVINFO_CAL_TEMP_MASK) >>\
+                                _DEVINFO_CAL_TEMP_SHIFT);
+
+  float cal_value_0 = (float)((DEVINFO->ADC0CAL2\
+                              & _DEVINFO_ADC0CAL2_TEMP1V25_MASK)\
+                              >> _DEVINFO_ADC0CAL2_TEMP1V25_SHIFT);
+
+  /* Temperature gradient(from the datasheet) */
+  float gradient = SET_TEMP_GRADIENT;
+
+  temp = (cal_temp_0 - ((cal_value_0 - adcSample)/gradient));
+
+  return temp;
+}
+
+/* Function: Get_Avg_Temperature(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    - The average temperature value from amongst all the 
+ *      values read from the ADC.
+ * Description:
+ *    - Use this function to get an average temperature reading 
+ *      from amongst all the ADC values read. 
+ */
+float Get_Avg_Temperature(void)
+{
+
+  int16_t cnt = 0;
+  uint32_t start = Profile_Get_Cycles();
+
+  int32_t sample = 0;
+  int32_t temp_mC = 0;
+
+  conversion_val = 0;
+  Stats_Reset(&adc0_burst_stats);
+
+  /* Start the ADC count */
+  ADC_Start(ADC0, adcStartSingle);
+
+  while(cnt != adc0_conversions) {
+	while(!(ADC0->IF & ADC_IFS_SINGLE));
+
+    /* Wait for the single conversion to complete */
+    while(!(ADC0->IF & ADC_IFS_SINGLE));
+
+    /*Clear the flag */
+    ADC_IntClear(ADC0, ADC_IFC_SINGLE);
+
+    /*Get the value*/
+    sample = ADC0->SINGLEDATA;
+    conversion_val += sample;
+    Stats_Add_Sample(&adc0_burst_stats, sample);
+
+    cnt ++;
+  }
+
+  /* Stop the ADC conversion */
+  ADC0->CMD = ADC_CMD_SINGLESTOP;
+
+  /* ADC work done; Exit EM1 */
+  unblockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+
+  /* Get the average */
+  conversion_val = conversion_val/adc0_conversions;
+
+  /* The core never slept, so the whole burst counts as awake time */
+  adc0_profile.cycles = Profile_Get_Cycles() - start;
+  adc0_profile.time_us = Profile_Cycles_To_us(adc0_profile.cycles);
+  adc0_profile.wakeups = 1;
+
+  temp_mC = Temp_Code_To_mC(conversion_val);
+  ADC0_Stats_Add_Reading(temp_mC);
+
+  /* Return the value in Celsius */
+  return (TEMP_MC_TO_C(temp_mC));
+
+}
+
 /* Function: ADC0_DMA_Setup(void)
  * Parameters:
  *    void
@@ -176,13 +536,8 @@ void ADC0_DMA_Setup(void)
  */
 void DMA_Initialize(void)
 {
-  /* Initialize the structure */
-  static DMA_Init_TypeDef Init_DMA = {
-    .controlBlock = dmaControlBlock,
-    .hprot = DEF_HPROT_VAL
-  };
-  
-  DMA_Init(&Init_DMA);
+  /* Once only: DMA_Init() would cancel the LEUART transfers */
+  DMA_Controller_Init();
 
   /* Setup the ADC to work with DMA */
   ADC0_DMA_Setup();
@@ -193,5 +548,876 @@ void DMA_Initialize(void)
   return;
 }
 
+/* Function: ADC0_PingPong_Init(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - One time DMA setup for the ping-pong acquisition. Both the primary
+ *      and the alternate descriptors move ADC0->SINGLEDATA into one half
+ *      of ADC0_DMArambuffer each.
+ */
+void ADC0_PingPong_Init(void)
+{
+  static DMA_CfgDescr_TypeDef dma_cfgdescr = {
+    .arbRate = dmaArbitrate1,
+    .dstInc = dmaDataInc2,
+    .hprot = DEF_HPROT_VAL,
+    .size = dmaDataSize2,
+    .srcInc = dmaDataIncNone
+  };
+
+  static DMA_CfgChannel_TypeDef dma_chnldescr = {
+    .cb = &dma_pingpong_cb_config,
+    .enableInt = true,
+    .highPri = true,
+    .select = DMAREQ_ADC0_SINGLE
+  };
+
+  DMA_Controller_Init();
+
+  DMA_CfgChannel(ADC0_DMA_Channel, &dma_chnldescr);
+  DMA_CfgDescr(ADC0_DMA_Channel, true, &dma_cfgdescr);
+  DMA_CfgDescr(ADC0_DMA_Channel, false, &dma_cfgdescr);
+
+  DMA_IntClear(ADC0_DMA_Channel);
+  DMA_IntEnable(ADC0_DMA_Channel);
+
+  NVIC_EnableIRQ(DMA_IRQn);
+
+  return;
+}
+
+/* Function: ADC0_PingPong_Start(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Start one reading of adc0_conversions samples, rounded up to
+ *      whole blocks. The samples are
+ *      streamed through the two halves of ADC0_DMArambuffer and the core
+ *      only wakes up once per ADC0_PINGPONG_BLOCK samples to reduce the
+ *      half that just filled. The caller must block EM1 beforehand, the
+ *      last callback releases it.
+ */
+void ADC0_PingPong_Start(void)
+{
+  uint32_t start = Profile_Get_Cycles();
+
+  adc0_reading_done = false;
+  Stats_Reset(&adc0_burst_stats);
+  pingpong_blocks_done = 0;
+  pingpong_blocks_total = (adc0_conversions + ADC0_PINGPONG_BLOCK - 1)\
+                          / ADC0_PINGPONG_BLOCK;
+  if(pingpong_blocks_total == 0) {
+    pingpong_blocks_total = 1;
+  }
+  pingpong_blocks_armed = 2;
+  pingpong_wakeups = 0;
+
+  DMA_ActivatePingPong(ADC0_DMA_Channel, false,\
+                       (void *)ADC0_DMArambuffer,\
+                       (void *)&(ADC0->SINGLEDATA),\
+                       (ADC0_PINGPONG_BLOCK-1),\
+                       (void *)&ADC0_DMArambuffer[ADC0_PINGPONG_BLOCK],\
+                       (void *)&(ADC0->SINGLEDATA),\
+                       (ADC0_PINGPONG_BLOCK-1));
+
+  ADC_Start(ADC0, adcStartSingle);
+
+  pingpong_cycles = Profile_Get_Cycles() - start;
+
+  return;
+}
+
+/* Function: cb_ADC0_PingPong(unsigned int channel, bool primary, void *user)
+ * Parameters:
+ *    - channel - the DMA channel over which the data is being transfered.
+ *    - primary - true if the primary half has just been filled.
+ *    - user - a user defined pointer to provide with the callback function.
+ * Return:
+ *    void
+ * Description:
+ *    - Reduce the half that has just been filled while the other half is
+ *      being filled by the DMA, then re-arm it for the next block. Once
+ *      all the blocks are in, stop the ADC and publish the reading.
+ */
+void cb_ADC0_PingPong(unsigned int channel, bool primary, void *user)
+{
+  uint32_t start = Profile_Get_Cycles();
+  volatile int16_t *block = primary ? ADC0_DMArambuffer :\
+                                      &ADC0_DMArambuffer[ADC0_PINGPONG_BLOCK];
+  int32_t temp_mC = 0;
+
+  Stats_Add_Block(&adc0_burst_stats, block, ADC0_PINGPONG_BLOCK);
+  pingpong_blocks_done++;
+  pingpong_wakeups++;
+
+  if(pingpong_blocks_armed < pingpong_blocks_total) {
+    /* Re-use this half for the next block; the last one ends the cycle */
+    pingpong_blocks_armed++;
+    DMA_RefreshPingPong(channel, primary, false,\
+                        (void *)block, NULL,\
+                        (ADC0_PINGPONG_BLOCK-1),\
+                        (pingpong_blocks_armed == pingpong_blocks_total));
+  }
+
+  if(pingpong_blocks_done == pingpong_blocks_total) {
+    /* Stop the ADC */
+    ADC0->CMD = ADC_CMD_SINGLESTOP;
+
+    temp_mC = Temp_Ovs_To_mC(adc0_burst_stats.mean_q, STATS_Q_BITS);
+    temp_sense_output = TEMP_MC_TO_C(temp_mC);
+    ADC0_Stats_Add_Reading(temp_mC);
+
+    /* unblock the EM1 sleep now, ADC ops done! */
+    unblockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+
+    pingpong_cycles += Profile_Get_Cycles() - start;
+    adc0_profile.cycles = pingpong_cycles;
+    adc0_profile.time_us = Profile_Cycles_To_us(pingpong_cycles);
+    adc0_profile.wakeups = pingpong_wakeups;
+    adc0_reading_done = true;
+  } else {
+    pingpong_cycles += Profile_Get_Cycles() - start;
+  }
+
+  return;
+}
+
+/* Function: ADC0_PRS_Init(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Set up the LETIMER0 -> PRS -> TIMER2 -> PRS -> ADC0 -> DMA chain.
+ *      TIMER2 is started by the LETIMER0 output 0 pulse and paces the
+ *      conversions of the burst; the DMA collects them into
+ *      ADC0_DMArambuffer without the core.
+ *    - Nothing runs until ADC0_PRS_Arm(). LETIMER0 must pulse output 0
+ *      on underflow for the chain to be triggered.
+ */
+void ADC0_PRS_Init(void)
+{
+  static DMA_CfgDescr_TypeDef dma_cfgdescr = {
+    .arbRate = dmaArbitrate1,
+    .dstInc = dmaDataInc2,
+    .hprot = DEF_HPROT_VAL,
+    .size = dmaDataSize2,
+    .srcInc = dmaDataIncNone
+  };
+
+  static DMA_CfgChannel_TypeDef dma_chnldescr = {
+    .cb = &dma_prs_cb_config,
+    .enableInt = true,
+    .highPri = true,
+    .select = DMAREQ_ADC0_SINGLE
+  };
+
+  /* Started (and reloaded) by the gate; the input action is only turned
+   * on by ADC0_PRS_Arm()
+   */
+  TIMER_Init_TypeDef timer_init = {
+    .enable     = false,
+    .debugRun   = false,
+    .prescale   = timerPrescale1,
+    .clkSel     = timerClkSelHFPerClk,
+    .fallAction = timerInputActionNone,
+    .riseAction = timerInputActionNone,
+    .mode       = timerModeUp,
+    .dmaClrAct  = false,
+    .quadModeX4 = false,
+    .oneShot    = false,
+    .sync       = false,
+  };
+
+  TIMER_InitCC_TypeDef timer_gate_init = {
+    .eventCtrl  = timerEventEveryEdge,
+    .edge       = timerEdgeRising,
+    .prsSel     = ADC0_PRS_GATE_SEL,
+    .cufoa      = timerOutputActionNone,
+    .cofoa      = timerOutputActionNone,
+    .cmoa       = timerOutputActionNone,
+    .mode       = timerCCModeCapture,
+    .filter     = false,
+    .prsInput   = true,
+    .coist      = false,
+    .outInvert  = false,
+  };
+
+  /* LETIMER0 output 0 opens the gate, TIMER2 overflows start conversions */
+  CMU_ClockEnable(cmuClock_PRS, true);
+  PRS_SourceSignalSet(ADC0_PRS_GATE_CHANNEL, PRS_CH_CTRL_SOURCESEL_LETIMER0,\
+                      PRS_CH_CTRL_SIGSEL_LETIMER0CH0, prsEdgePos);
+  PRS_SourceSignalSet(ADC0_PRS_CHANNEL, PRS_CH_CTRL_SOURCESEL_TIMER2,\
+                      PRS_CH_CTRL_SIGSEL_TIMER2OF, prsEdgePos);
+
+  CMU_ClockEnable(ADC0_PRS_TIMER_CLOCK, true);
+  TIMER_Init(ADC0_PRS_TIMER, &timer_init);
+  TIMER_InitCC(ADC0_PRS_TIMER, 0, &timer_gate_init);
+  TIMER_TopSet(ADC0_PRS_TIMER,\
+               (CMU_ClockFreqGet(ADC0_PRS_TIMER_CLOCK) / ADC0_PRS_BURST_HZ) - 1);
 
+  /* One conversion per PRS pulse */
+  ADC_InitSingle_TypeDef adc_single_init = {
+    .acqTime = ADC0_ACQ_TIME,
+    .diff = false,
+    .input = ADC0_CHANNEL,
+    .leftAdjust = false,
+    .prsEnable = true,
+    .prsSel = ADC0_PRS_SEL,
+    .reference = ADC0_REFERENCE,
+    .rep = false,
+    .resolution = adcRes12Bit
+  };
 
+  ADC_InitSingle(ADC0, &adc_single_init);
+  ADC0_Cal_Apply(adc_single_init.reference);
+  ADC0->IFC = 0xFF;
+
+  DMA_Controller_Init();
+  DMA_CfgChannel(ADC0_DMA_Channel, &dma_chnldescr);
+  DMA_CfgDescr(ADC0_DMA_Channel, true, &dma_cfgdescr);
+
+  DMA_IntClear(ADC0_DMA_Channel);
+  DMA_IntEnable(ADC0_DMA_Channel);
+  NVIC_EnableIRQ(DMA_IRQn);
+
+  return;
+}
+
+/* Function: ADC0_PRS_Arm(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Let the next LETIMER0 underflow start a burst. Call from the COMP1
+ *      interrupt just ahead of it: TIMER2, the ADC and the DMA need the
+ *      HF clocks, so EM1 is held from here until cb_ADC0_PRS().
+ */
+void ADC0_PRS_Arm(void)
+{
+  if(adc0_prs_armed) {
+    /* The last burst has not finished; let it */
+    return;
+  }
+
+  adc0_prs_conversions = adc0_conversions;
+  DMA_ActivateBasic(ADC0_DMA_Channel, true, false, (void *)ADC0_DMArambuffer,\
+                      (void *)&(ADC0->SINGLEDATA), (adc0_prs_conversions-1));
+
+  blockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+  adc0_prs_armed = true;
+  ADC0_PRS_TIMER->CTRL = (ADC0_PRS_TIMER->CTRL & ~_TIMER_CTRL_RISEA_MASK)\
+                         | TIMER_CTRL_RISEA_RELOADSTART;
+
+  return;
+}
+
+/* Function: cb_ADC0_PRS(unsigned int channel, bool primary, void *user)
+ * Parameters:
+ *    - channel - the DMA channel over which the data is being transfered.
+ *    - primary - whether or not the primary channel of the DMA is selected.
+ *    - user - a user defined pointer to provide with the callback function.
+ * Return:
+ *    void
+ * Description:
+ *    - The burst is in. Close the gate, publish the average and let the
+ *      node go back to EM2/EM3 until the next ADC0_PRS_Arm().
+ */
+void cb_ADC0_PRS(unsigned int channel, bool primary, void *user)
+{
+  uint32_t start = Profile_Get_Cycles();
+  int32_t temp_mC = 0;
+
+  ADC0_PRS_TIMER->CTRL &= ~_TIMER_CTRL_RISEA_MASK;
+  ADC0_PRS_TIMER->CMD = TIMER_CMD_STOP;
+
+  Stats_Reset(&adc0_burst_stats);
+  Stats_Add_Block(&adc0_burst_stats, ADC0_DMArambuffer, adc0_prs_conversions);
+
+  temp_mC = Temp_Ovs_To_mC(adc0_burst_stats.mean_q, STATS_Q_BITS);
+  temp_sense_output = TEMP_MC_TO_C(temp_mC);
+  ADC0_Stats_Add_Reading(temp_mC);
+
+  if(adc0_prs_armed) {
+    adc0_prs_armed = false;
+    unblockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+  }
+
+  adc0_profile.cycles = Profile_Get_Cycles() - start;
+  adc0_profile.time_us = Profile_Cycles_To_us(adc0_profile.cycles);
+  adc0_profile.wakeups = 1;
+  adc0_reading_done = true;
+
+  return;
+}
+
+/* Function: ADC0_Scan_Buffer(adc_seq_chnl seq_chnl)
+ * Parameters:
+ *    seq_chnl - a channel of the sequence
+ * Return:
+ *    - the ADC0_SEQ_SAMPLES raw samples of that channel
+ * Description:
+ *    - Each channel owns one slice of ADC0_DMArambuffer, behind its
+ *      settling samples.
+ */
+volatile int16_t *ADC0_Scan_Buffer(adc_seq_chnl seq_chnl)
+{
+  return &ADC0_DMArambuffer[(seq_chnl * ADC0_SEQ_SLICE) + ADC0_SEQ_SETTLE];
+}
+
+/* Function: ADC0_Scan_Init(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - One time DMA setup for the multi-channel sequence, and the
+ *      SINGLECTRL value of every channel, as ADC_InitSingle() builds it.
+ */
+void ADC0_Scan_Init(void)
+{
+  static DMA_CfgChannel_TypeDef dma_chnldescr = {
+    .cb = &dma_scan_cb_config,
+    .enableInt = true,
+    .highPri = true,
+    .select = DMAREQ_ADC0_SINGLE
+  };
+
+  ADC_InitSingle_TypeDef adc_single_init = {
+    .acqTime = ADC0_ACQ_TIME,
+    .diff = false,
+    .input = ADC0_CHANNEL,
+    .leftAdjust = false,
+    .prsEnable = false,
+    .reference = ADC0_REFERENCE,
+    .rep = true,
+    .resolution = adcRes12Bit
+  };
+  adc_seq_chnl seq_chnl;
+
+  DMA_Controller_Init();
+  DMA_CfgChannel(ADC0_DMA_Channel, &dma_chnldescr);
+
+  DMA_IntClear(ADC0_DMA_Channel);
+  DMA_IntEnable(ADC0_DMA_Channel);
+  NVIC_EnableIRQ(DMA_IRQn);
+
+  for(seq_chnl = ADC_SEQ_TEMP; seq_chnl < ADC_SEQ_CHANNELS; seq_chnl++) {
+    adc_single_init.input = adc0_seq_input[seq_chnl];
+    adc_single_init.reference = adc0_seq_reference[seq_chnl];
+    ADC_InitSingle(ADC0, &adc_single_init);
+    adc0_seq_ctrl[seq_chnl] = ADC0->SINGLECTRL;
+
+    Stats_Init(&adc0_seq_stats[seq_chnl], STATS_EMA_SHIFT);
+  }
+
+  /* Leave the ADC on the temperature channel and its calibration */
+  adc_single_init.input = ADC0_CHANNEL;
+  adc_single_init.reference = ADC0_REFERENCE;
+  ADC_InitSingle(ADC0, &adc_single_init);
+  ADC0_Cal_Apply(adc_single_init.reference);
+
+  return;
+}
+
+/* Function: ADC0_Scan_Start(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Convert all the analog channels in one go. The caller must block
+ *      EM1 beforehand, cb_ADC0_Scan() releases it.
+ */
+void ADC0_Scan_Start(void)
+{
+  uint32_t start = Profile_Get_Cycles();
+  DMA_CfgDescrSGAlt_TypeDef task = {
+    .src = (void *)&(ADC0->SINGLEDATA),
+    .dst = NULL,
+    .srcInc = dmaDataIncNone,
+    .dstInc = dmaDataInc2,
+    .size = dmaDataSize2,
+    .arbRate = dmaArbitrate1,
+    .hprot = DEF_HPROT_VAL,
+    .nMinus1 = ADC0_SEQ_SLICE - 1,
+    .peripheral = true
+  };
+  DMA_CfgDescrSGAlt_TypeDef ctrl_task = {
+    .src = NULL,
+    .dst = (void *)&(ADC0->SINGLECTRL),
+    .srcInc = dmaDataIncNone,
+    .dstInc = dmaDataIncNone,
+    .size = dmaDataSize4,
+    .arbRate = dmaArbitrate1,
+    .hprot = DEF_HPROT_VAL,
+    .nMinus1 = 0,
+    .peripheral = true
+  };
+  adc_seq_chnl seq_chnl;
+  unsigned int indx = 0;
+
+  adc0_reading_done = false;
+
+  /* The ADC keeps asking while a SINGLECTRL write runs, so the next read
+   * picks up the stale sample first: that is one of the settling ones
+   */
+  for(seq_chnl = ADC_SEQ_TEMP; seq_chnl < ADC_SEQ_CHANNELS; seq_chnl++) {
+    if(seq_chnl != ADC_SEQ_TEMP) {
+      ctrl_task.src = (void *)&adc0_seq_ctrl[seq_chnl];
+      DMA_CfgDescrScatterGather(adc0_seq_tasks, indx++, &ctrl_task);
+    }
+    task.dst = (void *)&ADC0_DMArambuffer[seq_chnl * ADC0_SEQ_SLICE];
+    DMA_CfgDescrScatterGather(adc0_seq_tasks, indx++, &task);
+  }
+
+  ADC0->SINGLECTRL = adc0_seq_ctrl[ADC_SEQ_TEMP];
+  DMA_ActivateScatterGather(ADC0_DMA_Channel, false, adc0_seq_tasks,\
+                            ADC0_SEQ_TASKS);
+  ADC_Start(ADC0, adcStartSingle);
+
+  seq_cycles = Profile_Get_Cycles() - start;
+
+  return;
+}
+
+/* Function: cb_ADC0_Scan(unsigned int channel, bool primary, void *user)
+ * Parameters:
+ *    - channel - the DMA channel over which the data is being transfered.
+ *    - primary - whether or not the primary channel of the DMA is selected.
+ *    - user - a user defined pointer to provide with the callback function.
+ * Return:
+ *    void
+ * Description:
+ *    - The whole sequence is in. Reduce every channel and publish the
+ *      temperature and VDD.
+ */
+void cb_ADC0_Scan(unsigned int channel, bool primary, void *user)
+{
+  uint32_t start = Profile_Get_Cycles();
+  adc_seq_chnl seq_chnl;
+  int32_t temp_mC = 0;
+
+  ADC0->CMD = ADC_CMD_SINGLESTOP;
+  ADC0->SINGLECTRL = adc0_seq_ctrl[ADC_SEQ_TEMP];
+
+  for(seq_chnl = ADC_SEQ_TEMP; seq_chnl < ADC_SEQ_CHANNELS; seq_chnl++) {
+    Stats_Reset(&adc0_seq_stats[seq_chnl]);
+    Stats_Add_Block(&adc0_seq_stats[seq_chnl], ADC0_Scan_Buffer(seq_chnl),\
+                    ADC0_SEQ_SAMPLES);
+  }
+
+  /* Temperature goes through the same path as every other reading */
+  adc0_burst_stats = adc0_seq_stats[ADC_SEQ_TEMP];
+  temp_mC = Temp_Ovs_To_mC(adc0_seq_stats[ADC_SEQ_TEMP].mean_q, STATS_Q_BITS);
+  temp_sense_output = TEMP_MC_TO_C(temp_mC);
+  ADC0_Stats_Add_Reading(temp_mC);
+
+  adc0_vdd_mV = ((adc0_seq_stats[ADC_SEQ_VDD].mean_q >> STATS_Q_BITS)\
+                  * ADC0_REF_MV * ADC0_VDD_DIVIDER) >> 12;
+
+  /* ADC work done; Exit EM1 */
+  unblockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+
+  seq_cycles += Profile_Get_Cycles() - start;
+  adc0_profile.cycles = seq_cycles;
+  adc0_profile.time_us = Profile_Cycles_To_us(seq_cycles);
+  adc0_profile.wakeups = 1;
+  adc0_reading_done = true;
+
+  return;
+}
+
+/* Function: ADC0_Oversample_Init(ADC_OvsRateSel_TypeDef rate)
+ * Parameters:
+ *    rate - number of samples the ADC accumulates per result
+ * Return:
+ *    void
+ * Description:
+ *    - Re-configure ADC0 to take one oversampled conversion of the
+ *      temperature sensor per start. The averaging is done by the ADC
+ *      itself, so the core only wakes up once for the result.
+ *      ADC0_Init() puts the ADC back in 12 bit repeat mode.
+ */
+void ADC0_Oversample_Init(ADC_OvsRateSel_TypeDef rate)
+{
+  int8_t calc_timebase = ADC_TimebaseCalc(CMU_ClockFreqGet(cmuClock_HFPER));
+
+  ADC_Init_TypeDef adc_init = {
+    .ovsRateSel       = rate,
+    .lpfMode          = ADC0_FILTER_TYPE,
+    .warmUpMode       = ADC0_WARMUP_OPTION,
+    .timebase         = calc_timebase,
+    .prescale         = CALC_PRESCALE_VAL,
+    .tailgate         = false
+  };
+
+  ADC_Init(ADC0, &adc_init);
+
+  ADC_InitSingle_TypeDef adc_single_init = {
+    .acqTime = ADC0_ACQ_TIME,
+    .diff = false,
+    .input = ADC0_CHANNEL,
+    .leftAdjust = false,
+    .prsEnable = false,
+    .reference = ADC0_REFERENCE,
+    .rep = false,
+    .resolution = adcResOVS
+  };
+
+  ADC_InitSingle(ADC0, &adc_single_init);
+  ADC0_Cal_Apply(adc_single_init.reference);
+
+  /* The result comes in through ADC0_IRQHandler */
+  ADC0->IFC = 0xFF;
+  ADC0->IEN = ADC_IEN_SINGLE;
+  NVIC_ClearPendingIRQ(ADC0_IRQn);
+  NVIC_EnableIRQ(ADC0_IRQn);
+
+  return;
+}
+
+/* Function: ADC0_Oversample_Start(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Start one oversampled conversion. The caller must block EM1
+ *      beforehand, ADC0_IRQHandler releases it.
+ */
+void ADC0_Oversample_Start(void)
+{
+  uint32_t start = Profile_Get_Cycles();
+
+  adc0_reading_done = false;
+  ADC_Start(ADC0, adcStartSingle);
+
+  ovs_cycles = Profile_Get_Cycles() - start;
+
+  return;
+}
+
+/* Function: ADC0_IRQHandler(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Completion of an oversampled conversion. The 4 fractional bits
+ *      are kept by the conversion (rates of 16 and up).
+ */
+void ADC0_IRQHandler(void)
+{
+  uint32_t start = Profile_Get_Cycles();
+  int32_t ovs_sample = 0;
+  int32_t temp_mC = 0;
+
+  ADC_IntClear(ADC0, ADC_IFC_SINGLE);
+  ovs_sample = ADC0->SINGLEDATA;
+
+  /* A single hardware averaged sample; the burst spread is not known */
+  Stats_Reset(&adc0_burst_stats);
+  Stats_Add_Sample(&adc0_burst_stats, ovs_sample >> ADC0_OVS_FRAC_BITS);
+
+  temp_mC = Temp_Ovs_To_mC(ovs_sample, ADC0_OVS_FRAC_BITS);
+  temp_sense_output = TEMP_MC_TO_C(temp_mC);
+  ADC0_Stats_Add_Reading(temp_mC);
+
+  /* ADC work done; Exit EM1 */
+  unblockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+
+  ovs_cycles += Profile_Get_Cycles() - start;
+  adc0_profile.cycles = ovs_cycles;
+  adc0_profile.time_us = Profile_Cycles_To_us(ovs_cycles);
+  adc0_profile.wakeups = 1;
+  adc0_reading_done = true;
+
+  return;
+}
+
+/* Function: ADC0_Busy_Time_us(adc_strategy strategy)
+ * Parameters:
+ *    strategy - the acquisition strategy
+ * Return:
+ *    - the time the ADC is converting for one reading, in us
+ * Description:
+ *    - Derived from the ADC clock and the number of conversions, since
+ *      the cycle counter stops while the core sleeps.
+ */
+uint32_t ADC0_Busy_Time_us(adc_strategy strategy)
+{
+  uint32_t adc_clk_khz = CMU_ClockFreqGet(cmuClock_HFPER)\
+                          / ((CALC_PRESCALE_VAL + 1) * 1000);
+  uint32_t conversions = adc0_conversions;
+
+  if(strategy == ADC_STRATEGY_OVERSAMPLE) {
+    conversions = (2 << ADC0_OVS_RATE);
+  }
+
+  return ((conversions * ADC0_CONV_CYCLES * 1000) / adc_clk_khz);
+}
+
+/* Function: ADC0_Wait_For_Reading(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Sleep in EM1 until an asynchronous reading has been published.
+ *      Interrupts stay masked around the check so a completion between
+ *      the check and the WFI still wakes the core.
+ */
+static void ADC0_Wait_For_Reading(void)
+{
+  INT_Disable();
+  while(!adc0_reading_done) {
+    EMU_EnterEM1();
+    INT_Enable();
+    INT_Disable();
+  }
+  INT_Enable();
+
+  return;
+}
+
+/* Function: ADC0_Benchmark(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Take ADC0_BENCH_READINGS readings with every strategy and store
+ *      the average awake time, ADC busy time, estimated charge and the
+ *      mean/variance of the readings in adc0_bench. Must run before the
+ *      LETIMER0 is started. Leaves the ADC in its default configuration.
+ */
+void ADC0_Benchmark(void)
+{
+  uint32_t core_mhz = CMU_ClockFreqGet(cmuClock_CORE) / 1000000;
+  adc_strategy strategy;
+  uint8_t cnt;
+
+  ADC0_PingPong_Init();
+
+  for(strategy = ADC_STRATEGY_POLLED; strategy < ADC_STRATEGY_COUNT;\
+      strategy++) {
+    uint32_t awake_us = 0;
+    uint32_t busy_us = 0;
+    float sum = 0;
+    float sum_sq = 0;
+
+    if(strategy == ADC_STRATEGY_OVERSAMPLE) {
+      ADC0_Oversample_Init(ADC0_OVS_RATE);
+    } else {
+      ADC0_Init();
+    }
+
+    for(cnt = 0; cnt < ADC0_BENCH_READINGS; cnt++) {
+      if(strategy == ADC_STRATEGY_POLLED) {
+        temp_sense_output = Get_Avg_Temperature();
+      } else {
+        blockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+        if(strategy == ADC_STRATEGY_PINGPONG) {
+          ADC0_PingPong_Start();
+        } else {
+          ADC0_Oversample_Start();
+        }
+        ADC0_Wait_For_Reading();
+      }
+
+      awake_us += adc0_profile.time_us;
+      sum += temp_sense_output;
+      sum_sq += temp_sense_output * temp_sense_output;
+    }
+
+    awake_us = awake_us / ADC0_BENCH_READINGS;
+    busy_us = (strategy == ADC_STRATEGY_POLLED) ? awake_us :\
+                                                   ADC0_Busy_Time_us(strategy);
+    if(busy_us < awake_us) {
+      busy_us = awake_us;
+    }
+
+    adc0_bench[strategy].awake_us = awake_us;
+    adc0_bench[strategy].busy_us = busy_us;
+    adc0_bench[strategy].charge_nC =\
+      ((awake_us * EM0_CURRENT_UA_PER_MHZ * core_mhz)\
+       + ((busy_us - awake_us) * EM1_CURRENT_UA_PER_MHZ * core_mhz)\
+       + (busy_us * ADC0_CURRENT_UA)) / 1000;
+    adc0_bench[strategy].mean = sum / ADC0_BENCH_READINGS;
+    adc0_bench[strategy].variance = (sum_sq / ADC0_BENCH_READINGS)\
+      - (adc0_bench[strategy].mean * adc0_bench[strategy].mean);
+  }
+
+  /* Back to the default single conversion setup */
+  ADC0_Init();
+
+  return;
+}
+
+/* Function: ADC0_Conv_Benchmark(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Run both the fixed point and the float conversion over every 12
+ *      bit code. Stores the worst difference in milli degrees and the
+ *      average cycles per conversion of each in adc0_conv_bench.
+ */
+void ADC0_Conv_Benchmark(void)
+{
+  volatile int32_t fixed_mC = 0;
+  volatile float float_C = 0;
+  uint32_t fixed_cycles = 0;
+  uint32_t float_cycles = 0;
+  uint32_t start = 0;
+  int32_t err = 0;
+  int32_t code;
+
+  adc0_conv_bench.max_err_mC = 0;
+
+  for(code = 0; code < (1 << 12); code++) {
+    start = Profile_Get_Cycles();
+    fixed_mC = Temp_Code_To_mC(code);
+    fixed_cycles += Profile_Get_Cycles() - start;
+
+    start = Profile_Get_Cycles();
+    float_C = convertToCelsius(code);
+    float_cycles += Profile_Get_Cycles() - start;
+
+    err = fixed_mC - (int32_t)(float_C * 1000.0f);
+    if(err < 0) {
+      err = -err;
+    }
+    if(err > adc0_conv_bench.max_err_mC) {
+      adc0_conv_bench.max_err_mC = err;
+    }
+  }
+
+  adc0_conv_bench.fixed_cycles = fixed_cycles >> 12;
+  adc0_conv_bench.float_cycles = float_cycles >> 12;
+
+  return;
+}
+
+/* Function: ADC0_Filter_Benchmark(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Fill the DMA buffer with ADC0_FILTER_BENCH_LARGE real conversions
+ *      and time every kernel over the first ADC0_FILTER_BENCH_SMALL and
+ *      over all of them. Results go to adc0_filter_bench. Must run before
+ *      the LETIMER0 is started, with the ADC in its default setup.
+ */
+void ADC0_Filter_Benchmark(void)
+{
+  static const uint16_t sizes[ADC0_FILTER_BENCH_SIZES] = {
+    ADC0_FILTER_BENCH_SMALL, ADC0_FILTER_BENCH_LARGE
+  };
+  volatile int32_t reduced_q = 0;
+  filter_kind kind;
+  uint32_t start = 0;
+  uint16_t cnt;
+  uint8_t size;
+
+  /* Polled burst straight into the DMA buffer */
+  ADC_Start(ADC0, adcStartSingle);
+  for(cnt = 0; cnt < ADC0_FILTER_BENCH_LARGE; cnt++) {
+    while(!(ADC0->IF & ADC_IFS_SINGLE));
+    ADC_IntClear(ADC0, ADC_IFC_SINGLE);
+    ADC0_DMArambuffer[cnt] = ADC0->SINGLEDATA;
+  }
+  ADC0->CMD = ADC_CMD_SINGLESTOP;
+
+  for(kind = FILTER_MEAN; kind < FILTER_COUNT; kind++) {
+    for(size = 0; size < ADC0_FILTER_BENCH_SIZES; size++) {
+      start = Profile_Get_Cycles();
+      reduced_q = Filter_Reduce(kind, ADC0_DMArambuffer, sizes[size]);
+      adc0_filter_bench[kind].cycles[size] = Profile_Get_Cycles() - start;
+    }
+    adc0_filter_bench[kind].temp_mC = Temp_Ovs_To_mC(reduced_q,\
+                                                     FILTER_Q_BITS);
+  }
+
+  return;
+}
+
+/* Function: ADC0_Stats_Init(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *    - Clear the burst and the reading statistics. The reading EMA uses
+ *      STATS_EMA_SHIFT.
+ */
+void ADC0_Stats_Init(void)
+{
+  Stats_Init(&adc0_burst_stats, STATS_EMA_SHIFT);
+  Stats_Init(&adc0_reading_stats, STATS_EMA_SHIFT);
+
+  return;
+}
+
+/* Function: ADC0_Stats_Add_Reading(int32_t temp_mC)
+ * Parameters:
+ *    temp_mC - the new reading in milli degrees
+ * Return:
+ *    void
+ * Description:
+ *    - Feed a reading to the long running statistics (drift, EMA).
+ */
+void ADC0_Stats_Add_Reading(int32_t temp_mC)
+{
+  adc0_last_reading_mC = temp_mC;
+  Stats_Add_Sample(&adc0_reading_stats, temp_mC);
+
+  return;
+}
+
+/* Function: ADC0_Stats_Summary(stats_summary *summary)
+ * Parameters:
+ *    summary - filled with the summary of the last reading
+ * Return:
+ *    void
+ * Description:
+ *    - Mean, spread and noise of the last burst plus the EMA of the
+ *      readings, in centi degrees. The slope of the sensor is negative,
+ *      so the smallest code is the highest temperature.
+ */
+void ADC0_Stats_Summary(stats_summary *summary)
+{
+  uint32_t std_dev_mC = ADC0_Burst_Std_Dev_mC();
+
+  summary->mean_cC = Temp_Ovs_To_mC(adc0_burst_stats.mean_q, STATS_Q_BITS)/10;
+  summary->min_cC = Temp_Code_To_mC(adc0_burst_stats.max)/10;
+  summary->max_cC = Temp_Code_To_mC(adc0_burst_stats.min)/10;
+  summary->std_dev_cC = std_dev_mC/10;
+  summary->ema_cC = (adc0_reading_stats.ema_q >> STATS_Q_BITS)/10;
+  summary->count = adc0_burst_stats.count;
+
+  return;
+}
+
+/* Function: ADC0_Burst_Std_Dev_mC(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    - the std. dev. of the samples behind the last reading, in mC
+ * Description:
+ *    - Scale the std. dev. of the raw codes by the sensor slope.
+ */
+uint32_t ADC0_Burst_Std_Dev_mC(void)
+{
+  return (((uint64_t)Stats_Std_Dev(&adc0_burst_stats) * TEMP_SLOPE_MC_Q10)\
+          >> (TEMP_Q_BITS + STATS_Q_BITS));
+}
@@ -11,8 +11,17 @@
 #include "em_adc.h"
 #include "em_cmu.h"
 #include "em_dma.h"
+#include "em_prs.h"
+#include "em_timer.h"
+#include "em_msc.h"
 #include "dmactrl.h"
+#include "dma_shared.h"
 #include "gpio.h"
+#include "profile.h"
+#include "temperature.h"
+#include "sensor_stats.h"
+#include "robust_filter.h"
+#include "temp_path.h"
 
 //#define CALC_PRESCALE_VAL 24
 #define LOWER_TEMP_BOUND 15
@@ -21,8 +30,14 @@
 #define ADC_SLEEP_MODE 1
 
 /*DMA*/
-#define MAX_CONVERSION 750
-#define ADC0_DMA_Channel 0
+/* Samples per reading: the fixed burst, and the cap of the oversample
+ * command and of ADAPT_MAX_CONVERSIONS.
+ */
+#define MAX_CONVERSION 500
+
+/* The buffer is larger: ADC0_Filter_Benchmark() fills all of it */
+#define ADC0_BUFFER_SAMPLES ADC0_FILTER_BENCH_LARGE
+#define ADC0_DMA_Channel DMA_CHANNEL_ADC0
 #define DEF_HPROT_VAL 0
 #define CALC_PRESCALE_VAL 9
 #define CONFIG_ADC_CHNL acmpChannel6
@@ -35,14 +50,223 @@
 #define ADC0_WARMUP_OPTION adcWarmupNormal
 #define ADC0_FILTER_TYPE adcLPFilterBypass
 
+/* Ping-pong DMA: samples per half buffer. The block has to fit in one
+ * DMA cycle (<= 1024); a reading is rounded up to whole blocks.
+ */
+#define ADC0_PINGPONG_BLOCK 125
+
+/* LETIMER0 -> PRS -> TIMER2 -> PRS -> ADC0 -> DMA chain: the LETIMER0
+ * underflow pulses PRS channel ADC0_PRS_GATE_CHANNEL, which starts
+ * TIMER2. Every TIMER2 overflow pulses ADC0_PRS_CHANNEL and starts one
+ * conversion, so a whole burst of adc0_conversions samples runs at
+ * ADC0_PRS_BURST_HZ without the core. The core wakes once, when the DMA
+ * has the burst, stops TIMER2 and publishes the reading. EM1 is only held
+ * from the COMP1 ahead of the underflow to the end of the burst.
+ */
+#define ADC0_PRS_GATE_CHANNEL 0
+#define ADC0_PRS_GATE_SEL timerPRSSELCh0
+#define ADC0_PRS_CHANNEL 1
+#define ADC0_PRS_SEL adcPRSSELCh1
+#define ADC0_PRS_TIMER TIMER2
+#define ADC0_PRS_TIMER_CLOCK cmuClock_TIMER2
+
+/* Well above one conversion (ADC0_CONV_CYCLES of the ADC0_Init() clock,
+ * about 12 us): 500 samples take 25 ms
+ */
+#define ADC0_PRS_BURST_HZ 20000
+
+/* Multi-channel acquisition: temperature, VDD/3 and the light sensor are
+ * converted back to back, ADC0_SEQ_SAMPLES each, into their own slice of
+ * ADC0_DMArambuffer. The ADC0 scan mode only takes the external pins, so
+ * the single mode runs in repeat and one DMA scatter-gather run switches
+ * the channels itself: between the slices it writes the next SINGLECTRL.
+ * The first ADC0_SEQ_SETTLE samples of each slice are still from the
+ * previous channel (or the warm-up) and are dropped. The core wakes once,
+ * at the end. The light sensor output has to be wired to ADC0_LIGHT_INPUT
+ * (PD6); it is converted with the 1.25 V gain/offset calibration, a few
+ * codes off on the VDD reference.
+ */
+#define ADC0_SEQ_SAMPLES 32
+#define ADC0_SEQ_SETTLE 2
+#define ADC0_SEQ_SLICE (ADC0_SEQ_SETTLE + ADC0_SEQ_SAMPLES)
+#define ADC0_LIGHT_INPUT adcSingleInputCh6
+#define ADC0_VDD_DIVIDER 3
+#define ADC0_REF_MV 1250
+
+typedef enum adc_sequence_channel {
+  ADC_SEQ_TEMP = 0,
+  ADC_SEQ_VDD = 1,
+  ADC_SEQ_LIGHT = 2,
+  ADC_SEQ_CHANNELS = 3
+} adc_seq_chnl;
+
+/* Hardware oversampling: one OVS conversion replaces the software
+ * average. The result is 16 bits wide, i.e. 4 fractional bits on top
+ * of the 12 bit code.
+ */
+#define ADC0_OVS_RATE adcOvsRateSel512
+#define ADC0_OVS_FRAC_BITS 4
+
+/* ADC clock cycles for one 12 bit conversion: acquisition + 12 + 1 */
+#define ADC0_ACQ_CYCLES 4
+#define ADC0_CONV_CYCLES (ADC0_ACQ_CYCLES + 13)
+
+/* Supply current figures from the EFM32LG datasheet, used to estimate
+ * the charge drawn per reading.
+ */
+#define EM0_CURRENT_UA_PER_MHZ 211
+#define EM1_CURRENT_UA_PER_MHZ 63
+#define ADC0_CURRENT_UA 275
+
+/* Readings taken per strategy by ADC0_Benchmark() */
+#define ADC0_BENCH_READINGS 16
+
+/* Reduction applied to the DMA buffer in cb_ADC0_DMA. Can be changed at
+ * runtime through adc0_filter.
+ */
+#define ADC0_FILTER FILTER_MEAN
+
+/* Buffer sizes timed by ADC0_Filter_Benchmark() */
+#define ADC0_FILTER_BENCH_SIZES 2
+#define ADC0_FILTER_BENCH_SMALL 500
+#define ADC0_FILTER_BENCH_LARGE 750
+
+/* Offset and gain calibration of the single conversion on ADC0_REFERENCE.
+ * Measured once against VSS and Vref/2, then loaded from flash on every
+ * later boot. Bump the version when the record layout changes.
+ */
+#define ADC0_CAL_MAGIC 0x43434441 /* "ADCC" */
+#define ADC0_CAL_VERSION 1
+#define ADC0_CAL_OVS_RATE adcOvsRateSel256
+#define ADC0_CAL_GAIN_TARGET (1 << 15) /* Vref/2 as a 16 bit OVS result */
+#define ADC0_CAL_SINGLE_MASK (_ADC_CAL_SINGLEOFFSET_MASK\
+                              | _ADC_CAL_SINGLEGAIN_MASK)
+
+typedef enum adc_calibration_source {
+  ADC_CAL_FACTORY = 0,  /* DEVINFO values only */
+  ADC_CAL_FLASH = 1,
+  ADC_CAL_MEASURED = 2
+} adc_cal_source;
+
+typedef struct adc_calibration {
+  uint32_t single_cal;              /* ADC0->CAL single offset/gain fields */
+  adc_cal_source source;
+  MSC_Status_TypeDef store_status;  /* of the flash write, if any */
+  uint32_t cycles;                  /* boot time spent in ADC0_Cal_Init */
+} adc_cal;
+
+/* Cost of the last temperature reading, in core cycles and in us.
+ * Cycles are only counted while the core is awake.
+ */
+typedef struct adc_wake_profile {
+  uint32_t cycles;
+  uint32_t time_us;
+  uint16_t wakeups;
+} adc_profile;
+
+/* The ways a temperature reading can be acquired */
+typedef enum adc_acquisition_strategy {
+  ADC_STRATEGY_POLLED = 0,
+  ADC_STRATEGY_PINGPONG = 1,
+  ADC_STRATEGY_OVERSAMPLE = 2,
+  ADC_STRATEGY_COUNT = 3
+} adc_strategy;
+
+/* Per strategy averages over ADC0_BENCH_READINGS readings */
+typedef struct adc_benchmark_result {
+  uint32_t awake_us;
+  uint32_t busy_us;
+  uint32_t charge_nC;
+  float mean;
+  float variance;
+} adc_bench;
+
+/* Fixed point vs. float conversion over the whole 12 bit code range */
+typedef struct temp_conv_benchmark {
+  int32_t max_err_mC;
+  uint32_t fixed_cycles;
+  uint32_t float_cycles;
+} temp_conv_bench;
+
+/* Core cycles per kernel for each benchmarked buffer size, and the
+ * reading it produced from the large buffer
+ */
+typedef struct filter_benchmark {
+  uint32_t cycles[ADC0_FILTER_BENCH_SIZES];
+  int32_t temp_mC;
+} filter_bench;
+
+extern adc_cal adc0_cal;
+extern filter_kind adc0_filter;
+extern filter_bench adc0_filter_bench[FILTER_COUNT];
+extern sensor_stats adc0_burst_stats;
+extern sensor_stats adc0_seq_stats[ADC_SEQ_CHANNELS];
+extern uint32_t adc0_vdd_mV;
+extern sensor_stats adc0_reading_stats;
+extern uint16_t adc0_conversions;
+extern int32_t adc0_last_reading_mC;
+extern int32_t conversion_val;
+extern volatile int16_t ADC0_DMArambuffer[ADC0_BUFFER_SAMPLES];
+extern adc_profile adc0_profile;
+extern temp_conv_bench adc0_conv_bench;
+extern adc_bench adc0_bench[ADC_STRATEGY_COUNT];
+extern volatile bool adc0_reading_done;
+extern float temp_sense_output;
+
 void ADC0_Init(void);
 
+void ADC0_Cal_Init(void);
+
+uint32_t ADC0_Calibrate(void);
+
 void cb_ADC0_DMA(unsigned int channel, bool primary, void *user);
 
 void ADC0_DMA_Setup(void);
 
 void DMA_Initialize(void);
 
+void ADC0_PingPong_Init(void);
+
+void ADC0_PingPong_Start(void);
+
+void cb_ADC0_PingPong(unsigned int channel, bool primary, void *user);
+
+void ADC0_PRS_Init(void);
+
+void ADC0_PRS_Arm(void);
+
+void cb_ADC0_PRS(unsigned int channel, bool primary, void *user);
+
+void ADC0_Scan_Init(void);
+
+void ADC0_Scan_Start(void);
+
+void cb_ADC0_Scan(unsigned int channel, bool primary, void *user);
+
+volatile int16_t *ADC0_Scan_Buffer(adc_seq_chnl seq_chnl);
+
+void ADC0_Oversample_Init(ADC_OvsRateSel_TypeDef rate);
+
+void ADC0_Oversample_Start(void);
+
+uint32_t ADC0_Busy_Time_us(adc_strategy strategy);
+
+void ADC0_Benchmark(void);
+
+void ADC0_Conv_Benchmark(void);
+
+void ADC0_Filter_Benchmark(void);
+
+void ADC0_Stats_Init(void);
+
+void ADC0_Stats_Add_Reading(int32_t temp_mC);
+
+void ADC0_Stats_Summary(stats_summary *summary);
+
+uint32_t ADC0_Burst_Std_Dev_mC(void);
+
+float Get_Avg_Temperature(void);
+
 float convertToCelsius(int32_t adcSample);
 
 void Power_Up_Peripheral(void);
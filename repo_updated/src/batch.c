@@ -0,0 +1,65 @@
+/*
+ * batch.c
+ *
+ *  Created on: Apr 26, 2017
+ *      Author: vidursarin
+ */
+
+#include "batch.h"
+
+#define BATCH_DT_MAX_10MS 0xFFFF
+
+void Batch_Init(tele_batch *batch, uint8_t k, uint32_t max_latency_ms)
+{
+  batch->count = 0;
+  batch->last_ms = 0;
+  batch->max_latency_ms = max_latency_ms;
+  Batch_Set_K(batch, k);
+
+  return;
+}
+
+void Batch_Set_K(tele_batch *batch, uint8_t k)
+{
+  if(k == 0) {
+    k = 1;
+  } else if(k > LINK_BATCH_MAX) {
+    k = LINK_BATCH_MAX;
+  }
+  batch->k = k;
+
+  return;
+}
+
+bool Batch_Add(tele_batch *batch, uint32_t time_ms, int16_t temp_cC,\
+               uint8_t flags)
+{
+  link_batch_entry *entry = &batch->msg.entry[batch->count];
+  uint32_t dt_10ms = 0;
+  uint32_t period_ms = 0;
+
+  if(batch->count == 0) {
+    batch->msg.base_ms = time_ms;
+  }
+  if(batch->last_ms != 0) {
+    period_ms = time_ms - batch->last_ms;
+  }
+
+  /* dt saturates after ~11 minutes; the latency bound flushes long before */
+  dt_10ms = (time_ms - batch->msg.base_ms) / 10;
+  if(dt_10ms > BATCH_DT_MAX_10MS) {
+    dt_10ms = BATCH_DT_MAX_10MS;
+  }
+
+  entry->dt_10ms = dt_10ms;
+  entry->temp_cC = temp_cC;
+  entry->flags = flags;
+  batch->count++;
+  batch->last_ms = time_ms;
+
+  if(batch->count >= batch->k) {
+    return true;
+  }
+
+  return (time_ms - batch->msg.base_ms) + period_ms > batch->max_latency_ms;
+}
@@ -0,0 +1,78 @@
+/*
+ * batch.h
+ *
+ *  Created on: Apr 26, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_BATCH_H_
+#define SRC_BATCH_H_
+
+#include<stdint.h>
+#include<stdbool.h>
+#include "link_proto.h"
+
+typedef struct telemetry_batch {
+  link_batch_msg msg;
+  uint8_t count;
+  uint8_t k;                  /* readings per frame */
+  uint32_t max_latency_ms;    /* oldest reading waits at most this long */
+  uint32_t last_ms;
+} tele_batch;
+
+/* Function: Batch_Init(tele_batch *batch, uint8_t k,
+ *                      uint32_t max_latency_ms)
+ * Parameters:
+ *      - tele_batch *batch: the batch to set up, empty
+ *      - uint8_t k: readings per frame, 1 to LINK_BATCH_MAX
+ *      - uint32_t max_latency_ms: flush early to keep within this
+ * Return:
+ *      void
+ */
+void Batch_Init(tele_batch *batch, uint8_t k, uint32_t max_latency_ms);
+
+/* Function: Batch_Set_K(tele_batch *batch, uint8_t k)
+ * Parameters:
+ *      - tele_batch *batch: the batch
+ *      - uint8_t k: readings per frame, clamped to 1..LINK_BATCH_MAX
+ * Return:
+ *      void
+ * Description:
+ *      - Takes effect from the next Batch_Add(); a batch already over
+ *        the new size is flushed by it.
+ */
+void Batch_Set_K(tele_batch *batch, uint8_t k);
+
+/* Function: Batch_Add(tele_batch *batch, uint32_t time_ms, int16_t temp_cC,
+ *                     uint8_t flags)
+ * Parameters:
+ *      - tele_batch *batch: the batch
+ *      - uint32_t time_ms: time of the reading, since boot
+ *      - int16_t temp_cC, uint8_t flags: the reading
+ * Return:
+ *      - true if the batch has to go out now: it holds k readings, or
+ *        waiting one more period (going by the last one) would take the
+ *        first reading past max_latency_ms
+ */
+bool Batch_Add(tele_batch *batch, uint32_t time_ms, int16_t temp_cC,\
+               uint8_t flags);
+
+/* Function: Batch_Length(const tele_batch *batch)
+ * Return:
+ *      - payload bytes of the LINK_MSG_BATCH frame
+ */
+static inline uint8_t Batch_Length(const tele_batch *batch)
+{
+  return LINK_BATCH_LEN(batch->count);
+}
+
+/* Function: Batch_Reset(tele_batch *batch)
+ * Description:
+ *      - Empty the batch once it has been sent.
+ */
+static inline void Batch_Reset(tele_batch *batch)
+{
+  batch->count = 0;
+}
+
+#endif /* SRC_BATCH_H_ */
@@ -10,7 +10,7 @@
 
 debug_buf Alloc_Buffer(c_buf *buffer, uint8_t size)
 {
-  buffer->buf_start = (c_buf *)malloc(sizeof(uint8_t) * size);
+  buffer->buf_start = (uint8_t *)malloc(sizeof(uint8_t) * size);
   buffer->buf_end = buffer->buf_start + (sizeof(uint8_t) * (size-1));
  
   /* By default, set all the elements of the array to the null char. */
@@ -31,41 +31,28 @@ debug_buf add_to_buffer(c_buf *buffer, void *data, uint8_t multiplier)
     return NULL_RETURN;
   }
 
-  if(buffer->overflow == true) {
-    /* Since the overflow flag is set, we need to do a 
-     * check every time that we try and add data to the 
-     * buffer.
-     */
-    uint8_t chk_data;
-    memcpy(&chk_data, buffer->head, multiplier);
-    
-    if(chk_data != '\0') {
-    /* There isn't any space, exit! */
+  /* Full is decided by the count alone: a stored zero byte is data */
+  if((buffer->elements + multiplier) > buffer->size_of_buffer) {
 #ifdef DEBUG_CIRC_BUF
-      printf("Position not empty, exit!\n");
+    printf("Not enough space, exit!\n");
 #endif
-      return BUFFER_FULL;
-    } else {
-      /* Valid: We have space, enter the data, just pass through */
-#ifdef DEBUG_CIRC_BUF
-      printf("Enter the data!\n");
-#endif
-    }
+    return BUFFER_FULL;
   }
 
-  buffer->underflow = (buffer->elements == 0) ? true:false;
-  memcpy(buffer->head, data, multiplier);
-  buffer->head = buffer->head + multiplier;
-
-  /* Check if the bounds of the buffer have been surpassed.
-   * If yes, move the head pointer to the next element in the 
-   * memory & set the overflow flag
-   */
-  if(buffer->head > buffer->buf_end) {
-    buffer->head = buffer->buf_start;
-    buffer->overflow = true;
+  /* Copy up to the end of the buffer, the rest from the start */
+  uint8_t to_end = (buffer->buf_end - buffer->head) + 1;
+  if(multiplier < to_end) {
+    memcpy(buffer->head, data, multiplier);
+    buffer->head = buffer->head + multiplier;
+  } else {
+    memcpy(buffer->head, data, to_end);
+    memcpy(buffer->buf_start, (uint8_t *)data + to_end, multiplier - to_end);
+    buffer->head = buffer->buf_start + (multiplier - to_end);
   }
+
   buffer->elements = buffer->elements + multiplier;
+  buffer->underflow = false;
+  buffer->overflow = (buffer->elements == buffer->size_of_buffer);
 
   return SUCCESS;
 }
@@ -76,22 +63,29 @@ debug_buf remove_from_buffer(c_buf *buffer, void *ret_data, uint8_t multiplier)
     return NULL_RETURN;
   }
 
-  buffer->underflow = (buffer->elements == 0) ? true:false;
-  if(buffer->underflow == true) {
-  /* The underflow flag is set, there is nothing to remove, EXIT! */
+  if(buffer->elements < multiplier) {
+  /* Not that much in the buffer, there is nothing to remove, EXIT! */
 #ifdef DEBUG_CIRC_BUF
     printf("Nothing to remove from an empty buffer\n");
 #endif
     return BUFFER_EMPTY;
   }
 
-  uint8_t null_data = '\0';
+  /* Copy up to the end of the buffer, the rest from the start */
+  uint8_t to_end = (buffer->buf_end - buffer->tail) + 1;
+  if(multiplier < to_end) {
+    memcpy(ret_data, buffer->tail, multiplier);
+    buffer->tail = buffer->tail + multiplier;
+  } else {
+    memcpy(ret_data, buffer->tail, to_end);
+    memcpy((uint8_t *)ret_data + to_end, buffer->buf_start,\
+           multiplier - to_end);
+    buffer->tail = buffer->buf_start + (multiplier - to_end);
+  }
 
-  /* Copy a null char to the empty data space */
-  memcpy(ret_data, buffer->tail, multiplier);
-  memset(buffer->tail, '\0', multiplier);
-  buffer->tail = buffer->tail + multiplier;
   buffer->elements = buffer->elements - multiplier;
+  buffer->underflow = (buffer->elements == 0);
+  buffer->overflow = false;
 
   return SUCCESS;
 }
@@ -100,7 +94,7 @@ debug_buf remove_from_buffer(c_buf *buffer, void *ret_data, uint8_t multiplier)
 void Debug_Buffer(c_buf *buffer, uint8_t size)
 {
 
-  void *temp_buffer = buffer->buf_start;
+  uint8_t *temp_buffer = buffer->buf_start;
   uint8_t data = 0;
   uint8_t count = 0;
   do{
@@ -16,20 +16,20 @@
 
 //#define DEBUG_CIRC_BUF
 
+/* Byte buffer with the element size given per call. For queues of one
+ * element type use TYPED_RING_DECLARE() (typed_ring.h) instead.
+ */
 typedef struct circular_buffer {
-  void *buf_start;
-  void *buf_end;
-  void *head;
-  void *tail;
+  uint8_t *buf_start;
+  uint8_t *buf_end;
+  uint8_t *head;
+  uint8_t *tail;
   uint8_t size_of_buffer;
   uint8_t elements;
   bool underflow;
   bool overflow;
 } c_buf;
 
-/* A globally defined buffer */
-c_buf buffer;
-
 typedef enum debug_circular_buffer {
   NULL_RETURN = 0,
   SUCCESS = 1,
@@ -62,6 +62,8 @@ debug_buf Alloc_Buffer(c_buf *buffer, uint8_t size);
  * Description: 
  *      - Use this function to add a value to a memory location that is 
  *        allocated to the circular buffer.
+ *      - BUFFER_FULL if there is no room for multiplier bytes; the
+ *        element count decides, not the contents of the buffer.
  */
 debug_buf add_to_buffer(c_buf *buffer, void *data, uint8_t multiplier);
 
@@ -0,0 +1,27 @@
+/*
+ * crc.c
+ *
+ *  Created on: Apr 19, 2017
+ *      Author: vidursarin
+ */
+
+#include "crc.h"
+
+/* crc << 4 ^ crc_table[top nibble] */
+static const uint16_t crc16_table[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t Crc16_Update(uint16_t crc, const void *data, uint32_t len)
+{
+  const uint8_t *byte = data;
+
+  while(len--) {
+    crc = (crc << 4) ^ crc16_table[(crc >> 12) ^ (*byte >> 4)];
+    crc = (crc << 4) ^ crc16_table[(crc >> 12) ^ (*byte & 0x0F)];
+    byte++;
+  }
+
+  return crc;
+}
@@ -0,0 +1,29 @@
+/*
+ * crc.h
+ *
+ *  Created on: Apr 19, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_CRC_H_
+#define SRC_CRC_H_
+
+#include<stdint.h>
+
+/* CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, no reflection */
+#define CRC16_INIT 0xFFFF
+
+/* Function: Crc16_Update(uint16_t crc, const void *data, uint32_t len)
+ * Parameters:
+ *      - uint16_t crc: CRC16_INIT, or the result of the previous call
+ *      - const void *data: bytes to add
+ *      - uint32_t len: number of bytes
+ * Return:
+ *      - the updated CRC
+ * Description:
+ *      - Nibble table implementation: 32 bytes of table, two lookups
+ *        per byte. Can be called in pieces over a message.
+ */
+uint16_t Crc16_Update(uint16_t crc, const void *data, uint32_t len);
+
+#endif /* SRC_CRC_H_ */
@@ -0,0 +1,26 @@
+/*
+ * dma_shared.c
+ *
+ *  Created on: Apr 24, 2017
+ *      Author: vidursarin
+ */
+#include "dma_shared.h"
+
+static bool dma_controller_ready = false;
+
+void DMA_Controller_Init(void)
+{
+  static DMA_Init_TypeDef Init_DMA = {
+    .controlBlock = dmaControlBlock,
+    .hprot = 0
+  };
+
+  if(dma_controller_ready == false) {
+    DMA_Init(&Init_DMA);
+    dma_controller_ready = true;
+  }
+
+  NVIC_EnableIRQ(DMA_IRQn);
+
+  return;
+}
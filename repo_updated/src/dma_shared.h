@@ -0,0 +1,33 @@
+/*
+ * dma_shared.h
+ *
+ *  Created on: Apr 24, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_DMA_SHARED_H_
+#define SRC_DMA_SHARED_H_
+
+#include "em_device.h"
+#include "em_dma.h"
+#include "dmactrl.h"
+
+/* Channel map; every user of the controller takes a channel from here */
+#define DMA_CHANNEL_ADC0        0
+#define DMA_CHANNEL_LEUART0_TX  1
+#define DMA_CHANNEL_LEUART0_RX  2
+
+/* Function: DMA_Controller_Init(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *      - Initialize the DMA controller the first time it is called and
+ *        do nothing after that. DMA_Init() resets every channel, so the
+ *        ADC and the LEUART call this instead of DMA_Init() to avoid
+ *        cancelling each other's transfers.
+ */
+void DMA_Controller_Init(void);
+
+#endif /* SRC_DMA_SHARED_H_ */
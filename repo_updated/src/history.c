@@ -0,0 +1,75 @@
+/*
+ * history.c
+ *
+ *  Created on: Apr 23, 2017
+ *      Author: vidursarin
+ */
+
+#include "history.h"
+#include "typed_ring.h"
+
+/* Keeps the record accesses inside the sequence number updates */
+#ifndef HISTORY_BARRIER
+#define HISTORY_BARRIER() __DMB()
+#endif
+
+TYPED_RING_DECLARE(history_ring, History_Ring, history_rec, HISTORY_LEN)
+
+static history_ring history;
+static volatile uint32_t history_seq = 0;   /* odd while being written */
+
+void History_Init(void)
+{
+  history_seq++;
+  History_Ring_Init(&history);
+  history_seq++;
+
+  return;
+}
+
+void History_Add(uint32_t time_ms, int32_t temp_mC, uint8_t flags)
+{
+  history_rec rec;
+
+  rec.time_ms = time_ms;
+  rec.temp_cC = (int16_t)(temp_mC / 10);
+  rec.flags = flags;
+
+  /* Overwriting moves the tail too, so readers go by the sequence */
+  history_seq++;
+  HISTORY_BARRIER();
+
+  History_Ring_Push_Overwrite(&history, &rec);
+
+  HISTORY_BARRIER();
+  history_seq++;
+
+  return;
+}
+
+uint16_t History_Snapshot(history_rec *out, uint16_t max)
+{
+  uint32_t seq = 0;
+  uint16_t count = 0;
+  uint16_t first = 0;
+  uint16_t cnt;
+
+  do {
+    seq = history_seq;
+    HISTORY_BARRIER();
+
+    count = History_Ring_Count(&history);
+    first = 0;
+    if(count > max) {
+      first = count - max;
+      count = max;
+    }
+    for(cnt = 0; cnt < count; cnt++) {
+      out[cnt] = *History_Ring_At(&history, first + cnt);
+    }
+
+    HISTORY_BARRIER();
+  } while((seq & 1) || (seq != history_seq));
+
+  return count;
+}
@@ -0,0 +1,68 @@
+/*
+ * history.h
+ *
+ *  Created on: Apr 23, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_HISTORY_H_
+#define SRC_HISTORY_H_
+
+#include<stdint.h>
+#include<stdbool.h>
+
+/* Readings kept; a power of two. At the default 4.25 s period this is
+ * a bit over 4.5 minutes of history.
+ */
+#define HISTORY_LEN 64
+
+/* Bits of history_rec.flags */
+#define HISTORY_FLAG_LIGHT 0x01   /* ACMP0 (light sensor) output */
+#define HISTORY_FLAG_LED   0x02   /* LED_Status */
+
+/* One reading, 7 bytes */
+typedef struct __attribute__((packed)) history_record {
+  uint32_t time_ms;   /* since boot */
+  int16_t temp_cC;    /* centi degrees C */
+  uint8_t flags;
+} history_rec;
+
+/* Function: History_Init(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *      - Start with an empty window.
+ */
+void History_Init(void);
+
+/* Function: History_Add(uint32_t time_ms, int32_t temp_mC, uint8_t flags)
+ * Parameters:
+ *      - uint32_t time_ms: when the reading was taken
+ *      - int32_t temp_mC: the reading in milli degrees C
+ *      - uint8_t flags: HISTORY_FLAG_*
+ * Return:
+ *      void
+ * Description:
+ *      - Append a reading, overwriting the oldest once the window is
+ *        full. Single writer; meant to be called from the LETIMER0
+ *        handler.
+ */
+void History_Add(uint32_t time_ms, int32_t temp_mC, uint8_t flags);
+
+/* Function: History_Snapshot(history_rec *out, uint16_t max)
+ * Parameters:
+ *      - history_rec *out: filled oldest first
+ *      - uint16_t max: room in out
+ * Return:
+ *      - the number of records copied
+ * Description:
+ *      - Consistent copy of the newest max records in one call. The
+ *        writer bumps a sequence number around every update and the
+ *        copy is retried if it changed, so the reader never has to mask
+ *        the writer's interrupt.
+ */
+uint16_t History_Snapshot(history_rec *out, uint16_t max);
+
+#endif /* SRC_HISTORY_H_ */
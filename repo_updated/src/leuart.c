@@ -7,14 +7,100 @@
 #include "leuart.h"
 #include "sleep_modes.h"
 
-#define DATA_BUFFER_SIZE 5
 #define BAUD_RATE 9600
 #define SEL_SLEEP_MODE    sleepEM3
 #define LEUART_SLEEP_MODE sleepEM2
 //extern uint8_t *data_buffer[DATA_BUFFER_SIZE];
 extern uint8_t transfer_bytes = 0;
-extern uint8_t counter;
 
+/* Filled by LEUART0_Send(), drained by LEUART0_IRQHandler() */
+SPSC_RING_DEFINE(leuart_tx_ring, LEUART_TX_RING_SIZE);
+
+/* Only touched by the handler: whether it holds the EM2 block */
+static bool leuart_tx_blocked = false;
+
+#ifdef LEUART_TX_DMA
+/* Only touched by the handler: bytes the DMA channel is sending */
+static uint16_t leuart_tx_dma_len = 0;
+#endif
+
+leuart_tx_profile leuart_tx_prof;
+
+/* Sequence number of the next frame to the SAMB11 */
+static uint8_t leuart_tx_seq = 0;
+
+static const uint32_t leuart_rate_baud[LEUART_RATES] = LEUART_RATE_LIST;
+
+/* Rate change: requested with interrupts masked, by the producers or by
+ * the LEUART0 handler once the ring drains, and timed out from the
+ * LETIMER0 period; acked and applied by the LEUART0 handler. While
+ * holding, TX stops at leuart_rate_hold, right after the request frame.
+ */
+static volatile leuart_rate leuart_rate_now = LEUART_RATE_LOW;
+static volatile leuart_rate leuart_rate_asked = LEUART_RATE_LOW;
+static volatile bool leuart_rate_holding = false;
+static volatile bool leuart_rate_acked = false;
+static volatile uint16_t leuart_rate_hold = 0;
+static uint8_t leuart_rate_polls = 0;
+
+/* Only touched by the handler: whether a high rate holds the EM2 block,
+ * since when, and for how long each rate has held it before
+ */
+static bool leuart_rate_blocked = false;
+static uint32_t leuart_rate_blocked_since = 0;
+static uint64_t leuart_rate_blocked_ticks[LEUART_RATES];
+
+/* Bytes queued that make moving up to LEUART_BULK_RATE pay off */
+static uint16_t leuart_bulk_bytes = UINT16_MAX;
+
+/* Frames, bytes and payload bytes committed at each rate */
+static leuart_rate_report leuart_rate_stats[LEUART_RATES];
+leuart_rx_profile leuart_rx_prof;
+
+/* Written by the DMA, read by the handler once the signal frame is in */
+static uint8_t leuart_rx_frame[LEUART_RX_FRAME_LEN];
+static leuart_cmd_handler leuart_rx_handler = NULL;
+
+
+/* Function: LEUART0_Break_Even(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - bytes that have to be queued before a move to LEUART_BULK_RATE
+ *        costs less than sending them at the low rate
+ * Description:
+ *    - Energy in nA * us. Each byte at the bulk rate saves the SAMB11
+ *      most of its receive time and costs the EFM32 EM1 instead of EM2.
+ *      The move costs the request up at the low rate and its ack, then
+ *      the request back down at the bulk rate and its ack, waited for in
+ *      EM1. UINT16_MAX if moving up never pays.
+ */
+static uint16_t LEUART0_Break_Even(void)
+{
+  uint64_t em1_nA = (uint64_t)(CMU_ClockFreqGet(cmuClock_HF) / 1000000)\
+                    * LEUART_EM1_NA_PER_MHZ;
+  uint64_t low_us = 10000000 / leuart_rate_baud[LEUART_RATE_LOW];
+  uint64_t bulk_us = 10000000 / leuart_rate_baud[LEUART_BULK_RATE];
+  uint64_t low_byte = (LEUART_EM2_CURRENT_NA + SAMB11_RX_CURRENT_NA)\
+                      * low_us;
+  uint64_t bulk_byte = (em1_nA + SAMB11_RX_CURRENT_NA) * bulk_us;
+  uint64_t overhead = 0;
+  uint64_t bytes = 0;
+
+  if(bulk_byte >= low_byte) {
+    return UINT16_MAX;
+  }
+
+  /* Up: request and ack on the wire at the low rate */
+  overhead = (LINK_FRAME_LEN(1) + LEUART_RX_FRAME_LEN) * low_byte;
+  /* Down: the same at the bulk rate, plus the turnaround in EM1 */
+  overhead += (LINK_FRAME_LEN(1) + LEUART_RX_FRAME_LEN) * bulk_byte;
+  overhead += em1_nA * LEUART_RATE_ACK_US;
+
+  bytes = (overhead + (low_byte - bulk_byte) - 1) / (low_byte - bulk_byte);
+
+  return (bytes > UINT16_MAX) ? UINT16_MAX : (uint16_t)bytes;
+}
 
 /* Function: void Setup_LEUART(void)
  * Parameters:
@@ -50,6 +136,8 @@ void Setup_LEUART(void)
   /* In order to be cautious, reset the LEUART and start the init. procedures */
   LEUART_Reset(LEUART0);
   LEUART_Init(LEUART0, &init_leuart);
+
+  leuart_bulk_bytes = LEUART0_Break_Even();
   
   /* Enable pins at default location */
   LEUART0->ROUTE = LEUART_ROUTE_RXPEN | LEUART_ROUTE_TXPEN | LEUART_LOCATION;
@@ -62,6 +150,10 @@ void Setup_LEUART(void)
    */
   LEUART0->IEN = LEUART_IEN_TXC;
 
+#ifdef LEUART_TX_DMA
+  Setup_LEUART_DMA();
+#endif
+
   /* Finally enable it */
   LEUART_Enable(LEUART0, leuartEnable);
   NVIC_EnableIRQ(LEUART0_IRQn);
@@ -71,7 +163,7 @@ void Setup_LEUART(void)
    * LEUART will operate in EM2 and higher.
    */
   //blockSleepMode(sleepEM3);
-  blockSleepMode(SEL_SLEEP_MODE);
+  blockSleepMode(SEL_SLEEP_MODE, SLEEP_USER_LEUART);
   return;
 }
 
@@ -81,54 +173,504 @@ void Setup_LEUART(void)
  * Return:
  *      void
  * Description:
- *    - Do the setup for the LEUART to work with DMA
+ *    - Do the setup for the LEUART to transmit with DMA. The channel
+ *      raises no interrupt of its own: the TXC after the last byte of a
+ *      transfer tells the handler it is done.
  */
 void Setup_LEUART_DMA(void)
 {
-  /* Initializing the DMA */
-  static DMA_Init_TypeDef dmaInit = {
-    .controlBlock = dmaControlBlock, 
-    .hprot        = 0
+  /*Setting up DMA channel */
+  static DMA_CfgChannel_TypeDef channelCfg = {
+    .cb         = NULL,
+    .enableInt  = false,
+    .highPri    = false,
+    .select     = DMAREQ_LEUART0_TXBL
   };
 
+  /* Setting up channel descriptor */
+  static DMA_CfgDescr_TypeDef descrCfg = {
+    .arbRate  = dmaArbitrate1,
+    .dstInc   = dmaDataIncNone,
+    .hprot    = 0,
+    .size     = dmaDataSize1,
+    .srcInc   = dmaDataInc1
+  };
+
+  /* Call all the initialization functions now */
+  DMA_Controller_Init();
+  DMA_CfgChannel(DMA_CHANNEL_LEUART0_TX, &channelCfg);
+  DMA_CfgDescr(DMA_CHANNEL_LEUART0_TX, true, &descrCfg);
+
+  /* Let TXBL wake the DMA out of EM2 */
+  LEUART_TxDmaInEM2Enable(LEUART0, true);
+
+  return;
+}
+
+/* Function: LEUART0_Send(const void *data, uint16_t len)
+ * Parameters:
+ *      - const void *data: the frame to send
+ *      - uint16_t len: bytes in the frame
+ * Return:
+ *      - false if the frame did not fit
+ * Description:
+ *    - Producer side of leuart_tx_ring. Pending the LEUART0 interrupt
+ *      starts the transmitter if it is idle; if it is busy the handler
+ *      just finds more data at the next TXC. The handler produces rate
+ *      requests too, so the copy runs with interrupts masked.
+ */
+bool LEUART0_Send(const void *data, uint16_t len)
+{
+  spsc_span span;
+
+  INT_Disable();
+  if(LEUART0_Reserve(len, &span) == false) {
+    INT_Enable();
+    return false;
+  }
+
+  Spsc_Span_Put(&span, 0, data, len);
+  LEUART0_Commit(len);
+  INT_Enable();
+
+  return true;
+}
+
+/* Function: LEUART0_Send_Message(uint8_t type, const void *payload,
+ *                                 uint8_t len)
+ * Parameters:
+ *      - uint8_t type: message type
+ *      - const void *payload, uint8_t len: the message
+ * Return:
+ *      - false if the frame did not fit
+ * Description:
+ *    - Frame on the stack, then one copy into the TX ring. Interrupts
+ *      stay masked from taking the sequence number to the copy, so the
+ *      frames go out in sequence order.
+ */
+bool LEUART0_Send_Message(uint8_t type, const void *payload, uint8_t len)
+{
+  uint8_t frame[LINK_FRAME_LEN(LINK_MAX_PAYLOAD)];
+  uint16_t frame_len = 0;
+
+  if(len > LINK_MAX_PAYLOAD) {
+    return false;
+  }
+
+  INT_Disable();
+
+  /* Bulk: move the link up first, the frame waits for the ack */
+  if(type != LINK_MSG_RATE && leuart_rate_now == LEUART_RATE_LOW &&\
+     (Spsc_Count(&leuart_tx_ring) + LINK_FRAME_LEN(len)) >= leuart_bulk_bytes) {
+    LEUART0_Rate_Request(LEUART_BULK_RATE);
+  }
+
+  frame_len = Link_Encode(frame, type, leuart_tx_seq++, payload, len);
+  if(LEUART0_Send(frame, frame_len) == false) {
+    INT_Enable();
+    return false;
+  }
+  leuart_rate_stats[leuart_rate_now].payload_bytes += len;
+
+  INT_Enable();
+
+  return true;
+}
+
+/* Function: LEUART0_Rate_Request(leuart_rate rate)
+ * Parameters:
+ *      - leuart_rate rate: the rate to ask the SAMB11 for
+ * Return:
+ *      - false if a change is under way or the request did not fit
+ * Description:
+ *    - Queue the request and hold TX right behind it.
+ */
+bool LEUART0_Rate_Request(leuart_rate rate)
+{
+  uint8_t index = rate;
+
+  INT_Disable();
+  if(leuart_rate_holding || rate >= LEUART_RATES || rate == leuart_rate_now) {
+    INT_Enable();
+    return false;
+  }
+
+  if(LEUART0_Send_Message(LINK_MSG_RATE, &index, sizeof(index)) == false) {
+    INT_Enable();
+    return false;
+  }
+
+  leuart_rate_asked = rate;
+  leuart_rate_acked = false;
+  leuart_rate_polls = LEUART_RATE_ACK_POLLS;
+  leuart_rate_hold = leuart_tx_ring.head;
+  leuart_rate_holding = true;
+  INT_Enable();
+
+  return true;
+}
+
+/* Function: LEUART0_Link_Poll(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *    - Rate change timeout, and the fall back to the low rate for when
+ *      the ring drained during a change and the handler could not ask.
+ */
+void LEUART0_Link_Poll(void)
+{
+  INT_Disable();
+  if(leuart_rate_holding) {
+    if(leuart_rate_acked == false) {
+      if(leuart_rate_polls == 0) {
+        /* No ack: stay at the current rate and let TX go again */
+        leuart_rate_holding = false;
+        NVIC_SetPendingIRQ(LEUART0_IRQn);
+      } else {
+        leuart_rate_polls--;
+      }
+    }
+    INT_Enable();
+    return;
+  }
+
+  if(leuart_rate_now != LEUART_RATE_LOW &&\
+     Spsc_Count(&leuart_tx_ring) == 0) {
+    LEUART0_Rate_Request(LEUART_RATE_LOW);
+  }
+  INT_Enable();
+
+  return;
+}
+
+/* Function: LEUART0_Rate_Report(leuart_rate_report report[LEUART_RATES])
+ * Parameters:
+ *      - report: filled in, one entry per rate
+ * Return:
+ *      void
+ * Description:
+ *    - pJ per byte = nA * mV / (bytes per s) on the wire, or, at the
+ *      rates that block EM2, nA * mV * blocked time / payload bytes. The
+ *      framing overhead is the one measured at that rate, or the plain
+ *      temperature frame if nothing has been sent at it yet.
+ */
+void LEUART0_Rate_Report(leuart_rate_report report[LEUART_RATES])
+{
+  uint32_t em1_nA = (CMU_ClockFreqGet(cmuClock_HF) / 1000000)\
+                    * LEUART_EM1_NA_PER_MHZ;
+  uint64_t blocked[LEUART_RATES];
+  uint32_t payload = 0;
+  uint32_t bytes = 0;
+  uint32_t efm32_nA = 0;
+  leuart_rate rate;
+
+  INT_Disable();
+  for(rate = LEUART_RATE_LOW; rate < LEUART_RATES; rate++) {
+    report[rate] = leuart_rate_stats[rate];
+    blocked[rate] = leuart_rate_blocked_ticks[rate];
+  }
+  if(leuart_rate_blocked) {
+    blocked[leuart_rate_now] += Sleep_Clock_Now() - leuart_rate_blocked_since;
+  }
+  INT_Enable();
+
+  for(rate = LEUART_RATE_LOW; rate < LEUART_RATES; rate++) {
+    report[rate].baud = leuart_rate_baud[rate];
+    report[rate].blocked_ms = Sleep_Ticks_To_ms(blocked[rate]);
+
+    payload = report[rate].payload_bytes;
+    bytes = report[rate].bytes;
+    if(payload == 0) {
+      payload = sizeof(link_temp_msg);
+      bytes = LINK_FRAME_LEN(sizeof(link_temp_msg));
+    }
+
+    /* 8N1: ten bits on the wire per byte */
+    report[rate].payload_per_s = ((uint64_t)report[rate].baud * payload)\
+                                 / (10 * (uint64_t)bytes);
+
+    efm32_nA = (rate == LEUART_RATE_LOW) ? LEUART_EM2_CURRENT_NA : em1_nA;
+    if(report[rate].blocked_ms != 0 && report[rate].payload_bytes != 0) {
+      report[rate].efm32_pJ = ((uint64_t)efm32_nA * LEUART_SUPPLY_MV\
+                               * report[rate].blocked_ms)\
+                              / (1000 * (uint64_t)report[rate].payload_bytes);
+    } else {
+      report[rate].efm32_pJ = ((uint64_t)efm32_nA * LEUART_SUPPLY_MV)\
+                              / report[rate].payload_per_s;
+    }
+    report[rate].samb11_pJ = ((uint64_t)SAMB11_RX_CURRENT_NA\
+                              * LEUART_SUPPLY_MV)\
+                             / report[rate].payload_per_s;
+  }
+
+  return;
+}
+
+/* Function: LEUART0_Reserve(uint16_t len, spsc_span *span)
+ * Parameters:
+ *      - uint16_t len: bytes in the frame
+ *      - spsc_span *span: filled with the space in the TX ring
+ * Return:
+ *      - false if the frame does not fit
+ * Description:
+ *    - Producer side, zero copy: the caller writes the frame into span.
+ */
+bool LEUART0_Reserve(uint16_t len, spsc_span *span)
+{
+  return Spsc_Reserve(&leuart_tx_ring, len, span);
+}
+
+/* Function: LEUART0_Commit(uint16_t len)
+ * Parameters:
+ *      - uint16_t len: bytes of the reserved frame
+ * Return:
+ *      void
+ * Description:
+ *    - Make the frame visible to the handler and start the transmitter
+ *      if it is idle.
+ */
+void LEUART0_Commit(uint16_t len)
+{
+  leuart_tx_prof.frames++;
+  leuart_tx_prof.bytes += len;
+  leuart_rate_stats[leuart_rate_now].frames++;
+  leuart_rate_stats[leuart_rate_now].bytes += len;
+
+  Spsc_Commit(&leuart_tx_ring, len);
+  NVIC_SetPendingIRQ(LEUART0_IRQn);
+
+  return;
+}
+
+/* Function: LEUART0_Rate_Apply(leuart_rate rate)
+ * Parameters:
+ *      - leuart_rate rate: the rate to run the LEUART at
+ * Return:
+ *      void
+ * Description:
+ *    - Only from the handler with the transmitter idle. The higher rates
+ *      need the HF clock, so they hold the EM2 block until the link is
+ *      back on the LFXO; the time each one held it goes to its report.
+ */
+static void LEUART0_Rate_Apply(leuart_rate rate)
+{
+  uint32_t now = Sleep_Clock_Now();
+
+  if(leuart_rate_blocked) {
+    leuart_rate_blocked_ticks[leuart_rate_now] += now\
+                                                  - leuart_rate_blocked_since;
+    leuart_rate_blocked_since = now;
+  }
+
+  if(rate == LEUART_RATE_LOW) {
+    CMU_ClockSelectSet(cmuClock_LFB, cmuSelect_LFXO);
+    if(leuart_rate_blocked) {
+      unblockSleepMode(LEUART_SLEEP_MODE, SLEEP_USER_LEUART);
+      leuart_rate_blocked = false;
+    }
+  } else {
+    if(leuart_rate_blocked == false) {
+      blockSleepMode(LEUART_SLEEP_MODE, SLEEP_USER_LEUART);
+      leuart_rate_blocked = true;
+      leuart_rate_blocked_since = now;
+    }
+    CMU_ClockSelectSet(cmuClock_LFB, cmuSelect_CORELEDIV2);
+  }
+
+  LEUART_BaudrateSet(LEUART0, 0, leuart_rate_baud[rate]);
+  leuart_rate_now = rate;
+
+  return;
+}
+
+/* Function: LEUART0_Rate_Switch(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - false while TX has to stay on hold for a rate change
+ * Description:
+ *    - Switch once the SAMB11 has acked and everything up to the request
+ *      is out on the wire.
+ */
+static bool LEUART0_Rate_Switch(void)
+{
+  if(leuart_rate_holding == false) {
+    return true;
+  }
+
+  if(leuart_rate_acked && leuart_tx_ring.tail == leuart_rate_hold &&\
+     (LEUART0->STATUS & LEUART_STATUS_TXC)) {
+    LEUART0_Rate_Apply(leuart_rate_asked);
+    leuart_rate_acked = false;
+    leuart_rate_holding = false;
+    return true;
+  }
+
+  return leuart_tx_ring.tail != leuart_rate_hold;
+}
+
+/* Function: LEUART0_Tx_Drained(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *    - The ring is empty and the last byte is out. At a higher rate ask
+ *      for the low one right away rather than at the next LETIMER0
+ *      period, so the EM2 block only lasts as long as the burst.
+ */
+static void LEUART0_Tx_Drained(void)
+{
+  if(leuart_rate_now != LEUART_RATE_LOW && leuart_rate_holding == false &&\
+     Spsc_Count(&leuart_tx_ring) == 0) {
+    LEUART0_Rate_Request(LEUART_RATE_LOW);
+  }
+
+  return;
+}
+
+/* Function: LEUART0_Rx_Arm(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *    - Block the receiver until the next start frame and point the DMA
+ *      at the start of leuart_rx_frame.
+ */
+static void LEUART0_Rx_Arm(void)
+{
+  LEUART0->CMD = LEUART_CMD_RXBLOCKEN | LEUART_CMD_CLEARRX;
+
+  DMA_ActivateBasic(DMA_CHANNEL_LEUART0_RX,\
+      true,\
+      false,\
+      (void *)leuart_rx_frame,\
+      (void *)&LEUART0->RXDATA,\
+      LEUART_RX_FRAME_LEN - 1);
+
+  return;
+}
+
+void LEUART0_Rx_Init(leuart_cmd_handler handler)
+{
   /*Setting up DMA channel */
   static DMA_CfgChannel_TypeDef channelCfg = {
-    .cb         = NULL, 
-    .enableInt  = false,  
+    .cb         = NULL,
+    .enableInt  = false,
     .highPri    = false,
     .select     = DMAREQ_LEUART0_RXDATAV
   };
 
   /* Setting up channel descriptor */
   static DMA_CfgDescr_TypeDef descrCfg = {
-    .arbRate  = dmaArbitrate1, 
-    .dstInc   = dmaDataIncNone,
+    .arbRate  = dmaArbitrate1,
+    .dstInc   = dmaDataInc1,
     .hprot    = 0,
     .size     = dmaDataSize1,
     .srcInc   = dmaDataIncNone
   };
- 
-  /* Configure loop transfer mode */
-  static DMA_CfgLoop_TypeDef loopCfg = {
-    .enable   = true,  
-    .nMinus1  = 0     /* Single transfer per DMA cycle */
-  };
 
-  /* Call all the initialization functions now */
-  DMA_Init(&dmaInit);
-  DMA_CfgChannel(0, &channelCfg);
-  DMA_CfgDescr(0, true, &descrCfg);
-  DMA_CfgLoop(0, &loopCfg);
+  leuart_rx_handler = handler;
+
+  DMA_Controller_Init();
+  DMA_CfgChannel(DMA_CHANNEL_LEUART0_RX, &channelCfg);
+  DMA_CfgDescr(DMA_CHANNEL_LEUART0_RX, true, &descrCfg);
+
+  /* The start frame unblocks the receiver, the signal frame interrupts */
+  LEUART0->STARTFRAME = LEUART_RX_START_FRAME;
+  LEUART0->SIGFRAME = LEUART_RX_SIG_FRAME;
+  LEUART0->CTRL |= LEUART_CTRL_SFUBRX;
+  LEUART_RxDmaInEM2Enable(LEUART0, true);
+
+  LEUART0_Rx_Arm();
+
+  LEUART0->IFC = LEUART_IFC_SIGF;
+  LEUART0->IEN |= LEUART_IEN_SIGF;
+
+  return;
+}
+
+/* Function: LEUART0_Rx_Frame(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *    - Signal frame received. If the DMA has not filled the frame, bytes
+ *      were lost and the frame is dropped; either way the receiver is
+ *      re-armed for the next start frame.
+ */
+static void LEUART0_Rx_Frame(void)
+{
+  uint16_t value = 0;
+
+  leuart_rx_prof.irqs++;
+
+  /* The DMA may still be taking the signal frame out of RXDATA */
+  while(DMA_ChannelEnabled(DMA_CHANNEL_LEUART0_RX) &&\
+        (LEUART0->STATUS & LEUART_STATUS_RXDATAV));
+
+  if(DMA_ChannelEnabled(DMA_CHANNEL_LEUART0_RX)) {
+    DMA_ChannelEnable(DMA_CHANNEL_LEUART0_RX, false);
+    leuart_rx_prof.dropped++;
+  } else if(leuart_rx_frame[0] != LEUART_RX_START_FRAME ||\
+            leuart_rx_frame[LEUART_RX_FRAME_LEN - 1] != LEUART_RX_SIG_FRAME ||\
+            ((leuart_rx_frame[1] | leuart_rx_frame[2] | leuart_rx_frame[3]) & 0x80)) {
+    leuart_rx_prof.dropped++;
+  } else {
+    value = leuart_rx_frame[2] | (leuart_rx_frame[3] << 7);
+    leuart_rx_prof.frames++;
+    if(leuart_rx_frame[1] == LEUART_CMD_LINK_RATE) {
+      if(leuart_rate_holding && value == leuart_rate_asked) {
+        leuart_rate_acked = true;
+      }
+    } else if(leuart_rx_handler != NULL) {
+      leuart_rx_handler(leuart_rx_frame[1], value);
+    }
+  }
+
+  LEUART0_Rx_Arm();
+
+  return;
+}
+
+#ifdef LEUART_TX_DMA
+/* Function: LEUART0_Tx_DMA_Start(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - false if the ring is empty
+ * Description:
+ *    - Hand everything queued, up to the end of the ring storage, to the
+ *      DMA in one transfer. Only called by the handler.
+ */
+static bool LEUART0_Tx_DMA_Start(void)
+{
+  spsc_span span;
+
+  if(LEUART0_Rate_Switch() == false ||\
+     Spsc_Peek(&leuart_tx_ring, &span) == 0) {
+    return false;
+  }
+
+  /* Nothing past a rate request until the switch */
+  if(leuart_rate_holding &&\
+     span.len[0] > (uint16_t)(leuart_rate_hold - leuart_tx_ring.tail)) {
+    span.len[0] = leuart_rate_hold - leuart_tx_ring.tail;
+  }
 
-  /* Activate basic dma cycle using channel0 */
-  DMA_ActivateBasic(0,\
+  leuart_tx_dma_len = span.len[0];
+  DMA_ActivateBasic(DMA_CHANNEL_LEUART0_TX,\
       true,\
       false,\
       (void *)&LEUART0->TXDATA,\
-      (void *)&LEUART0->RXDATA,\
-      0);
+      (void *)span.data[0],\
+      span.len[0] - 1);
 
-  return;
+  return true;
 }
 
 /* Function:void LEUART0_IRQHandler(void)
@@ -137,38 +679,99 @@ void Setup_LEUART_DMA(void)
  * Return:
  *      void
  * Description:
- *    - Interrupt handler for LEUART0. This will be triggered on ever
- *      successful TXC event.
+ *    - Interrupt handler for LEUART0, DMA version. Entered once when
+ *      LEUART0_Commit() pends it, to start the DMA, and once on the TXC
+ *      after the transfer, to release the ring space and either start
+ *      the next transfer or drop the EM2 block and ask for the low rate
+ *      back. A TXC that comes while
+ *      the channel is still running only means the DMA was slow to
+ *      refill TXDATA and is ignored.
  */
 void LEUART0_IRQHandler(void)
 {
-	INT_Disable();
+  uint32_t start = Profile_Get_Cycles();
 
-	uint8_t ret_data = 0;
-	debug_buf debug_handle;
+  /* A command frame from the SAMB11 has landed */
+  if(LEUART0->IF & LEUART0->IEN & LEUART_IF_SIGF) {
+    LEUART0->IFC = LEUART_IFC_SIGF;
+    LEUART0_Rx_Frame();
+  }
 
-	/* Clear the TXC flag */
-	LEUART0->IFC = LEUART_IFC_TXC;
+  /* Clear the TXC flag */
+  LEUART0->IFC = LEUART_IFC_TXC;
+  leuart_tx_prof.irqs++;
 
-  /* Transfer all the data from the data buffer to the
-   * peripheral device. In every other case, continue to 
-   * block in the EM2 case.
-   */
-	if(counter != DATA_BUFFER_SIZE){
-		/* Send the data again */
-		//LEUART0->TXDATA = *data_buffer[counter++];
-		if(remove_from_buffer(&buffer, &ret_data, sizeof(uint8_t)) != BUFFER_EMPTY) {
-			LEUART0->TXDATA = ret_data;
-		}
-	} else {
-		/* unblock in EM2 sleep mode */
-		unblockSleepMode(LEUART_SLEEP_MODE);
-	}
+  if(leuart_tx_dma_len != 0) {
+    if(DMA_ChannelEnabled(DMA_CHANNEL_LEUART0_TX)) {
+      leuart_tx_prof.cycles += Profile_Get_Cycles() - start;
+      return;
+    }
+    Spsc_Consume(&leuart_tx_ring, leuart_tx_dma_len);
+    leuart_tx_dma_len = 0;
+  }
 
-  INT_Enable();
+  if(LEUART0_Tx_DMA_Start()) {
+    if(leuart_tx_blocked == false) {
+      blockSleepMode(LEUART_SLEEP_MODE, SLEEP_USER_LEUART);
+      leuart_tx_blocked = true;
+    }
+  } else if(leuart_tx_blocked && (LEUART0->STATUS & LEUART_STATUS_TXC)) {
+    /* Ring drained and the last byte is out: unblock the EM2 sleep */
+    unblockSleepMode(LEUART_SLEEP_MODE, SLEEP_USER_LEUART);
+    leuart_tx_blocked = false;
+    LEUART0_Tx_Drained();
+  }
 
+  leuart_tx_prof.cycles += Profile_Get_Cycles() - start;
   return;
 }
 
+#else
 
+/* Function:void LEUART0_IRQHandler(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *    - Interrupt handler for LEUART0. This will be triggered on ever
+ *      successful TXC event, and by LEUART0_Send() to start a frame.
+ *      Consumer side of leuart_tx_ring, and the producer of the rate
+ *      request back down, which the producers mask interrupts for.
+ */
+void LEUART0_IRQHandler(void)
+{
+  uint32_t start = Profile_Get_Cycles();
+  uint8_t data = 0;
+
+  /* A command frame from the SAMB11 has landed */
+  if(LEUART0->IF & LEUART0->IEN & LEUART_IF_SIGF) {
+    LEUART0->IFC = LEUART_IFC_SIGF;
+    LEUART0_Rx_Frame();
+  }
 
+  /* Clear the TXC flag */
+  LEUART0->IFC = LEUART_IFC_TXC;
+  leuart_tx_prof.irqs++;
+
+  /* Keep feeding the transmitter while there is data; stay in EM2 for
+   * as long as a byte is on its way.
+   */
+  if(LEUART0_Rate_Switch() && (LEUART0->STATUS & LEUART_STATUS_TXBL) &&\
+     Spsc_Pop(&leuart_tx_ring, &data)) {
+    if(leuart_tx_blocked == false) {
+      blockSleepMode(LEUART_SLEEP_MODE, SLEEP_USER_LEUART);
+      leuart_tx_blocked = true;
+    }
+    LEUART0->TXDATA = data;
+  } else if(leuart_tx_blocked && (LEUART0->STATUS & LEUART_STATUS_TXC)) {
+    /* Ring drained and the last byte is out: unblock the EM2 sleep */
+    unblockSleepMode(LEUART_SLEEP_MODE, SLEEP_USER_LEUART);
+    leuart_tx_blocked = false;
+    LEUART0_Tx_Drained();
+  }
+
+  leuart_tx_prof.cycles += Profile_Get_Cycles() - start;
+  return;
+}
+#endif
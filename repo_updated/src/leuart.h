@@ -16,7 +16,16 @@
 #include "em_dma.h"
 #include "dmactrl.h"
 #include "em_int.h"
-#include "circular_buffer.h"
+#include "spsc_ring.h"
+#include "dma_shared.h"
+#include "profile.h"
+#include "link_proto.h"
+
+/* Hand whole frames to the DMA and take one TXC interrupt per frame.
+ * Comment out for the byte per interrupt path, e.g. to compare the two
+ * with leuart_tx_prof.
+ */
+#define LEUART_TX_DMA
 
 /** LEUART Rx/Tx Port/Pin Location */
 #define LEUART_LOCATION    0
@@ -25,8 +34,224 @@
 #define LEUART_RXPORT      gpioPortD            /* LEUART reception port */
 #define LEUART_RXPIN       5                    /* LEUART reception pin */
 
+/* Bytes queued for transmission; a power of two, room for one full
+ * batch frame plus a rate request
+ */
+#define LEUART_TX_RING_SIZE 128
+
+extern spsc_ring leuart_tx_ring;
+
+/* Cost of the transmitter to the core, in either TX path. The handler
+ * entries and cycles per frame are irqs / frames and cycles / frames;
+ * the cycles leave out the exception entry and exit, about 24 cycles
+ * per entry on the Cortex-M3. Entries for received commands are counted
+ * here too, take leuart_rx_prof.irqs off for the TX side alone.
+ */
+typedef struct {
+  uint32_t frames;      /* frames committed */
+  uint32_t bytes;       /* bytes committed */
+  uint32_t irqs;        /* LEUART0 handler entries */
+  uint32_t cycles;      /* core cycles spent in the handler */
+} leuart_tx_profile;
+
+extern leuart_tx_profile leuart_tx_prof;
+
+/* Command frames from the SAMB11: start frame, command, 14 bit value as
+ * two 7 bit bytes (low first), signal frame. Only the start and signal
+ * frames have the top bit set, so neither can appear inside a frame.
+ */
+#define LEUART_RX_START_FRAME   0xF0
+#define LEUART_RX_SIG_FRAME     0xF1
+#define LEUART_RX_FRAME_LEN     5
+#define LEUART_RX_VALUE_MAX     0x3FFF
+
+#define LEUART_CMD_SAMPLE_PERIOD  0x01  /* value: period in 10 ms units */
+#define LEUART_CMD_OVERSAMPLE     0x02  /* value: conversions per reading */
+#define LEUART_CMD_SENSORS        0x03  /* value: LEUART_SENSOR_* mask */
+#define LEUART_CMD_LINK_RATE      0x04  /* value: leuart_rate the SAMB11
+                                         * has switched to; the ack of a
+                                         * LINK_MSG_RATE request */
+#define LEUART_CMD_BATCH_K        0x05  /* value: readings per batch */
+
+#define LEUART_SENSOR_TEMPERATURE 0x01
+#define LEUART_SENSOR_LIGHT       0x02
+
+/* Link rates. The low rate runs off the LFXO and keeps working in EM2;
+ * the others clock the LEUART from HFCORECLK/2, so EM2 is blocked for
+ * as long as the link stays on them.
+ */
+typedef enum leuart_link_rate {
+  LEUART_RATE_LOW = 0,      /* 9600 */
+  LEUART_RATE_MID = 1,      /* 57600 */
+  LEUART_RATE_HIGH = 2,     /* 115200 */
+  LEUART_RATES = 3
+} leuart_rate;
+
+#define LEUART_RATE_LIST {9600, 57600, 115200}
+
+/* The link moves up to the bulk rate once the bytes queued pass the
+ * break even Setup_LEUART() works out from the currents below, and the
+ * handler asks for the low rate back as soon as the TX ring drains.
+ */
+#define LEUART_BULK_RATE    LEUART_RATE_HIGH
+
+/* LETIMER0 periods to wait for the SAMB11 to ack a rate change */
+#define LEUART_RATE_ACK_POLLS 2
+
+/* SAMB11 turnaround from the end of a rate request to the start of its
+ * ack, for the break even; the EFM32 waits out the one back down in EM1
+ */
+#define LEUART_RATE_ACK_US    2000
+
+/* Supply currents for the energy figures of LEUART0_Rate_Report(). The
+ * EFM32 ones are datasheet typicals; the SAMB11 one is its current with
+ * the UART receiving and the radio idle, measure it for real numbers.
+ */
+#define LEUART_SUPPLY_MV        3000
+#define LEUART_EM2_CURRENT_NA   950
+#define LEUART_EM1_NA_PER_MHZ   63000
+#define SAMB11_RX_CURRENT_NA    1300000
+
+/* What one byte costs at each rate */
+typedef struct {
+  uint32_t baud;
+  uint32_t frames;          /* frames committed at this rate */
+  uint32_t bytes;           /* frame bytes committed at this rate */
+  uint32_t payload_bytes;   /* of those, message payload */
+  uint32_t blocked_ms;      /* time the rate held the EM2 block */
+  uint32_t payload_per_s;   /* effective throughput, framing included */
+  uint32_t efm32_pJ;        /* EFM32 energy per payload byte */
+  uint32_t samb11_pJ;       /* SAMB11 energy per payload byte */
+} leuart_rate_report;
+
+/* Called from the LEUART0 handler with every well formed command */
+typedef void (*leuart_cmd_handler)(uint8_t cmd, uint16_t value);
+
+typedef struct {
+  uint32_t frames;      /* commands handed to the handler */
+  uint32_t dropped;     /* short or malformed frames */
+  uint32_t irqs;        /* SIGF interrupts, one per frame */
+} leuart_rx_profile;
+
+extern leuart_rx_profile leuart_rx_prof;
+
 void Setup_LEUART(void);
 
+/* Function: LEUART0_Rx_Init(leuart_cmd_handler handler)
+ * Parameters:
+ *      - leuart_cmd_handler handler: called with every command
+ * Return:
+ *      void
+ * Description:
+ *      - Arm DMA_CHANNEL_LEUART0_RX for one command frame. The receiver
+ *        stays blocked until the start frame unblocks it, the DMA moves
+ *        the bytes to RAM from EM2 and the core only wakes on the signal
+ *        frame, once per command. Call after Setup_LEUART().
+ */
+void LEUART0_Rx_Init(leuart_cmd_handler handler);
+
+/* Function: LEUART0_Send(const void *data, uint16_t len)
+ * Parameters:
+ *      - const void *data: the frame to send
+ *      - uint16_t len: bytes in the frame
+ * Return:
+ *      - false if the frame does not fit in the TX ring, nothing queued
+ * Description:
+ *      - Queue a frame and make sure the transmitter is running. Safe
+ *        from any interrupt level: interrupts are masked for the copy,
+ *        since the LEUART0 handler queues rate requests of its own.
+ */
+bool LEUART0_Send(const void *data, uint16_t len);
+
+/* Function: LEUART0_Send_Message(uint8_t type, const void *payload,
+ *                                 uint8_t len)
+ * Parameters:
+ *      - uint8_t type: one of the LINK_MSG_* types
+ *      - const void *payload, uint8_t len: at most LINK_MAX_PAYLOAD
+ * Return:
+ *      - false if the frame did not fit in the TX ring
+ * Description:
+ *      - Frame the payload for the SAMB11 (link_proto.h) and queue it.
+ *        The sequence number moves on even when the ring is full, so
+ *        the SAMB11 counts the lost frame as a gap. Moves the link to
+ *        LEUART_BULK_RATE first when the bytes queued pass the break
+ *        even.
+ */
+bool LEUART0_Send_Message(uint8_t type, const void *payload, uint8_t len);
+
+/* Function: LEUART0_Rate_Request(leuart_rate rate)
+ * Parameters:
+ *      - leuart_rate rate: the rate to move the link to
+ * Return:
+ *      - false if a change is already under way or the request did not
+ *        fit in the TX ring
+ * Description:
+ *      - Send a LINK_MSG_RATE request. Transmission stops after it until
+ *        the SAMB11 acks with LEUART_CMD_LINK_RATE; the handler switches
+ *        the LEUART once the request is out and carries on at the new
+ *        rate. Without an ack within LEUART_RATE_ACK_POLLS periods the
+ *        link stays where it was. Same contexts as LEUART0_Send(); the
+ *        LEUART0 handler asks for the low rate itself once TX drains.
+ */
+bool LEUART0_Rate_Request(leuart_rate rate);
+
+/* Function: LEUART0_Link_Poll(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *      - Call once per LETIMER0 period, from the LEUART0_Send() context.
+ *        Times out a rate change the SAMB11 never acked, and requests the
+ *        low rate back if the link is idle at a higher one because the
+ *        handler's own request could not be made.
+ */
+void LEUART0_Link_Poll(void);
+
+/* Function: LEUART0_Rate_Report(leuart_rate_report report[LEUART_RATES])
+ * Parameters:
+ *      - report: one entry per rate
+ * Return:
+ *      void
+ * Description:
+ *      - Effective throughput and energy per payload byte at each rate,
+ *        from the bytes actually sent (framing overhead) and the supply
+ *        currents above. The higher rates charge the EFM32 EM1 for all
+ *        the time they held the EM2 block, rate changes and acks
+ *        included, not just the time on the wire.
+ */
+void LEUART0_Rate_Report(leuart_rate_report report[LEUART_RATES]);
+
+/* Function: LEUART0_Reserve(uint16_t len, spsc_span *span)
+ * Parameters:
+ *      - uint16_t len: bytes in the frame
+ *      - spsc_span *span: where to build it, in the TX ring itself
+ * Return:
+ *      - false if the frame does not fit
+ * Description:
+ *      - Zero copy alternative to LEUART0_Send(): build the frame in
+ *        place, then LEUART0_Commit() it.
+ */
+bool LEUART0_Reserve(uint16_t len, spsc_span *span);
+
+/* Function: LEUART0_Commit(uint16_t len)
+ * Parameters:
+ *      - uint16_t len: bytes of the reserved frame to send
+ * Return:
+ *      void
+ */
+void LEUART0_Commit(uint16_t len);
+
+/* Function: Setup_LEUART_DMA(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *      - Set up DMA_CHANNEL_LEUART0_TX to move bytes from the TX ring to
+ *        TXDATA on TXBL, waking the DMA out of EM2 for every byte.
+ *        Called by Setup_LEUART() when LEUART_TX_DMA is defined.
+ */
 void Setup_LEUART_DMA(void);
 
 #endif /* SRC_LEUART_H_ */
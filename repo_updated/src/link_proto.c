@@ -0,0 +1,236 @@
+/*
+ * link_proto.c
+ *
+ *  Created on: Apr 25, 2017
+ *      Author: vidursarin
+ */
+
+#include <string.h>
+#include "link_proto.h"
+#include "crc.h"
+
+#define LINK_HUNT 0
+#define LINK_BODY 1
+
+/* Byte offsets in link_parser.body */
+#define LINK_BODY_LEN  0
+#define LINK_BODY_TYPE 1
+#define LINK_BODY_SEQ  2
+#define LINK_BODY_DATA 3
+
+uint16_t Link_Encode(uint8_t *frame, uint8_t type, uint8_t seq,\
+                     const void *payload, uint8_t len)
+{
+  uint16_t crc = 0;
+
+  frame[0] = LINK_SYNC;
+  frame[1] = len;
+  frame[2] = type;
+  frame[3] = seq;
+  memcpy(&frame[LINK_HDR_LEN], payload, len);
+
+  crc = Crc16_Update(CRC16_INIT, &frame[1], LINK_HDR_LEN - 1 + len);
+  frame[LINK_HDR_LEN + len] = crc >> 8;
+  frame[LINK_HDR_LEN + len + 1] = crc & 0xFF;
+
+  return LINK_FRAME_LEN(len);
+}
+
+void Link_Parser_Init(link_parser *parser)
+{
+  memset(parser, 0, sizeof(link_parser));
+  parser->state = LINK_HUNT;
+
+  return;
+}
+
+bool Link_Parse_Byte(link_parser *parser, uint8_t byte, link_frame *frame)
+{
+  uint16_t crc = 0;
+
+  if(parser->state == LINK_HUNT) {
+    if(byte == LINK_SYNC) {
+      parser->state = LINK_BODY;
+      parser->have = 0;
+      parser->need = 1;
+    } else {
+      parser->count.skipped++;
+    }
+    return false;
+  }
+
+  parser->body[parser->have++] = byte;
+
+  if(parser->have == 1) {
+    if(byte == LINK_SYNC) {
+      /* Two syncs in a row: the second one starts the frame */
+      parser->have = 0;
+      parser->count.skipped++;
+    } else if(byte > LINK_MAX_PAYLOAD) {
+      parser->count.hdr_errors++;
+      parser->state = LINK_HUNT;
+    } else {
+      parser->need = LINK_FRAME_LEN(byte) - 1;
+    }
+    return false;
+  }
+
+  if(parser->have == 2 &&\
+     (byte < LINK_MSG_TEMPERATURE || byte > LINK_MSG_LAST)) {
+    parser->count.hdr_errors++;
+    parser->state = LINK_HUNT;
+    return false;
+  }
+
+  if(parser->have < parser->need) {
+    return false;
+  }
+
+  /* Whole frame in; whatever the CRC says, hunt from the next byte */
+  parser->state = LINK_HUNT;
+
+  crc = Crc16_Update(CRC16_INIT, parser->body, parser->have - LINK_CRC_LEN);
+  if(crc != ((parser->body[parser->have - 2] << 8) |\
+              parser->body[parser->have - 1])) {
+    parser->count.crc_errors++;
+    return false;
+  }
+
+  frame->len = parser->body[LINK_BODY_LEN];
+  frame->type = parser->body[LINK_BODY_TYPE];
+  frame->seq = parser->body[LINK_BODY_SEQ];
+  frame->payload = &parser->body[LINK_BODY_DATA];
+
+  if(parser->synced && frame->seq != parser->next_seq) {
+    parser->count.gaps += (uint8_t)(frame->seq - parser->next_seq);
+  }
+  parser->synced = true;
+  parser->next_seq = frame->seq + 1;
+  parser->count.frames++;
+
+  return true;
+}
+
+/* Numerical Recipes LCG, top bits only */
+static uint32_t Link_Rand(uint32_t *state)
+{
+  *state = (*state * 1664525) + 1013904223;
+
+  return *state >> 16;
+}
+
+void Link_Fuzz(uint32_t frames, uint32_t seed, uint8_t faults,\
+               link_clock clock, uint32_t ticks_per_s,\
+               link_fuzz_result *result)
+{
+  static link_parser parser;
+  uint8_t payload[LINK_MAX_PAYLOAD];
+  uint8_t wire[LINK_FRAME_LEN(LINK_MAX_PAYLOAD) + 1];
+  uint32_t rnd = seed;
+  uint32_t ticks = 0;
+  uint32_t start = 0;
+  uint32_t cnt = 0;
+  uint32_t got = 0;
+  uint32_t first_got = 0;
+  uint32_t last_got = 0;
+  uint32_t since_hurt = 0;
+  uint16_t wire_len = 0;
+  uint16_t pos = 0;
+  uint16_t idx = 0;
+  uint8_t type = 0;
+  uint8_t len = 0;
+  bool clean = false;
+  bool got_it = false;
+  bool resyncing = false;
+  link_frame frame;
+
+  memset(result, 0, sizeof(link_fuzz_result));
+  Link_Parser_Init(&parser);
+
+  for(cnt = 0; cnt < frames; cnt++) {
+    len = 1 + (Link_Rand(&rnd) % LINK_MAX_PAYLOAD);
+    type = (cnt & 1) ? LINK_MSG_STATS_SUMMARY : LINK_MSG_TEMPERATURE;
+    for(idx = 0; idx < len; idx++) {
+      payload[idx] = Link_Rand(&rnd);
+    }
+    wire_len = Link_Encode(wire, type, (uint8_t)cnt, payload, len);
+
+    /* faults in sixteen frames get hurt on the way */
+    pos = Link_Rand(&rnd) % wire_len;
+    clean = (Link_Rand(&rnd) % 16) >= faults;
+    switch(clean ? 5 : (Link_Rand(&rnd) % 5)) {
+    case 0:
+    case 1:
+      wire[pos] ^= 1 << (Link_Rand(&rnd) % 8);
+      break;
+    case 2:
+      memmove(&wire[pos], &wire[pos + 1], wire_len - pos - 1);
+      wire_len--;
+      break;
+    case 3:
+    case 4:
+      memmove(&wire[pos + 1], &wire[pos], wire_len - pos);
+      wire[pos] = (wire_len & 1) ? LINK_SYNC : Link_Rand(&rnd);
+      wire_len++;
+      break;
+    default:
+      result->clean++;
+      break;
+    }
+
+    /* The check of the accepted frame is timed too, once per frame */
+    got_it = false;
+    start = clock();
+    for(idx = 0; idx < wire_len; idx++) {
+      if(Link_Parse_Byte(&parser, wire[idx], &frame)) {
+        result->received++;
+        if(frame.seq == (uint8_t)cnt && frame.type == type &&\
+           frame.len == len && memcmp(frame.payload, payload, len) == 0) {
+          got_it = true;
+        } else {
+          result->false_accepts++;
+        }
+      }
+    }
+    ticks += clock() - start;
+
+    if(got_it) {
+      if(got == 0) {
+        first_got = cnt;
+      }
+      last_got = cnt;
+      got++;
+    }
+
+    /* Bytes it took to get back in step after the last corrupted frame */
+    if(!clean) {
+      resyncing = true;
+      since_hurt = 0;
+    } else {
+      since_hurt += wire_len;
+      if(got_it == false) {
+        result->clean_lost++;
+      } else if(resyncing) {
+        if(since_hurt > result->max_resync_bytes) {
+          result->max_resync_bytes = since_hurt;
+        }
+        resyncing = false;
+      }
+    }
+    result->bytes += wire_len;
+  }
+
+  if(got != 0) {
+    result->expected_gaps = (last_got - first_got + 1) - got;
+  }
+  result->sent = frames;
+  result->count = parser.count;
+  if(result->bytes != 0) {
+    result->ticks_per_byte = ticks / result->bytes;
+  }
+  if(ticks != 0) {
+    result->bytes_per_s = ((uint64_t)result->bytes * ticks_per_s) / ticks;
+  }
+
+  return;
+}
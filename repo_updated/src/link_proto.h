@@ -0,0 +1,174 @@
+/*
+ * link_proto.h
+ *
+ *  Created on: Apr 25, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_LINK_PROTO_H_
+#define SRC_LINK_PROTO_H_
+
+#include<stdint.h>
+#include<stdbool.h>
+#include "sensor_stats.h"
+
+/* Frame on the EFM32 -> SAMB11 link:
+ *    sync | length | type | sequence | payload[length] | CRC hi | CRC lo
+ * The CRC-16/CCITT-FALSE covers length, type, sequence and payload.
+ */
+#define LINK_SYNC         0xA5
+#define LINK_HDR_LEN      4
+#define LINK_CRC_LEN      2
+#define LINK_MAX_PAYLOAD  64
+#define LINK_FRAME_LEN(len) (LINK_HDR_LEN + (len) + LINK_CRC_LEN)
+
+typedef enum link_message_type {
+  LINK_MSG_TEMPERATURE = 0x01,    /* float degrees C, LED status */
+  LINK_MSG_STATS_SUMMARY = 0x02,  /* stats_summary, LED status */
+  LINK_MSG_RATE = 0x03,           /* leuart_rate index to switch to */
+  LINK_MSG_BATCH = 0x04,          /* link_batch_msg */
+  LINK_MSG_LAST = LINK_MSG_BATCH
+} link_msg;
+
+/* Payloads */
+typedef struct __attribute__((packed)) link_temperature_message {
+  float temp_C;
+  uint8_t led_status;
+} link_temp_msg;
+
+typedef struct __attribute__((packed)) link_stats_message {
+  stats_summary summary;
+  uint8_t led_status;
+} link_stats_msg;
+
+/* Readings per LINK_MSG_BATCH frame, at most */
+#define LINK_BATCH_MAX 12
+
+/* One reading of a batch; dt_10ms is relative to link_batch_msg.base_ms */
+typedef struct __attribute__((packed)) link_batch_entry {
+  uint16_t dt_10ms;
+  int16_t temp_cC;
+  uint8_t flags;      /* HISTORY_FLAG_* */
+} link_batch_entry;
+
+/* Only the first count entries are sent: the payload is
+ * LINK_BATCH_LEN(count) bytes
+ */
+typedef struct __attribute__((packed)) link_batch_message {
+  uint32_t base_ms;   /* time of the first reading, since boot */
+  link_batch_entry entry[LINK_BATCH_MAX];
+} link_batch_msg;
+
+#define LINK_BATCH_LEN(count) (sizeof(uint32_t)\
+                               + (count) * sizeof(link_batch_entry))
+
+/* A frame the parser accepted; payload points into the parser */
+typedef struct link_frame {
+  uint8_t type;
+  uint8_t seq;
+  uint8_t len;
+  const uint8_t *payload;
+} link_frame;
+
+typedef struct link_counters {
+  uint32_t frames;        /* frames accepted */
+  uint32_t crc_errors;    /* frames thrown away on the CRC */
+  uint32_t hdr_errors;    /* length or type out of range */
+  uint32_t skipped;       /* bytes dropped while hunting for a sync */
+  uint32_t gaps;          /* frames missing going by the sequence */
+} link_counters;
+
+/* Receiver state; the body is length, type, sequence, payload, CRC */
+typedef struct link_parser {
+  uint8_t state;
+  uint8_t have;
+  uint8_t need;
+  bool synced;
+  uint8_t next_seq;
+  uint8_t body[LINK_FRAME_LEN(LINK_MAX_PAYLOAD) - 1];
+  link_counters count;
+} link_parser;
+
+/* Tick source for Link_Fuzz(), e.g. Profile_Get_Cycles on target */
+typedef uint32_t (*link_clock)(void);
+
+/* Frames in sixteen Link_Fuzz() corrupts by default */
+#define LINK_FUZZ_FAULTS 5
+
+typedef struct link_fuzz_result {
+  uint32_t sent;            /* frames sent */
+  uint32_t clean;           /* of those, sent without corruption */
+  uint32_t received;        /* frames accepted */
+  uint32_t clean_lost;      /* clean frames the parser missed */
+  uint32_t false_accepts;   /* accepted but not as sent: CRC misses */
+  uint32_t expected_gaps;   /* frames missing between the first and the
+                             * last one received, what count.gaps should be */
+  uint32_t max_resync_bytes;/* worst wire bytes from the end of a corrupted
+                             * frame to the end of the next clean frame
+                             * received */
+  uint32_t bytes;           /* bytes fed to the parser */
+  uint32_t ticks_per_byte;
+  uint32_t bytes_per_s;
+  link_counters count;
+} link_fuzz_result;
+
+/* Function: Link_Encode(uint8_t *frame, uint8_t type, uint8_t seq,
+ *                       const void *payload, uint8_t len)
+ * Parameters:
+ *      - uint8_t *frame: LINK_FRAME_LEN(len) bytes
+ *      - uint8_t type, uint8_t seq: message type and sequence number
+ *      - const void *payload, uint8_t len: at most LINK_MAX_PAYLOAD
+ * Return:
+ *      - bytes in the frame
+ */
+uint16_t Link_Encode(uint8_t *frame, uint8_t type, uint8_t seq,\
+                     const void *payload, uint8_t len);
+
+/* Function: Link_Parser_Init(link_parser *parser)
+ * Parameters:
+ *      - link_parser *parser: the receiver state to clear
+ * Return:
+ *      void
+ */
+void Link_Parser_Init(link_parser *parser);
+
+/* Function: Link_Parse_Byte(link_parser *parser, uint8_t byte,
+ *                           link_frame *frame)
+ * Parameters:
+ *      - link_parser *parser: the receiver state
+ *      - uint8_t byte: the next byte off the wire
+ *      - link_frame *frame: filled in when a frame completes
+ * Return:
+ *      - true if byte completed a frame with a good CRC
+ * Description:
+ *      - Constant work per byte plus one CRC per frame. A bad length
+ *        or CRC drops straight back to hunting for a sync on the next
+ *        byte; nothing already received is scanned again, so resync is
+ *        O(1). A broken length can cost the frame after it as well.
+ */
+bool Link_Parse_Byte(link_parser *parser, uint8_t byte, link_frame *frame);
+
+/* Function: Link_Fuzz(uint32_t frames, uint32_t seed, uint8_t faults,
+ *                     link_clock clock, uint32_t ticks_per_s,
+ *                     link_fuzz_result *result)
+ * Parameters:
+ *      - uint32_t frames: frames to send through the parser
+ *      - uint32_t seed: for the payloads and the corruption
+ *      - uint8_t faults: frames in sixteen to corrupt, LINK_FUZZ_FAULTS
+ *      - link_clock clock, uint32_t ticks_per_s: timing source
+ *      - link_fuzz_result *result: what came out
+ * Return:
+ *      void
+ * Description:
+ *      - Encode random frames and corrupt faults in sixteen of them
+ *        (bit flips, dropped bytes, inserted bytes and syncs) before
+ *        feeding them to a parser. Every accepted frame is checked
+ *        against what was sent and the parse time per byte is measured.
+ *        No registers are touched, so this runs on a host as well as on
+ *        the target.
+ */
+void Link_Fuzz(uint32_t frames, uint32_t seed, uint8_t faults,\
+               link_clock clock, uint32_t ticks_per_s,\
+               link_fuzz_result *result);
+
+#endif /* SRC_LINK_PROTO_H_ */
@@ -31,10 +31,10 @@
  ******************************************************************************/
 /********* CREDITS **********
  * For the functions/variables:
- * 					  void blockSleepMode(SLEEP_EnergyMode_t eMode)
- * 					  void unblockSleepMode(SLEEP_EnergyMode_t eMode)
+ * 					  void blockSleepMode(SLEEP_EnergyMode_t eMode, sleep_user user)
+ * 					  void unblockSleepMode(SLEEP_EnergyMode_t eMode, sleep_user user)
  * 					  void sleep(void)
- * 					  static int8_t sleep_block_counter[NUM_SLEEP_MODES] = {0};
+ * 					  static uint8_t sleep_block[NUM_SLEEP_MODES] = {0};
  *
  * CREDITS: Prof. Keith A. Graham
  * 			Lecture 3; ECEN5023-001
@@ -47,6 +47,7 @@
  *
  */
 
+#include <string.h>
 #include "sleep_modes.h"
 #include "em_letimer.h"
 #include "letimer.h"
@@ -61,7 +62,17 @@
 #include "adc.h"
 #include "em_acmp.h"
 #include "leuart.h"
-#include "circular_buffer.h"
+#include "profile.h"
+#include "ring_bench.h"
+#include "history.h"
+#include "batch.h"
+#include "adaptive.h"
+#include "osc_cal.h"
+#include "soft_timer.h"
+
+#if ADAPT_MAX_CONVERSIONS != MAX_CONVERSION
+#error "ADAPT_MAX_CONVERSIONS has to match MAX_CONVERSION in adc.h"
+#endif
 
 
 #define LETIMER_MAX_CNT   65535 
@@ -69,7 +80,6 @@
 #define CYCLE_PERIOD 	    4.25
 #define ON_PERIOD         0.004 
 #define CONFIG_ADC_CHNL   acmpChannel6
-#define MAX_CONVERSION    500
 #define ADC_SLEEP_MODE    sleepEM1
 #define SEL_SLEEP_MODE    sleepEM3
 
@@ -130,6 +140,13 @@
 /* Use this macro to enable ULFRCO calibration */
 #define Calibrate_ULFRCO
 
+/* The ULFRCO is recalibrated in the background at least this often, or
+ * sooner once the temperature has moved by OSC_CAL_TEMP_DELTA_MC since
+ * the last run. COMP0 and COMP1 are rescaled without stopping LETIMER0.
+ */
+#define OSC_CAL_PERIOD_MS     600000
+#define OSC_CAL_TEMP_DELTA_MC 2000
+
 /* Use this macro to enable the temp. sensor to detect
  * the temp. over a pre-specified range */
 #define TEMPERATURE_SENSOR_ENABLE
@@ -151,6 +168,53 @@
 /* Undef. this macro to run the code without the DMA */
 #define WITHOUT_DMA
 
+/* Define this macro (and undef. WITHOUT_DMA) to stream the ADC samples
+ * through a ping-pong DMA buffer and sleep in EM1 during the conversions
+ */
+//#define ADC_PINGPONG_DMA
+
+/* Define this macro (and undef. WITHOUT_DMA) to let the ADC oversample
+ * in hardware and hand over one result per reading
+ */
+//#define ADC_HW_OVERSAMPLE
+
+/* Define this macro (and undef. WITHOUT_DMA) to trigger the ADC from the
+ * LETIMER0 underflow through the PRS. TIMER2 paces the burst, the DMA
+ * collects the samples and the core wakes up once per reading. EM1 is
+ * only held from COMP1 to the end of the burst.
+ */
+//#define ADC_PRS_CHAIN
+
+/* Define this macro (and undef. WITHOUT_DMA) to convert temperature,
+ * VDD/3 and the light sensor channel in one DMA driven sequence per
+ * cycle, with per channel buffers and statistics
+ */
+//#define ADC_SCAN_SEQUENCE
+
+/* Define this macro to compare all the acquisition strategies and the
+ * robust filters at boot. The results end up in adc0_bench and
+ * adc0_filter_bench.
+ */
+//#define ADC_BENCHMARK
+
+/* Define this macro to size each burst from the measured noise and to
+ * stretch the LETIMER0 period while the temperature is stable. Works
+ * with WITHOUT_DMA and ADC_PINGPONG_DMA.
+ */
+//#define ADAPTIVE_SAMPLING
+
+/* Define this macro to time the LEUART TX ring against the old malloc'd
+ * circular buffer at boot. The results end up in ring_bench_result.
+ */
+//#define RING_BENCHMARK
+
+/* Define this macro to fuzz the SAMB11 link protocol parser at boot and
+ * time it on the target. The results end up in link_fuzz. test/test_link
+ * runs the same fuzzing on the host with every build.
+ */
+//#define LINK_FUZZ
+#define LINK_FUZZ_FRAMES 1000
+
 /* Dump all I2C register values*/
 #define ENABLE_LIGHT_SENSOR
 //#define DEBUG_I2C_REGISTER_VALUES
@@ -158,16 +222,100 @@
 /* Send data to the SAMB11 BLE module */
 #define SAMB11_INTEGRATION
 
+/* Take commands (sample period, oversampling, sensors) from the SAMB11
+ * over the LEUART receive channel. Needs SAMB11_INTEGRATION.
+ */
+#define SAMB11_COMMANDS
+
+/* Define this macro to keep link_rate_report up to date: throughput and
+ * energy per byte at each LEUART link rate.
+ */
+//#define LINK_RATE_REPORT
+
+/* Shortest sample period a command may set, in ms */
+#define MIN_SAMPLE_PERIOD_MS 100
+
+/* Send the statistics summary of each reading (mean, min, max, noise,
+ * EMA) instead of the bare float. The frame type tells the SAMB11 which
+ * one it got.
+ */
+//#define SEND_STATS_SUMMARY
+
+/* Define this macro to send the readings BATCH_READINGS at a time, each
+ * with its time relative to the first, in one LINK_MSG_BATCH frame. A
+ * batch goes out early rather than hold a reading longer than
+ * BATCH_MAX_LATENCY_MS. Takes precedence over SEND_STATS_SUMMARY.
+ */
+//#define BATCH_TELEMETRY
+#define BATCH_READINGS        8
+#define BATCH_MAX_LATENCY_MS  30000
+
+/* Define this macro to run the periodic work off software timers instead
+ * of the fixed LETIMER0 COMP0/COMP1 cycle. Each client gets its own period
+ * below, and the node only wakes up at their deadlines (and once per
+ * counter wrap). On the RTC (SOFT_TIMER_RTC in soft_timer.h) the periods
+ * can be minutes long without a prescaler, and LETIMER0 stays off. Not
+ * with ADC_PRS_CHAIN, which needs the LETIMER0 underflow as its sample
+ * clock.
+ */
+//#define SOFT_TIMERS
+#define TEMPERATURE_PERIOD_MS 4250
+#define LIGHT_PERIOD_MS       4250
+#define LIGHT_WARM_UP_MS      4
+#define I2C_POWER_PERIOD_MS   (3 * TEMPERATURE_PERIOD_MS)
+#define I2C_POWER_WINDOW_MS   (2 * TEMPERATURE_PERIOD_MS)
+#define LINK_FLUSH_PERIOD_MS  TEMPERATURE_PERIOD_MS
+
+#if defined(SOFT_TIMERS) && defined(ADC_PRS_CHAIN)
+#error "SOFT_TIMERS and ADC_PRS_CHAIN both need the LETIMER0 underflow"
+#endif
+
 /* Global Variables */
 uint16_t irq_flag_set;
 unsigned int acmp_value;
 float temp_sense_output;
-int32_t conversion_val = 0;
 uint8_t GPIO_IRQ_flag = 0;
 uint8_t adc_high = 0;
 uint8_t adc_low = 0;
 uint8_t LED_Status = 0;
 uint8_t cycle_count = 0;
+uint32_t letimer_ticks_per_s = IDEAL_ULFRCO_CNT;
+uint32_t uptime_ms = 0;
+uint8_t sensors_enabled = LEUART_SENSOR_TEMPERATURE | LEUART_SENSOR_LIGHT;
+
+#ifdef ADAPTIVE_SAMPLING
+adapt_ctrl adapt;
+#endif
+
+#ifdef LINK_FUZZ
+link_fuzz_result link_fuzz;
+#endif
+
+#ifdef LINK_RATE_REPORT
+leuart_rate_report link_rate_report[LEUART_RATES];
+#endif
+
+#ifdef BATCH_TELEMETRY
+tele_batch batch;
+
+/* A batch the TX ring had no room for is sent again from the history
+ * window, starting with the reading taken at batch_resend_ms.
+ */
+static bool batch_resend = false;
+static uint32_t batch_resend_ms = 0;
+#endif
+
+#ifdef SOFT_TIMERS
+soft_timer temperature_timer;
+soft_timer light_timer;
+soft_timer light_read_timer;
+soft_timer i2c_timer;
+soft_timer i2c_off_timer;
+soft_timer link_timer;
+soft_timer osc_cal_timer;
+
+static void Osc_Cal_Timer(void);
+#endif
 
 #ifdef SAMB11_INTEGRATION
 /* a global array of pointers to store addresses.
@@ -176,11 +324,8 @@ uint8_t cycle_count = 0;
 #define LEUART_SLEEP_MODE sleepEM2
 #define DATA_BUFFER_SIZE 5
 uint8_t *data_buffer[DATA_BUFFER_SIZE]= {0};
-uint8_t counter = 0;
 #endif
 
-extern c_buf buffer;
-
 /* Initialize the LETIMER default structure values */
 const LETIMER_Init_TypeDef letimerInit = {
   .enable         = true,              /* Enable timer when init complete. */
@@ -191,7 +336,11 @@ const LETIMER_Init_TypeDef letimerInit = {
   .bufTop         = false,             /* Do not load COMP1 into COMP0 when REP0 reaches 0. */
   .out0Pol        = IDLE_OUT_0,        /* Idle value 0 for output 0. */
   .out1Pol        = IDLE_OUT_1,        /* Idle value 0 for output 1. */
+#ifdef ADC_PRS_CHAIN
+  .ufoa0          = letimerUFOAPulse,  /* Pulse output 0 (PRS to ADC0) on underflow. */
+#else
   .ufoa0          = letimerUFOANone,   /* No action on underflow on output 0. */
+#endif
   .ufoa1          = letimerUFOANone,   /* No action on underflow on output 1. */
   .repMode        = letimerRepeatFree  /* Count until stopped by SW. */
 };
@@ -217,7 +366,9 @@ void Central_Clock_Setup(CMU_Osc_TypeDef osc_clk_type)
 	CMU_ClockEnable(cmuClock_CORELE, true);
 
   /* Set the list of clocks that you require after this! */
+#if !(defined(SOFT_TIMERS) && defined(SOFT_TIMER_RTC))
 	CMU_ClockEnable(cmuClock_LETIMER0, true);
+#endif
 	CMU_ClockEnable(cmuClock_GPIO, true);
 #ifdef ACMP_ENABLED
   CMU_ClockEnable(cmuClock_ACMP0, true);
@@ -229,84 +380,6 @@ void Central_Clock_Setup(CMU_Osc_TypeDef osc_clk_type)
   return;
 }
 
-/* Function: convertToCelsius(int32_t adcSample)
- * Parameters:
- *    adcSample: pass the value returned by the ADC to this function
- * Return:
- *    - a value of the temperature converted to celsius
- * Description:
- *    - Use this function to convert the value that is read from the 
- *      adc to a celsius value in floating point.
- * IP Credits: 
- *      This routine is credited to Silicon Labs
- */
-float convertToCelsius(int32_t adcSample)
-{
-  float temp = 0;
-
-  /* Factory calibration of temperature from the device information page */
-  float cal_temp_0 = (float)((DEVINFO->CAL & _DEVINFO_CAL_TEMP_MASK) >>\
-                                _DEVINFO_CAL_TEMP_SHIFT);
-
-  float cal_value_0 = (float)((DEVINFO->ADC0CAL2\
-                              & _DEVINFO_ADC0CAL2_TEMP1V25_MASK)\
-                              >> _DEVINFO_ADC0CAL2_TEMP1V25_SHIFT);
-
-  /* Temperature gradient(from the datasheet) */
-  float gradient = SET_TEMP_GRADIENT;
-
-  temp = (cal_temp_0 - ((cal_value_0 - adcSample)/gradient));
-
-  return temp;
-}
-
-/* Function: Get_Avg_Temperature(void)
- * Parameters:
- *    void
- * Return:
- *    - The average temperature value from amongst all the 
- *      values read from the ADC.
- * Description:
- *    - Use this function to get an average temperature reading 
- *      from amongst all the ADC values read. 
- */
-float Get_Avg_Temperature(void)
-{
-
-  int16_t cnt = 0;
-
-  /* Start the ADC count */
-  ADC_Start(ADC0, adcStartSingle);
-
-  while(cnt != MAX_CONVERSION) {
-	while(!(ADC0->IF & ADC_IFS_SINGLE));
-
-    /* Wait for the single conversion to complete */
-    while(!(ADC0->IF & ADC_IFS_SINGLE));
-
-    /*Clear the flag */
-    ADC_IntClear(ADC0, ADC_IFC_SINGLE);
-
-    /*Get the value*/
-    conversion_val += ADC0->SINGLEDATA;
-
-    cnt ++;
-  }
-
-  /* Stop the ADC conversion */
-  ADC0->CMD = ADC_CMD_SINGLESTOP;
-
-  /* ADC work done; Exit EM1 */
-  unblockSleepMode(ADC_SLEEP_MODE);
-
-  /* Get the average */
-  conversion_val = conversion_val/MAX_CONVERSION;
-
-  /* Return the value in Celsius */
-  return (convertToCelsius(conversion_val));
-
-}
-
 /* Function: Read_from_I2C_Peripheral(int8_t addr)
  * Parameters:
  *    addr - specify the address that you want to read from
@@ -405,7 +478,7 @@ void GPIO_ODD_IRQHandler(void)
   /* Make sure that you are in the correct mode before you call any
    * LED functions to toggle the LEDs
    */
-  blockSleepMode(sleepEM1);
+  blockSleepMode(sleepEM1, SLEEP_USER_I2C);
 
   /* Clear the GPIO IF flags */
   GPIO->IFC = 0xFFFF;
@@ -423,7 +496,7 @@ void GPIO_ODD_IRQHandler(void)
   }
 
   /* Come out of the sleep mode now */
-  unblockSleepMode(sleepEM1);
+  unblockSleepMode(sleepEM1, SLEEP_USER_I2C);
 
   INT_Enable();
 
@@ -532,34 +605,85 @@ void Power_Down_Peripheral(void)
  return ;
 }
 
-/* Function: LETIMER0_IRQHandler(void)
+#ifdef Calibrate_ULFRCO
+/* Function: ULFRCO_Apply_Cal(uint32_t ticks_per_s)
  * Parameters:
+ *    uint32_t ticks_per_s - the newly measured ULFRCO rate
+ * Return:
  *    void
+ * Description:
+ *  - Rescale COMP0 and COMP1 to the new rate, keeping the period in ms.
+ *    LETIMER0 keeps running: COMP0 is reloaded on the next underflow.
+ *    With the soft timers, hand the rate to them instead.
+ */
+void ULFRCO_Apply_Cal(uint32_t ticks_per_s)
+{
+#ifdef SOFT_TIMERS
+  /* The timers convert their periods with the new rate from now on */
+  Soft_Timer_Set_Rate(ticks_per_s);
+#else
+  uint32_t cycle_period = ((uint64_t)LETIMER_CompareGet(LETIMER0, COMP0)\
+                           * ticks_per_s) / letimer_ticks_per_s;
+  uint32_t on_period = ON_PERIOD * ticks_per_s;
+
+  if(cycle_period > LETIMER_MAX_CNT) {
+    cycle_period = LETIMER_MAX_CNT;
+  }
+  if(on_period == 0) {
+    on_period = 1;
+  }
+
+  LETIMER_CompareSet(LETIMER0, COMP0, cycle_period);
+  LETIMER_CompareSet(LETIMER0, COMP1, on_period);
+#endif
+  letimer_ticks_per_s = ticks_per_s;
+  Sleep_Stats_Set_Rate(ticks_per_s);
+
+  return;
+}
+#endif
+
+/* Function: Set_Sample_Period(uint32_t period_ms)
+ * Parameters:
+ *    uint32_t period_ms - time between two readings
  * Return:
  *    void
  * Description:
- *  - This is the global LETIMER0 IRQ handler definition.
- *  - Handles the general reading of the value from the ACMP 
- *  - Toggles the LED based on the value of the ACMP
- *  - Handles the toggle to LED1 after sensing the temperature
- *  - Added feature to turn on the Peripheral on every 1st cycle and 
- *    then to turn it off on the 3rd one. Simultaneously, enable an
- *    interrupt to be triggered if the light sensed is below a threshold.
+ *  - On the fixed cycle this is the LETIMER0 period: COMP0 is the top
+ *    value and gets reloaded on the next underflow. With the soft timers
+ *    it is the period of the temperature and link timers, from their
+ *    next expiry.
  */
-void LETIMER0_IRQHandler(void)
+void Set_Sample_Period(uint32_t period_ms)
 {
-  /* disable all interrupts */
-  INT_Disable();
- 
-  /* Get which interrupt flag has been set */
-  irq_flag_set = LETIMER_IntGet(LETIMER0);
-  
-  /* If COMP1 flag is set */
-  if(irq_flag_set & LETIMER_IF_COMP1) {
+#ifdef SOFT_TIMERS
+  Soft_Timer_Set_Period(&temperature_timer, period_ms);
+  Soft_Timer_Set_Period(&link_timer, period_ms);
+#else
+  uint32_t ticks = (period_ms * letimer_ticks_per_s) / 1000;
 
-    /* Clear the COMP1 Interrupt Flag*/
-    LETIMER0->IFC |= LETIMER_IFC_COMP1;
+  if(ticks > LETIMER_MAX_CNT) {
+    ticks = LETIMER_MAX_CNT;
+  }
+  LETIMER_CompareSet(LETIMER0, COMP0, ticks);
+#endif
+
+  return;
+}
+
+/* Function: Light_Sensor_Warm_Up(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *  - Power the ACMP and the light sensor excitation up ahead of the
+ *    reading.
+ */
+void Light_Sensor_Warm_Up(void)
+{
 #ifdef ACMP_ENABLED
+  if(sensors_enabled & LEUART_SENSOR_LIGHT) {
     /* Keep the ACMP0 enabled */
     ACMP0->CTRL |= ACMP_CTRL_EN;
 
@@ -568,41 +692,67 @@ void LETIMER0_IRQHandler(void)
 
     /* Wait for the warm-up to complete */
     while (!(ACMP0->STATUS & ACMP_STATUS_ACMPACT));
+  }
 #endif
-  } else { /* COMP0 flag is set */
 
+  return;
+}
+
+/* Function: I2C_Power_Cycle(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *  - Turn the TSL2561 on every 1st cycle and off on the 3rd one. While it
+ *    is on, its interrupt fires if the light is below a threshold.
+ */
+void I2C_Power_Cycle(void)
+{
 #ifdef ENABLE_I2C
 
-    cycle_count++;
-    if(cycle_count == 1) {
+  cycle_count++;
+  if(cycle_count == 1) {
 
-      /* Next power up the peripheral and
-       * set the registers on it */
-      Power_Up_Peripheral();
+    /* Next power up the peripheral and
+     * set the registers on it */
+    Power_Up_Peripheral();
 
-      //Dump_All_Register_Values();
-      Setup_GPIO_Interrupts();
+    //Dump_All_Register_Values();
+    Setup_GPIO_Interrupts();
 
-    } else if (cycle_count == 2) {
-      /* Do nothing here */
-    } else {
-      /* Disable the interrupts and stop the peripheral */
-      Power_Down_Peripheral();
+  } else if (cycle_count == 2) {
+    /* Do nothing here */
+  } else {
+    /* Disable the interrupts and stop the peripheral */
+    Power_Down_Peripheral();
 
-      /* reset the counter */
-      cycle_count = 0;
-    }
+    /* reset the counter */
+    cycle_count = 0;
+  }
 #endif
 
-    /* First clear the LETIMER - COMP0 flag */
-   	 LETIMER_IntClear(LETIMER0, LETIMER_IFC_COMP0);
+  return;
+}
 
+/* Function: Temperature_Reading(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *  - Take a temperature reading with whichever ADC path is compiled in.
+ *    The DMA paths publish it later, from their callbacks.
+ */
+void Temperature_Reading(void)
+{
 #ifdef TEMPERATURE_SENSOR_ENABLE
+  if(sensors_enabled & LEUART_SENSOR_TEMPERATURE) {
     /* Add the functionality for the temperature sensor */
 #ifdef WITHOUT_DMA
     /*Move out of the EM3 mode */
-    blockSleepMode(ADC_SLEEP_MODE);
-    
+    blockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+  
     /* Get the average temperature of the MCU */
     temp_sense_output = Get_Avg_Temperature();
 #ifdef TOGGLE_LED_TEMP_SENSE
@@ -615,7 +765,33 @@ void LETIMER0_IRQHandler(void)
     }
 #endif
     /* ADC work done; Exit EM1 */
-    unblockSleepMode(ADC_SLEEP_MODE);
+    unblockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+
+#elif defined(ADC_PINGPONG_DMA)
+
+    /* Stay in EM1 until the last block has been reduced. The previous
+     * reading is the one that gets sent out below.
+     */
+    blockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+    ADC0_PingPong_Start();
+
+#elif defined(ADC_PRS_CHAIN)
+
+    /* Nothing to do: the underflow has already started the burst
+     * through the PRS and cb_ADC0_PRS publishes it.
+     */
+
+#elif defined(ADC_SCAN_SEQUENCE)
+
+    /* All the analog channels; the last DMA callback unblocks EM1 */
+    blockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+    ADC0_Scan_Start();
+
+#elif defined(ADC_HW_OVERSAMPLE)
+
+    /* One conversion, one wake-up; ADC0_IRQHandler unblocks EM1 */
+    blockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+    ADC0_Oversample_Start();
 
 #else
 
@@ -626,9 +802,35 @@ void LETIMER0_IRQHandler(void)
     ADC_Start(ADC0, adcStartSingle);
 
 #endif
+
+#ifdef ADAPTIVE_SAMPLING
+    /* Size the next burst and period from the last published reading.
+     * With the DMA paths that is the previous one, which is fine as the
+     * new settings only apply from the next cycle anyway.
+     */
+    Adapt_Update(&adapt, adc0_last_reading_mC, ADC0_Burst_Std_Dev_mC());
+    adc0_conversions = adapt.conversions;
+    Set_Sample_Period(adapt.period_ms);
 #endif
+  }
+#endif
+
+  return;
+}
 
+/* Function: Light_Sensor_Reading(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *  - Read the ACMP, power it down and swap the threshold, toggling LED0.
+ */
+void Light_Sensor_Reading(void)
+{
 #ifdef ENABLE_LIGHT_SENSOR
+  acmp_value = 0;
+  if(sensors_enabled & LEUART_SENSOR_LIGHT) {
     /* Read the ACMP0 value and disable it */
     acmp_value = (ACMP0->STATUS & ACMP_STATUS_ACMPOUT);
     ACMP0->CTRL &= ~ACMP_CTRL_EN;
@@ -661,60 +863,389 @@ void LETIMER0_IRQHandler(void)
         LED_Status = TURN_ON_LED;
       }
     }
+  }
+#endif
 
-    /* Now that the interrupts have been enabled, you can do a nested
-     * interrupt call to the LEUART interrupt handler.
-     */
-#ifdef SAMB11_INTEGRATION
-    /* Trigger the Interrupt handler. Update the following:
-     *  - Update the value of the temperature
-     *  - Update the state of the LED
-     */
+  return;
+}
 
-    /* Free the buffer before it is used again ! */
-    free_buffer(buffer.buf_start);
+#ifdef BATCH_TELEMETRY
+/* Function: Batch_Resend(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    - true once everything from batch_resend_ms on has been queued
+ * Description:
+ *  - Send the readings lost to a full TX ring again, out of the history
+ *    window, in frames cut the same way as the live batches. Readings
+ *    that are already in the live batch are left to it. Stops at the
+ *    first frame the ring can't take and picks up from it next time;
+ *    anything the window has overwritten since is gone for good.
+ */
+static bool Batch_Resend(void)
+{
+  static history_rec recs[HISTORY_LEN];
+  tele_batch resend;
+  uint16_t count = History_Snapshot(recs, HISTORY_LEN);
+  uint16_t cnt = 0;
 
-    counter = 0;
-    /* Push the data from the 4B float memory to an array.
-     * This is a primitive way to store the data to be sent
-     * to the SAMB11
-     */
+  /* The live batch holds the newest readings of the window */
+  count = (count > batch.count) ? (count - batch.count) : 0;
+
+  Batch_Init(&resend, batch.k, batch.max_latency_ms);
+
+  for(cnt = 0; cnt < count; cnt++) {
+    if((int32_t)(recs[cnt].time_ms - batch_resend_ms) < 0) {
+      continue;
+    }
+    if(Batch_Add(&resend, recs[cnt].time_ms, recs[cnt].temp_cC,\
+                 recs[cnt].flags) || (cnt == (count - 1))) {
+      if(!LEUART0_Send_Message(LINK_MSG_BATCH, &resend.msg,\
+                               Batch_Length(&resend))) {
+        batch_resend_ms = resend.msg.base_ms;
+        return false;
+      }
+      Batch_Reset(&resend);
+    }
+  }
+
+  return true;
+}
+#endif
+
+/* Function: Link_Send(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *  - Keep the latest reading in the history and send it to the SAMB11.
+ */
+void Link_Send(void)
+{
+  /* Keep the reading in the history window */
+  uint8_t reading_flags = (acmp_value ? HISTORY_FLAG_LIGHT : 0)\
+                          | (LED_Status ? HISTORY_FLAG_LED : 0);
+
+  History_Add(uptime_ms, adc0_last_reading_mC, reading_flags);
+
+  /* Now that the interrupts have been enabled, you can do a nested
+   * interrupt call to the LEUART interrupt handler.
+   */
+#ifdef SAMB11_INTEGRATION
+  /* Trigger the Interrupt handler. Update the following:
+   *  - Update the value of the temperature
+   *  - Update the state of the LED
+   */
+
+  /* Push the data from the 4B float memory to an array.
+   * This is a primitive way to store the data to be sent
+   * to the SAMB11
+   */
 #if 0
-    data_buffer[0] = &temp_sense_output;
-    data_buffer[1] = data_buffer[0] + sizeof(uint8_t);
-    data_buffer[2] = data_buffer[1] + sizeof(uint8_t);
-    data_buffer[3] = data_buffer[2] + sizeof(uint8_t);
-    data_buffer[4] = &LED_Status;
+  data_buffer[0] = &temp_sense_output;
+  data_buffer[1] = data_buffer[0] + sizeof(uint8_t);
+  data_buffer[2] = data_buffer[1] + sizeof(uint8_t);
+  data_buffer[3] = data_buffer[2] + sizeof(uint8_t);
+  data_buffer[4] = &LED_Status;
 #endif
 
-    /* Use the Circular Buffer to store data */
-    //c_buf *buffer;
+  /* Rate change timeouts, and back to the low rate once idle */
+  LEUART0_Link_Poll();
+#ifdef LINK_RATE_REPORT
+  LEUART0_Rate_Report(link_rate_report);
+#endif
 
-    uint8_t ret_data;
-    Alloc_Buffer(&buffer, 5);
-    add_to_buffer(&buffer, &temp_sense_output, sizeof(float));
-    add_to_buffer(&buffer, &LED_Status, sizeof(uint8_t));
+  /* Frame it for the SAMB11 (sync, length, type, sequence, CRC) and
+   * queue it; the LEUART0 handler takes it from there.
+   */
+#ifdef BATCH_TELEMETRY
+  /* A batch the ring had no room for is emptied all the same; its
+   * readings go out again from the history window, oldest first, ahead
+   * of anything newer.
+   */
+  if(Batch_Add(&batch, uptime_ms, adc0_last_reading_mC / 10,\
+               reading_flags)) {
+    if(!batch_resend && !LEUART0_Send_Message(LINK_MSG_BATCH, &batch.msg,\
+                                              Batch_Length(&batch))) {
+      batch_resend = true;
+      batch_resend_ms = batch.msg.base_ms;
+    }
+    Batch_Reset(&batch);
+  }
+  if(batch_resend) {
+    batch_resend = !Batch_Resend();
+  }
+#elif defined(SEND_STATS_SUMMARY)
+  link_stats_msg msg;
 
-    /* Start sending data via the UART! 
-     * The next line will trigger the LEUART interrupt
-     */
+  ADC0_Stats_Summary(&msg.summary);
+  msg.led_status = LED_Status;
+  LEUART0_Send_Message(LINK_MSG_STATS_SUMMARY, &msg, sizeof(msg));
+#else
+  link_temp_msg msg;
+
+  msg.temp_C = temp_sense_output;
+  msg.led_status = LED_Status;
+  LEUART0_Send_Message(LINK_MSG_TEMPERATURE, &msg, sizeof(msg));
+#endif
+
+#endif
+
+  return;
+}
+
+#ifdef SOFT_TIMERS
+/* Function: Temperature_Timer(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *  - Soft timer client: a temperature reading, and the ULFRCO
+ *    calibration when that is due.
+ */
+static void Temperature_Timer(void)
+{
+  uptime_ms = Soft_Timer_Ms();
+
+#ifdef Calibrate_ULFRCO
+  if(Osc_Cal_Poll(uptime_ms, adc0_last_reading_mC)) {
+    Soft_Timer_Start_Ticks(&osc_cal_timer, OSC_CAL_ARM_TICKS, Osc_Cal_Timer);
+  }
+#endif
+
+  Temperature_Reading();
+
+  return;
+}
+
+#ifdef Calibrate_ULFRCO
+/* Function: Osc_Cal_Timer(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *  - Soft timer client: open the calibration gate once the reference
+ *    count is done, and close it OSC_CAL_GATE_TICKS later. Both ends
+ *    have to run in the tick they were due in, or the run is dropped.
+ */
+static void Osc_Cal_Timer(void)
+{
+  uint32_t ticks_per_s = 0;
+
+  if(Soft_Timer_Now() != osc_cal_timer.expiry) {
+    /* Held up behind another callback */
+    Osc_Cal_Abort();
+  } else if(ulfrco_cal.state == OSC_CAL_GATE) {
+    ticks_per_s = Osc_Cal_Gate_Close(OSC_CAL_GATE_TICKS);
+    if(ticks_per_s != 0) {
+      ULFRCO_Apply_Cal(ticks_per_s);
+    }
+  } else if(Osc_Cal_Gate_Open()) {
+    Soft_Timer_Start_Ticks(&osc_cal_timer, OSC_CAL_GATE_TICKS, Osc_Cal_Timer);
+  } else if(ulfrco_cal.state == OSC_CAL_REF) {
+    /* The LFXO may still be starting up */
+    Soft_Timer_Start_Ticks(&osc_cal_timer, OSC_CAL_ARM_TICKS, Osc_Cal_Timer);
+  }
+
+  return;
+}
+#endif
+
+/* Function: Light_Timer(void), Light_Read_Timer(void)
+ * Description:
+ *  - Soft timer clients: warm the light sensor up, read it
+ *    LIGHT_WARM_UP_MS later.
+ */
+static void Light_Read_Timer(void)
+{
+  Light_Sensor_Reading();
+
+  return;
+}
+
+static void Light_Timer(void)
+{
+  Light_Sensor_Warm_Up();
+  Soft_Timer_Start(&light_read_timer, LIGHT_WARM_UP_MS, 0, Light_Read_Timer);
+
+  return;
+}
+
+#ifdef ENABLE_I2C
+/* Function: I2C_Power_Timer(void), I2C_Power_Off_Timer(void)
+ * Description:
+ *  - Soft timer clients: the TSL2561 power window, I2C_POWER_WINDOW_MS
+ *    out of every I2C_POWER_PERIOD_MS.
+ */
+static void I2C_Power_Off_Timer(void)
+{
+  Power_Down_Peripheral();
+
+  return;
+}
+
+static void I2C_Power_Timer(void)
+{
+  Power_Up_Peripheral();
+  Setup_GPIO_Interrupts();
+  Soft_Timer_Start(&i2c_off_timer, I2C_POWER_WINDOW_MS, 0,\
+                   I2C_Power_Off_Timer);
+
+  return;
+}
+#endif
+
+/* Function: Link_Timer(void)
+ * Description:
+ *  - Soft timer client: send the latest reading to the SAMB11.
+ */
+static void Link_Timer(void)
+{
+  uptime_ms = Soft_Timer_Ms();
+  Link_Send();
+
+  return;
+}
+
+/* Function: Start_Timer_Clients(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *  - Start the periodic clients. The link timer is started after the
+ *    temperature one so that, on a shared deadline, it sends the new
+ *    reading.
+ */
+static void Start_Timer_Clients(void)
+{
+  Soft_Timer_Start(&temperature_timer, TEMPERATURE_PERIOD_MS,\
+                   TEMPERATURE_PERIOD_MS, Temperature_Timer);
+  Soft_Timer_Start(&light_timer, LIGHT_PERIOD_MS, LIGHT_PERIOD_MS,\
+                   Light_Timer);
+#ifdef ENABLE_I2C
+  Soft_Timer_Start(&i2c_timer, TEMPERATURE_PERIOD_MS, I2C_POWER_PERIOD_MS,\
+                   I2C_Power_Timer);
+#endif
+  Soft_Timer_Start(&link_timer, LINK_FLUSH_PERIOD_MS, LINK_FLUSH_PERIOD_MS,\
+                   Link_Timer);
+
+  return;
+}
+
+#ifdef SOFT_TIMER_RTC
+/* Function: RTC_IRQHandler(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *  - All the periodic work is done by the soft timer clients above;
+ *    LETIMER0 is not used.
+ */
+void RTC_IRQHandler(void)
+{
+  Soft_Timer_IRQHandler();
+
+  return;
+}
+#else
+/* Function: LETIMER0_IRQHandler(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *  - All the LETIMER0 work is done by the soft timer clients above.
+ */
+void LETIMER0_IRQHandler(void)
+{
+  Soft_Timer_IRQHandler();
+
+  return;
+}
+#endif
+
+#else
+
+/* Function: LETIMER0_IRQHandler(void)
+ * Parameters:
+ *    void
+ * Return:
+ *    void
+ * Description:
+ *  - This is the global LETIMER0 IRQ handler definition.
+ *  - COMP1 warms the light sensor up ahead of COMP0.
+ *  - COMP0 runs the I2C power cycle, the temperature and light readings
+ *    and sends the result to the SAMB11.
+ */
+void LETIMER0_IRQHandler(void)
+{
+  /* disable all interrupts */
+  INT_Disable();
+ 
+  /* Get which interrupt flag has been set */
+  irq_flag_set = LETIMER_IntGet(LETIMER0);
 
-    /* Block in the lowest possible state that the LEUART will run in. */
-    blockSleepMode(LEUART_SLEEP_MODE);
+#ifdef Calibrate_ULFRCO
+  /* Only enabled while a calibration gate is open */
+  if(irq_flag_set & LETIMER_IF_UF) {
+    LETIMER_IntClear(LETIMER0, LETIMER_IFC_UF);
 
-    /* Send the first byte of data and trigger the interrupt */
-    //LEUART0->TXDATA = *data_buffer[counter++];
-    remove_from_buffer(&buffer, &ret_data, sizeof(uint8_t));
-    LEUART0->TXDATA = ret_data;
+    uint32_t ticks_per_s = Osc_Cal_Underflow();
+    if(ticks_per_s != 0) {
+      ULFRCO_Apply_Cal(ticks_per_s);
+    }
+  }
+#endif
+  
+  /* If COMP1 flag is set */
+  if(irq_flag_set & LETIMER_IF_COMP1) {
 
+#ifdef Calibrate_ULFRCO
+    /* Before anything else, the gate is timed from here */
+    Osc_Cal_Comp1();
 #endif
+
+    /* Clear the COMP1 Interrupt Flag*/
+    LETIMER0->IFC |= LETIMER_IFC_COMP1;
+
+    Light_Sensor_Warm_Up();
+
+#ifdef ADC_PRS_CHAIN
+    /* The underflow right after this starts the burst */
+    if(sensors_enabled & LEUART_SENSOR_TEMPERATURE) {
+      ADC0_PRS_Arm();
+    }
 #endif
+  } else if(irq_flag_set & LETIMER_IF_COMP0) {
+
+    I2C_Power_Cycle();
+
+    /* First clear the LETIMER - COMP0 flag */
+   	 LETIMER_IntClear(LETIMER0, LETIMER_IFC_COMP0);
+
+    /* One more period gone; read COMP0 before anyone reprograms it */
+    uptime_ms += (LETIMER_CompareGet(LETIMER0, COMP0) * 1000)\
+                 / letimer_ticks_per_s;
+
+#ifdef Calibrate_ULFRCO
+    Osc_Cal_Poll(uptime_ms, adc0_last_reading_mC);
+#endif
+
+    Temperature_Reading();
+    Light_Sensor_Reading();
+    Link_Send();
   }
 
   /* Enable all interrupts before exiting from the handler */
   INT_Enable();
 
 }
+#endif
 
 /* Function: int32_t Calc_Prescaler(int32_t *cycle_period, int32_t *on_period)
  * Parameters: 
@@ -753,12 +1284,18 @@ void Config_LETIMER0(void)
 
 #ifdef Calibrate_ULFRCO
   
-  /* First Get the ratio */
-  float ratio = Get_Osc_Ratio();
+  /* Start on the rate stored by an earlier boot, or on the nominal one
+   * without it. Either way the first calibration runs in the background
+   * from the first period and ULFRCO_Apply_Cal() corrects the
+   * comparators once it is done.
+   */
+  letimer_ticks_per_s = Osc_Cal_Init(OSC_CAL_PERIOD_MS, OSC_CAL_TEMP_DELTA_MC);
+  if(letimer_ticks_per_s == 0) {
+    letimer_ticks_per_s = IDEAL_ULFRCO_CNT;
+  }
 
-  /* Change the COMP0 and COMP1 values accordingly */
-  int32_t cycle_period = ratio * (IDEAL_ULFRCO_CNT * CYCLE_PERIOD);
-  int32_t on_period = ratio * (IDEAL_ULFRCO_CNT * ON_PERIOD);
+  int32_t cycle_period = (letimer_ticks_per_s * CYCLE_PERIOD);
+  int32_t on_period = (letimer_ticks_per_s * ON_PERIOD);
 
 #else
 
@@ -791,6 +1328,34 @@ void Config_LETIMER0(void)
   return;
 }
 
+#ifndef SOFT_TIMERS
+/* Function: LETIMER_Sleep_Clock(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - LETIMER0 ticks counted up, wrapping at 32 bits
+ * Description:
+ *  - The time base for the sleep residency. LETIMER0 counts down from
+ *    COMP0, and the COMP0 interrupt ends every sleep, so two reads are
+ *    never more than one period apart.
+ */
+static uint32_t LETIMER_Sleep_Clock(void)
+{
+  static uint32_t ticks = 0;
+  static uint32_t last_cnt = 0;
+  uint32_t cnt = LETIMER_CounterGet(LETIMER0);
+
+  if(cnt <= last_cnt) {
+    ticks += last_cnt - cnt;
+  } else {
+    ticks += last_cnt + LETIMER_CompareGet(LETIMER0, COMP0) + 1 - cnt;
+  }
+  last_cnt = cnt;
+
+  return ticks;
+}
+#endif
+
 /* Function: LETIMER_Init_Start(void)
  * Parameters:
  *      void
@@ -801,12 +1366,23 @@ void Config_LETIMER0(void)
  */
 void LETIMER_Init_Start(void)
 {
+#ifdef SOFT_TIMERS
+  /* Free running from here on; the clients set the compare */
+  Soft_Timer_Init(letimer_ticks_per_s);
+  Start_Timer_Clients();
+#else
   /* Set the NVIC to trigger the LETIMER0 interrupt */
   NVIC_EnableIRQ(LETIMER0_IRQn);
   
   /*Initialize the LETIMER and Enable it */ 
   LETIMER_Init(LETIMER0, &letimerInit);
+
+#ifdef ADC_PRS_CHAIN
+  /* The outputs are only driven while REP0 is non-zero */
+  LETIMER_RepeatSet(LETIMER0, 0, 1);
+#endif
   LETIMER_Enable(LETIMER0, true);
+#endif
 
   return;
 }
@@ -914,6 +1490,63 @@ void Power_Up_Peripheral(void)
   return;
 }
 
+#ifdef SAMB11_COMMANDS
+/* Function: SAMB11_Command(uint8_t cmd, uint16_t value)
+ * Parameters:
+ *      - uint8_t cmd: one of the LEUART_CMD_* commands
+ *      - uint16_t value: its argument
+ * Return:
+ *      void
+ * Description:
+ *      - Apply a command from the SAMB11. Runs in the LEUART0 handler;
+ *        everything here takes effect from the next LETIMER0 period.
+ *        With ADAPTIVE_SAMPLING the controller takes the period and the
+ *        oversampling back over at the next reading.
+ */
+void SAMB11_Command(uint8_t cmd, uint16_t value)
+{
+  uint32_t period_ms = 0;
+
+  switch(cmd) {
+  case LEUART_CMD_SAMPLE_PERIOD:
+    period_ms = value * 10;
+    if(period_ms < MIN_SAMPLE_PERIOD_MS) {
+      period_ms = MIN_SAMPLE_PERIOD_MS;
+    }
+    Set_Sample_Period(period_ms);
+    break;
+
+  case LEUART_CMD_OVERSAMPLE:
+    if(value == 0) {
+      value = 1;
+    } else if(value > MAX_CONVERSION) {
+      value = MAX_CONVERSION;
+    }
+    adc0_conversions = value;
+    break;
+
+  case LEUART_CMD_SENSORS:
+    sensors_enabled = value & (LEUART_SENSOR_TEMPERATURE | LEUART_SENSOR_LIGHT);
+    break;
+
+#ifdef BATCH_TELEMETRY
+  case LEUART_CMD_BATCH_K:
+    /* Clamp before it is narrowed: 256 would come out as 0 */
+    if(value > LINK_BATCH_MAX) {
+      value = LINK_BATCH_MAX;
+    }
+    Batch_Set_K(&batch, value);
+    break;
+#endif
+
+  default:
+    break;
+  }
+
+  return;
+}
+#endif
+
 /* Function: int main(void) 
  * Parameters: 
  *      void
@@ -926,6 +1559,9 @@ int main(void)
 {
   /* Chip errata */
   CHIP_Init();
+
+  /* Start the cycle counter used to profile the ADC readings */
+  Profile_Init();
   
   /* First do the config. for all the clocks
    * This function will also do the config. for 
@@ -936,6 +1572,7 @@ int main(void)
 #else
   Central_Clock_Setup(cmuSelect_LFXO);
 #endif
+  Profile_Boot_Mark(BOOT_CLOCKS);
   
   /* Setup some of the misc. peripherals */
   /* 1. Initialize the GPIO pins for LED0 & LED1 */
@@ -956,6 +1593,7 @@ int main(void)
 
   /* Do the config. for the LETIMER */
   Config_LETIMER0();
+  Profile_Boot_Mark(BOOT_LETIMER);
 
 #ifdef ENABLE_I2C
   /* Initialize the I2C peripherals */
@@ -964,6 +1602,45 @@ int main(void)
 
   /* Initialize the ADC for the temperature sensor */
   ADC0_Init();
+  ADC0_Cal_Init();
+  Profile_Boot_Mark(BOOT_ADC);
+  ADC0_Stats_Init();
+  History_Init();
+#ifdef BATCH_TELEMETRY
+  Batch_Init(&batch, BATCH_READINGS, BATCH_MAX_LATENCY_MS);
+#endif
+  adc0_conversions = MAX_CONVERSION;
+
+#ifdef ADAPTIVE_SAMPLING
+  Adapt_Init(&adapt);
+  adc0_conversions = adapt.conversions;
+#endif
+
+#ifdef ADC_BENCHMARK
+  ADC0_Conv_Benchmark();
+  ADC0_Filter_Benchmark();
+  ADC0_Benchmark();
+#endif
+
+#ifdef RING_BENCHMARK
+  Ring_Benchmark();
+#endif
+
+#ifdef LINK_FUZZ
+  Link_Fuzz(LINK_FUZZ_FRAMES, DWT->CYCCNT, LINK_FUZZ_FAULTS,\
+            Profile_Get_Cycles, CMU_ClockFreqGet(cmuClock_CORE), &link_fuzz);
+#endif
+
+#ifdef ADC_PINGPONG_DMA
+  /* The DMA only needs to be configured once for ping-pong */
+  ADC0_PingPong_Init();
+#elif defined(ADC_HW_OVERSAMPLE)
+  ADC0_Oversample_Init(ADC0_OVS_RATE);
+#elif defined(ADC_PRS_CHAIN)
+  ADC0_PRS_Init();
+#elif defined(ADC_SCAN_SEQUENCE)
+  ADC0_Scan_Init();
+#endif
 
 #ifdef ACMP_ENABLED
    /* Initlialize and Start the ACMP */
@@ -973,11 +1650,25 @@ int main(void)
   /* Initialize and Start the LETIMER */
   LETIMER_Init_Start();
 
+  Profile_Boot_Mark(BOOT_MISC);
+
   /* Setup the LEUART */
   Setup_LEUART();
 
+#ifdef SAMB11_COMMANDS
+  LEUART0_Rx_Init(SAMB11_Command);
+#endif
+  Profile_Boot_Mark(BOOT_LEUART);
+
+  /* Count the time in each sleep mode from here on */
+#ifdef SOFT_TIMERS
+  Sleep_Stats_Init(Soft_Timer_Now, letimer_ticks_per_s);
+#else
+  Sleep_Stats_Init(LETIMER_Sleep_Clock, letimer_ticks_per_s);
+#endif
+
   /* Choose the sleep mode that you want to enter */
-  blockSleepMode(SEL_SLEEP_MODE);
+  blockSleepMode(SEL_SLEEP_MODE, SLEEP_USER_MAIN);
   
   /* Infinite loop */
   while (1) {
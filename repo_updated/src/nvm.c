@@ -0,0 +1,149 @@
+/*
+ * nvm.c
+ *
+ *  Created on: Apr 19, 2017
+ *      Author: vidursarin
+ */
+
+#include <string.h>
+#include "nvm.h"
+#include "crc.h"
+
+#define NVM_HEADER_WORDS (sizeof(nvm_header) / sizeof(uint32_t))
+#define NVM_PAYLOAD_WORDS(len) (((len) + sizeof(uint32_t) - 1)\
+                                / sizeof(uint32_t))
+
+/* Header, payload and CRC: the stride of the records in a page */
+#define NVM_SLOT_WORDS(len) (NVM_HEADER_WORDS + NVM_PAYLOAD_WORDS(len) + 1)
+#define NVM_PAGE_WORDS (FLASH_PAGE_SIZE / sizeof(uint32_t))
+
+#define NVM_ERASED 0xFFFFFFFF
+
+/* Header and payload as they go to the flash. MSC_WriteWord() wants a
+ * word aligned source.
+ */
+static uint32_t nvm_image[NVM_HEADER_WORDS\
+                          + NVM_PAYLOAD_WORDS(NVM_MAX_PAYLOAD)];
+
+/* Function: Nvm_Slot_Valid(const uint32_t *slot, uint32_t magic,
+ *                          uint16_t version, uint16_t length)
+ * Return:
+ *      - true if slot holds a complete record of this kind
+ */
+static bool Nvm_Slot_Valid(const uint32_t *slot, uint32_t magic,\
+                           uint16_t version, uint16_t length)
+{
+  const nvm_header *header = (const nvm_header *)slot;
+  uint32_t words = NVM_HEADER_WORDS + NVM_PAYLOAD_WORDS(length);
+
+  if((header->magic != magic) || (header->version != version) ||\
+     (header->length != length)) {
+    return false;
+  }
+
+  return slot[words] == Crc16_Update(CRC16_INIT, slot,\
+                                     sizeof(nvm_header) + length);
+}
+
+/* Function: Nvm_Slot_Erased(const uint32_t *slot, uint16_t length)
+ * Return:
+ *      - true if nothing has been written to the slot since the erase
+ */
+static bool Nvm_Slot_Erased(const uint32_t *slot, uint16_t length)
+{
+  uint32_t cnt = 0;
+
+  for(cnt = 0; cnt < NVM_SLOT_WORDS(length); cnt++) {
+    if(slot[cnt] != NVM_ERASED) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Nvm_Record_Read(const uint32_t *page, uint32_t magic, uint16_t version,\
+                     void *data, uint16_t length)
+{
+  const uint32_t *last = NULL;
+  uint32_t slot = 0;
+
+  if(length > NVM_MAX_PAYLOAD) {
+    return false;
+  }
+
+  /* The newest good record is the last one before the erased space. A
+   * torn one is skipped; it still takes up its slot.
+   */
+  for(slot = 0; (slot + NVM_SLOT_WORDS(length)) <= NVM_PAGE_WORDS;\
+      slot += NVM_SLOT_WORDS(length)) {
+    if(page[slot] == NVM_ERASED) {
+      break;
+    }
+    if(Nvm_Slot_Valid(&page[slot], magic, version, length)) {
+      last = &page[slot];
+    }
+  }
+
+  if(last == NULL) {
+    return false;
+  }
+
+  memcpy(data, &last[NVM_HEADER_WORDS], length);
+
+  return true;
+}
+
+MSC_Status_TypeDef Nvm_Record_Write(uint32_t *page, uint32_t magic,\
+                                    uint16_t version, const void *data,\
+                                    uint16_t length)
+{
+  nvm_header *header = (nvm_header *)nvm_image;
+  MSC_Status_TypeDef status = mscReturnOk;
+  uint32_t words = 0;
+  uint32_t crc = 0;
+  uint32_t slot = 0;
+  bool erase = false;
+
+  if(length > NVM_MAX_PAYLOAD) {
+    return mscReturnInvalidAddr;
+  }
+
+  memset(nvm_image, 0, sizeof(nvm_image));
+  header->magic = magic;
+  header->version = version;
+  header->length = length;
+  memcpy(&nvm_image[NVM_HEADER_WORDS], data, length);
+
+  words = NVM_HEADER_WORDS + NVM_PAYLOAD_WORDS(length);
+  crc = Crc16_Update(CRC16_INIT, nvm_image, sizeof(nvm_header) + length);
+
+  /* Append behind the records already there; the page is only erased
+   * once it is full, or holds another layout whose slots don't line up.
+   */
+  erase = (page[0] != NVM_ERASED)\
+          && !Nvm_Slot_Valid(page, magic, version, length);
+  while(!erase && !Nvm_Slot_Erased(&page[slot], length)) {
+    slot += NVM_SLOT_WORDS(length);
+    erase = (slot + NVM_SLOT_WORDS(length)) > NVM_PAGE_WORDS;
+  }
+  if(erase) {
+    slot = 0;
+  }
+
+  MSC_Init();
+
+  if(erase) {
+    status = MSC_ErasePage(page);
+  }
+  if(status == mscReturnOk) {
+    status = MSC_WriteWord(&page[slot], nvm_image, words * sizeof(uint32_t));
+  }
+  if(status == mscReturnOk) {
+    status = MSC_WriteWord(&page[slot + words], &crc, sizeof(uint32_t));
+  }
+
+  MSC_Deinit();
+
+  return status;
+}
@@ -0,0 +1,72 @@
+/*
+ * nvm.h
+ *
+ *  Created on: Apr 19, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_NVM_H_
+#define SRC_NVM_H_
+
+#include<stdint.h>
+#include<stdbool.h>
+#include "em_device.h"
+#include "em_msc.h"
+
+/* One kind of record per flash page, taken from the top of the flash
+ * where the image never reaches. Each write appends a copy behind the
+ * last one, so a page is only erased once every FLASH_PAGE_SIZE / (record
+ * size) writes.
+ */
+#define NVM_PAGE(n) ((uint32_t *)(FLASH_BASE + FLASH_SIZE\
+                                  - (((n) + 1) * FLASH_PAGE_SIZE)))
+#define NVM_ADC_CAL_PAGE NVM_PAGE(0)
+#define NVM_OSC_CAL_PAGE NVM_PAGE(1)
+
+/* Largest payload a record can carry */
+#define NVM_MAX_PAYLOAD 32
+
+/* Stored in front of the payload; the CRC-16 of header and payload
+ * follows it in the next word.
+ */
+typedef struct nvm_record_header {
+  uint32_t magic;     /* what the record holds */
+  uint16_t version;   /* layout of the payload */
+  uint16_t length;    /* payload bytes */
+} nvm_header;
+
+/* Function: Nvm_Record_Read(const uint32_t *page, uint32_t magic,
+ *                           uint16_t version, void *data, uint16_t length)
+ * Parameters:
+ *      - const uint32_t *page: the flash page, e.g. NVM_ADC_CAL_PAGE
+ *      - uint32_t magic, uint16_t version: what the caller expects
+ *      - void *data: filled with the payload
+ *      - uint16_t length: payload size the caller expects
+ * Return:
+ *      - true if the page held a matching record with a good CRC
+ * Description:
+ *      - Returns the newest good copy. An erased page, an older layout
+ *        or nothing but torn writes all read as false, and data is left
+ *        untouched.
+ */
+bool Nvm_Record_Read(const uint32_t *page, uint32_t magic, uint16_t version,\
+                     void *data, uint16_t length);
+
+/* Function: Nvm_Record_Write(uint32_t *page, uint32_t magic,
+ *                            uint16_t version, const void *data,
+ *                            uint16_t length)
+ * Parameters:
+ *      - as for Nvm_Record_Read()
+ * Return:
+ *      - mscReturnOk, or the error of the failing erase/write
+ * Description:
+ *      - Write header, payload and CRC into the next erased slot of the
+ *        page, erasing it first only if it is full or holds another
+ *        layout. The CRC goes in last so an interrupted write never
+ *        reads back as valid; the copy before it still does.
+ */
+MSC_Status_TypeDef Nvm_Record_Write(uint32_t *page, uint32_t magic,\
+                                    uint16_t version, const void *data,\
+                                    uint16_t length);
+
+#endif /* SRC_NVM_H_ */
@@ -0,0 +1,313 @@
+/*
+ * osc_cal.c
+ *
+ *  Created on: Apr 27, 2017
+ *      Author: vidursarin
+ */
+
+#include "em_device.h"
+#include "em_cmu.h"
+#include "em_timer.h"
+#include "em_letimer.h"
+#include "sleep_modes.h"
+#include "osc_cal.h"
+
+#define LETIMER_COMP1 1
+
+osc_cal ulfrco_cal;
+
+/* The gate is closed by the LETIMER0 underflow, not by the caller */
+static bool osc_cal_uf_gate = false;
+
+/* Function: Osc_Cal_Start(void)
+ * Description:
+ *      - Start the reference count, in EM1 until CALRDY.
+ */
+static void Osc_Cal_Start(void)
+{
+  blockSleepMode(OSC_CAL_SLEEP_MODE, SLEEP_USER_OSC_CAL);
+  ulfrco_cal.state = OSC_CAL_REF;
+
+  CMU_CalibrateConfig(OSC_CAL_REF_CYCLES, cmuOsc_LFXO, cmuOsc_HFRCO);
+  CMU_IntClear(CMU_IF_CALRDY);
+  CMU_CalibrateStart();
+
+  return;
+}
+
+/* Function: Osc_Cal_Stop(void)
+ * Description:
+ *      - Back to idle from any state, releasing EM1 if it was held.
+ */
+static void Osc_Cal_Stop(void)
+{
+  TIMER_Enable(TIMER0, false);
+  TIMER_Enable(TIMER1, false);
+  if(osc_cal_uf_gate) {
+    LETIMER_IntDisable(LETIMER0, LETIMER_IEN_UF);
+    LETIMER_IntClear(LETIMER0, LETIMER_IFC_UF);
+    osc_cal_uf_gate = false;
+  }
+
+  if((ulfrco_cal.state == OSC_CAL_REF) || (ulfrco_cal.state == OSC_CAL_GATE)) {
+    unblockSleepMode(OSC_CAL_SLEEP_MODE, SLEEP_USER_OSC_CAL);
+  }
+  ulfrco_cal.state = OSC_CAL_IDLE;
+
+  return;
+}
+
+/* Function: Osc_Cal_Store(void)
+ * Description:
+ *      - Write the last good run to flash. The core stalls for the page
+ *        erase, a few ms at most.
+ */
+static void Osc_Cal_Store(void)
+{
+  ulfrco_cal.stored.ticks_per_s = ulfrco_cal.ticks_per_s;
+  ulfrco_cal.stored.temp_mC = ulfrco_cal.last_temp_mC;
+  ulfrco_cal.stored.uptime_s = ulfrco_cal.last_ms / 1000;
+  ulfrco_cal.stored.seq++;
+
+  ulfrco_cal.store_status = Nvm_Record_Write(NVM_OSC_CAL_PAGE, OSC_CAL_MAGIC,\
+                                             OSC_CAL_VERSION,\
+                                             &ulfrco_cal.stored,\
+                                             sizeof(ulfrco_cal.stored));
+  ulfrco_cal.store_pending = false;
+  ulfrco_cal.store_done = true;
+  ulfrco_cal.store_ms = ulfrco_cal.last_ms;
+
+  return;
+}
+
+uint32_t Osc_Cal_Init(uint32_t period_ms, int32_t temp_delta_mC)
+{
+  /* TIMER1 counts the TIMER0 overflows; both are started by hand */
+  TIMER_Init_TypeDef timerInit_TIMER0 =
+  {
+    .enable     = false,
+    .debugRun   = false,
+    .prescale   = timerPrescale1,
+    .clkSel     = timerClkSelHFPerClk,
+    .fallAction = timerInputActionNone,
+    .riseAction = timerInputActionNone,
+    .mode       = timerModeUp,
+    .dmaClrAct  = false,
+    .quadModeX4 = false,
+    .oneShot    = false,
+    .sync       = false,
+  };
+
+  TIMER_Init_TypeDef timerInit_TIMER1 =
+  {
+    .enable     = false,
+    .debugRun   = false,
+    .prescale   = timerPrescale1,
+    .clkSel     = timerClkSelCascade,
+    .fallAction = timerInputActionNone,
+    .riseAction = timerInputActionNone,
+    .mode       = timerModeUp,
+    .dmaClrAct  = false,
+    .quadModeX4 = false,
+    .oneShot    = false,
+    .sync       = false,
+  };
+
+  ulfrco_cal.state = OSC_CAL_IDLE;
+  ulfrco_cal.timer_hz = 0;
+  ulfrco_cal.ticks_per_s = 0;
+  ulfrco_cal.period_ms = period_ms;
+  ulfrco_cal.temp_delta_mC = temp_delta_mC;
+  ulfrco_cal.last_ms = 0;
+  ulfrco_cal.last_temp_mC = 0;
+  ulfrco_cal.runs = 0;
+  ulfrco_cal.rejects = 0;
+  ulfrco_cal.aborts = 0;
+  ulfrco_cal.source = OSC_CAL_NOMINAL;
+  ulfrco_cal.first_ms = 0;
+  ulfrco_cal.store_pending = false;
+  ulfrco_cal.store_done = false;
+  ulfrco_cal.store_ms = 0;
+  ulfrco_cal.store_status = mscReturnOk;
+
+  if(Nvm_Record_Read(NVM_OSC_CAL_PAGE, OSC_CAL_MAGIC, OSC_CAL_VERSION,\
+                     &ulfrco_cal.stored, sizeof(ulfrco_cal.stored))\
+     && (ulfrco_cal.stored.ticks_per_s >= OSC_CAL_MIN_HZ)\
+     && (ulfrco_cal.stored.ticks_per_s <= OSC_CAL_MAX_HZ)) {
+    ulfrco_cal.source = OSC_CAL_FLASH;
+    ulfrco_cal.ticks_per_s = ulfrco_cal.stored.ticks_per_s;
+    ulfrco_cal.last_temp_mC = ulfrco_cal.stored.temp_mC;
+  } else {
+    ulfrco_cal.stored.ticks_per_s = 0;
+    ulfrco_cal.stored.seq = 0;
+  }
+
+  /* The reference; the LEUART setup selects it again later */
+  CMU_OscillatorEnable(cmuOsc_LFXO, true, false);
+
+  CMU_ClockEnable(cmuClock_HFPER, true);
+  CMU_ClockEnable(cmuClock_TIMER0, true);
+  CMU_ClockEnable(cmuClock_TIMER1, true);
+  TIMER_Init(TIMER0, &timerInit_TIMER0);
+  TIMER_Init(TIMER1, &timerInit_TIMER1);
+
+  CMU_IntClear(CMU_IF_CALRDY);
+  CMU_IntEnable(CMU_IEN_CALRDY);
+  NVIC_EnableIRQ(CMU_IRQn);
+
+  return ulfrco_cal.ticks_per_s;
+}
+
+bool Osc_Cal_Poll(uint32_t now_ms, int32_t temp_mC)
+{
+  int32_t moved_mC = temp_mC - ulfrco_cal.last_temp_mC;
+
+  if(ulfrco_cal.store_pending) {
+    Osc_Cal_Store();
+  }
+
+  if(ulfrco_cal.state != OSC_CAL_IDLE) {
+    /* Missed COMP1 or the LFXO never came up; try again next time */
+    Osc_Cal_Stop();
+    ulfrco_cal.aborts++;
+    return false;
+  }
+
+  if(moved_mC < 0) {
+    moved_mC = -moved_mC;
+  }
+  if((ulfrco_cal.runs != 0)\
+     && (now_ms - ulfrco_cal.last_ms < ulfrco_cal.period_ms)\
+     && (moved_mC < ulfrco_cal.temp_delta_mC)) {
+    return false;
+  }
+
+  ulfrco_cal.last_ms = now_ms;
+  ulfrco_cal.last_temp_mC = temp_mC;
+  Osc_Cal_Start();
+
+  return true;
+}
+
+bool Osc_Cal_Gate_Open(void)
+{
+  if(ulfrco_cal.state != OSC_CAL_ARMED) {
+    return false;
+  }
+
+  blockSleepMode(OSC_CAL_SLEEP_MODE, SLEEP_USER_OSC_CAL);
+
+  /* Open the gate; TIMER0 drives the cascade, so start it last */
+  TIMER_CounterSet(TIMER0, 0);
+  TIMER_CounterSet(TIMER1, 0);
+  TIMER_Enable(TIMER1, true);
+  TIMER_Enable(TIMER0, true);
+
+  ulfrco_cal.state = OSC_CAL_GATE;
+
+  return true;
+}
+
+uint32_t Osc_Cal_Gate_Close(uint32_t gate_ticks)
+{
+  uint32_t count = 0;
+  uint32_t ticks_per_s = 0;
+
+  if(ulfrco_cal.state != OSC_CAL_GATE) {
+    return 0;
+  }
+
+  /* Close the gate; stopping TIMER0 freezes TIMER1 as well */
+  TIMER_Enable(TIMER0, false);
+  count = (TIMER_CounterGet(TIMER1) << 16) | TIMER_CounterGet(TIMER0);
+
+  ulfrco_cal.gate_ticks = gate_ticks;
+  Osc_Cal_Stop();
+
+  if(count == 0) {
+    ulfrco_cal.rejects++;
+    return 0;
+  }
+  ticks_per_s = ((uint64_t)ulfrco_cal.gate_ticks * ulfrco_cal.timer_hz\
+                 + count / 2) / count;
+  if((ticks_per_s < OSC_CAL_MIN_HZ) || (ticks_per_s > OSC_CAL_MAX_HZ)) {
+    ulfrco_cal.rejects++;
+    return 0;
+  }
+
+  if(ulfrco_cal.runs == 0) {
+    ulfrco_cal.first_ms = ulfrco_cal.last_ms;
+  }
+  ulfrco_cal.ticks_per_s = ticks_per_s;
+  ulfrco_cal.runs++;
+
+  if(ulfrco_cal.stored.ticks_per_s == 0) {
+    ulfrco_cal.store_pending = true;
+  } else if(((ticks_per_s + OSC_CAL_STORE_TICKS\
+              <= ulfrco_cal.stored.ticks_per_s)\
+             || (ticks_per_s >= ulfrco_cal.stored.ticks_per_s\
+                                + OSC_CAL_STORE_TICKS))\
+            && (!ulfrco_cal.store_done\
+                || (ulfrco_cal.last_ms - ulfrco_cal.store_ms\
+                    >= OSC_CAL_STORE_PERIOD_MS))) {
+    ulfrco_cal.store_pending = true;
+  }
+
+  return ticks_per_s;
+}
+
+void Osc_Cal_Abort(void)
+{
+  if(ulfrco_cal.state != OSC_CAL_IDLE) {
+    Osc_Cal_Stop();
+    ulfrco_cal.aborts++;
+  }
+
+  return;
+}
+
+void Osc_Cal_Comp1(void)
+{
+  if(!Osc_Cal_Gate_Open()) {
+    return;
+  }
+
+  ulfrco_cal.gate_ticks = LETIMER_CompareGet(LETIMER0, LETIMER_COMP1) + 1;
+  osc_cal_uf_gate = true;
+  LETIMER_IntClear(LETIMER0, LETIMER_IFC_UF);
+  LETIMER_IntEnable(LETIMER0, LETIMER_IEN_UF);
+
+  return;
+}
+
+uint32_t Osc_Cal_Underflow(void)
+{
+  return Osc_Cal_Gate_Close(ulfrco_cal.gate_ticks);
+}
+
+/* Function: CMU_IRQHandler(void)
+ * Description:
+ *      - The reference count is done: work out the real TIMER0 clock and
+ *        wait for COMP1 in EM2.
+ */
+void CMU_IRQHandler(void)
+{
+  uint32_t flags = CMU_IntGet();
+  uint64_t hfrco_hz = 0;
+
+  CMU_IntClear(flags);
+
+  if((flags & CMU_IF_CALRDY) && (ulfrco_cal.state == OSC_CAL_REF)) {
+    hfrco_hz = ((uint64_t)CMU_CalibrateCountGet() * LFXO_HZ)\
+               / OSC_CAL_REF_CYCLES;
+
+    /* HFCLK runs on the HFRCO; TIMER0 gets it through the HFPER divider */
+    ulfrco_cal.timer_hz = (hfrco_hz * CMU_ClockFreqGet(cmuClock_TIMER0))\
+                          / CMU_ClockFreqGet(cmuClock_HF);
+
+    unblockSleepMode(OSC_CAL_SLEEP_MODE, SLEEP_USER_OSC_CAL);
+    ulfrco_cal.state = OSC_CAL_ARMED;
+  }
+
+  return;
+}
@@ -0,0 +1,178 @@
+/*
+ * osc_cal.h
+ *
+ *  Created on: Apr 27, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_OSC_CAL_H_
+#define SRC_OSC_CAL_H_
+
+#include<stdint.h>
+#include<stdbool.h>
+#include "nvm.h"
+
+/* ULFRCO calibration, run from interrupts while LETIMER0 keeps going:
+ *  1. The CMU counts HFRCO cycles over OSC_CAL_REF_CYCLES of the LFXO,
+ *     which gives the real TIMER0 clock (CALRDY interrupt).
+ *  2. TIMER0/TIMER1, cascaded on HFPERCLK, count from the LETIMER0 COMP1
+ *     interrupt to the underflow that follows it: exactly COMP1 + 1
+ *     ULFRCO ticks.
+ * The core stays in EM1 for the two measurements only (about 31 ms and
+ * the on period), and waits for COMP1 in EM2.
+ */
+#define LFXO_HZ             32768
+#define OSC_CAL_REF_CYCLES  1024    /* keeps a 28 MHz HFRCO in the 20 bit up counter */
+#define OSC_CAL_SLEEP_MODE  sleepEM1
+
+/* A measured rate outside this is a bad measurement, not drift */
+#define OSC_CAL_MIN_HZ      500
+#define OSC_CAL_MAX_HZ      2000
+
+/* With the soft timers COMP1 is theirs, so the gate is opened and closed
+ * by two timer expiries instead: OSC_CAL_ARM_TICKS after the run starts
+ * (time for the reference count) and OSC_CAL_GATE_TICKS after that.
+ */
+#define OSC_CAL_ARM_TICKS   64
+#define OSC_CAL_GATE_TICKS  256
+
+/* The last good rate is kept in flash and used from the next boot on,
+ * while the first calibration refreshes it in the background. To spare
+ * the flash it is only rewritten once a run differs from it by
+ * OSC_CAL_STORE_TICKS (1% of the nominal 1 kHz, well clear of the run
+ * to run jitter), and then at most once per OSC_CAL_STORE_PERIOD_MS
+ * unless the flash holds no rate at all. Bump the version when the
+ * record layout changes.
+ */
+#define OSC_CAL_MAGIC           0x4343534F /* "OSCC" */
+#define OSC_CAL_VERSION         1
+#define OSC_CAL_STORE_TICKS     10
+#define OSC_CAL_STORE_PERIOD_MS 3600000
+
+typedef struct osc_cal_record {
+  uint32_t ticks_per_s;       /* ULFRCO measured against the LFXO */
+  int32_t temp_mC;            /* temperature at the time */
+  uint32_t uptime_s;          /* when, counted from that boot */
+  uint32_t seq;               /* counts the stores */
+} osc_cal_rec;
+
+typedef enum osc_calibration_source {
+  OSC_CAL_NOMINAL = 0,        /* IDEAL_ULFRCO_CNT until the first run */
+  OSC_CAL_FLASH = 1,
+  OSC_CAL_MEASURED = 2
+} osc_cal_source;
+
+typedef enum {
+  OSC_CAL_IDLE,
+  OSC_CAL_REF,        /* CMU counting the HFRCO against the LFXO */
+  OSC_CAL_ARMED,      /* waiting in EM2 for the next COMP1 */
+  OSC_CAL_GATE        /* TIMER0/TIMER1 running until the underflow */
+} osc_cal_state;
+
+typedef struct osc_calibration {
+  osc_cal_state state;
+  uint32_t timer_hz;          /* TIMER0 clock, from the last reference */
+  uint32_t ticks_per_s;       /* ULFRCO, from the last good run */
+  uint32_t gate_ticks;        /* ULFRCO ticks in the current gate */
+  uint32_t period_ms;         /* rerun at least this often */
+  int32_t temp_delta_mC;      /* or once the temperature moved this much */
+  uint32_t last_ms;
+  int32_t last_temp_mC;
+  uint32_t runs;
+  uint32_t rejects;           /* out of OSC_CAL_MIN_HZ..OSC_CAL_MAX_HZ */
+  uint32_t aborts;            /* still running at the next COMP0 */
+  osc_cal_source source;      /* of the rate LETIMER0 started on */
+  uint32_t first_ms;          /* uptime of the first good run */
+  osc_cal_rec stored;         /* what the flash holds */
+  bool store_pending;
+  bool store_done;            /* stored at least once since boot */
+  uint32_t store_ms;          /* uptime of the last store */
+  MSC_Status_TypeDef store_status;
+} osc_cal;
+
+extern osc_cal ulfrco_cal;
+
+/* Function: Osc_Cal_Init(uint32_t period_ms, int32_t temp_delta_mC)
+ * Parameters:
+ *      - uint32_t period_ms: recalibrate at least this often
+ *      - int32_t temp_delta_mC: recalibrate when the temperature moved
+ *        this far from the last calibration
+ * Return:
+ *      - the ULFRCO rate from the flash record, or 0 if there is no
+ *        usable one and LETIMER0 has to start on the nominal rate
+ * Description:
+ *      - Sets up the CMU interrupt and the TIMER0/TIMER1 cascade. The
+ *        first calibration starts from the first Osc_Cal_Poll() either
+ *        way. Does not wait for the LFXO, the reference count starts
+ *        once it is up.
+ */
+uint32_t Osc_Cal_Init(uint32_t period_ms, int32_t temp_delta_mC);
+
+/* Function: Osc_Cal_Poll(uint32_t now_ms, int32_t temp_mC)
+ * Parameters:
+ *      - uint32_t now_ms: time since boot
+ *      - int32_t temp_mC: latest temperature reading
+ * Return:
+ *      - true if a calibration was started
+ * Description:
+ *      - Call once per LETIMER0 period from the COMP0 interrupt. A run
+ *        that has not finished by then is dropped and retried.
+ *      - Also stores the result of the last run, if it has to be, here
+ *        rather than in the underflow that produced it.
+ */
+bool Osc_Cal_Poll(uint32_t now_ms, int32_t temp_mC);
+
+/* Function: Osc_Cal_Gate_Open(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - false if the reference count is not done yet
+ * Description:
+ *      - Start counting HFPERCLK. Call on a ULFRCO tick, i.e. from a
+ *        LETIMER0 or RTC interrupt.
+ */
+bool Osc_Cal_Gate_Open(void);
+
+/* Function: Osc_Cal_Gate_Close(uint32_t gate_ticks)
+ * Parameters:
+ *      - uint32_t gate_ticks: ULFRCO ticks since Osc_Cal_Gate_Open()
+ * Return:
+ *      - the new ULFRCO rate in ticks per second, or 0 if there is none
+ * Description:
+ *      - Call from a LETIMER0 interrupt as well.
+ */
+uint32_t Osc_Cal_Gate_Close(uint32_t gate_ticks);
+
+/* Function: Osc_Cal_Abort(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *      - Drop the run in progress, if any.
+ */
+void Osc_Cal_Abort(void);
+
+/* Function: Osc_Cal_Comp1(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *      - Call first thing from the LETIMER0 COMP1 interrupt; opens the
+ *        gate if a run is armed.
+ */
+void Osc_Cal_Comp1(void);
+
+/* Function: Osc_Cal_Underflow(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - the new ULFRCO rate in ticks per second, or 0 if there is none
+ * Description:
+ *      - Call first thing from the LETIMER0 UF interrupt. The interrupt
+ *        is only enabled while the gate is open.
+ */
+uint32_t Osc_Cal_Underflow(void);
+
+#endif /* SRC_OSC_CAL_H_ */
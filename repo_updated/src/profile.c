@@ -0,0 +1,67 @@
+/*
+ * profile.c
+ *
+ *  Created on: Apr 10, 2017
+ *      Author: vidursarin
+ */
+
+#include "profile.h"
+
+uint32_t boot_phase_us[BOOT_PHASES];
+
+static uint32_t boot_mark = 0;
+
+/* Function: Profile_Init(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *      - Enable the trace block and start the DWT cycle counter.
+ */
+void Profile_Init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  boot_mark = 0;
+
+  return;
+}
+
+/* Function: Profile_Cycles_To_us(uint32_t cycles)
+ * Parameters:
+ *      uint32_t cycles - number of core cycles
+ * Return:
+ *      - the same interval in micro seconds at the current core clock
+ * Description:
+ *      - Convert a cycle count to time.
+ */
+uint32_t Profile_Cycles_To_us(uint32_t cycles)
+{
+  uint32_t cycles_per_us = CMU_ClockFreqGet(cmuClock_CORE)/1000000;
+
+  if(cycles_per_us == 0) {
+    cycles_per_us = 1;
+  }
+
+  return (cycles/cycles_per_us);
+}
+
+/* Function: Profile_Boot_Mark(boot_phase phase)
+ * Parameters:
+ *      boot_phase phase - the phase that just ended
+ * Return:
+ *      void
+ * Description:
+ *      - Time the phase from the previous mark.
+ */
+void Profile_Boot_Mark(boot_phase phase)
+{
+  uint32_t now = Profile_Get_Cycles();
+
+  boot_phase_us[phase] = Profile_Cycles_To_us(now - boot_mark);
+  boot_mark = now;
+
+  return;
+}
@@ -0,0 +1,57 @@
+/*
+ * profile.h
+ *
+ *  Created on: Apr 10, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_PROFILE_H_
+#define SRC_PROFILE_H_
+
+#include "em_device.h"
+#include "em_cmu.h"
+
+/* Function: Profile_Get_Cycles(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - the current value of the DWT cycle counter
+ * Description:
+ *      - The counter only runs while the core is clocked, so the
+ *        difference of two reads is the time the core spent awake.
+ */
+static inline uint32_t Profile_Get_Cycles(void)
+{
+  return DWT->CYCCNT;
+}
+
+/* Boot phases, in the order main() runs them */
+typedef enum boot_phase {
+  BOOT_CLOCKS = 0,      /* Central_Clock_Setup() */
+  BOOT_LETIMER = 1,     /* Config_LETIMER0(), with the ULFRCO calibration */
+  BOOT_ADC = 2,         /* ADC0 setup and calibration */
+  BOOT_MISC = 3,        /* the rest, benchmarks included */
+  BOOT_LEUART = 4,      /* Setup_LEUART(), waits for the LFXO */
+  BOOT_PHASES = 5
+} boot_phase;
+
+/* Time spent in each boot phase, in us */
+extern uint32_t boot_phase_us[BOOT_PHASES];
+
+void Profile_Init(void);
+
+uint32_t Profile_Cycles_To_us(uint32_t cycles);
+
+/* Function: Profile_Boot_Mark(boot_phase phase)
+ * Parameters:
+ *      boot_phase phase - the phase that just ended
+ * Return:
+ *      void
+ * Description:
+ *      - Charge the time since the previous mark (or Profile_Init())
+ *        to the phase. The core does not sleep during boot, so the
+ *        cycle counter is wall time here.
+ */
+void Profile_Boot_Mark(boot_phase phase);
+
+#endif /* SRC_PROFILE_H_ */
@@ -0,0 +1,86 @@
+/*
+ * ring_bench.c
+ *
+ *  Created on: Apr 21, 2017
+ *      Author: vidursarin
+ */
+
+#include "ring_bench.h"
+#include "circular_buffer.h"
+#include "spsc_ring.h"
+#include "profile.h"
+#include "em_int.h"
+
+/* One frame in, one frame out: 2 adds and 5 removes for c_buf, one
+ * block write and 5 pops for the ring
+ */
+#define RING_BENCH_CBUF_OPS (2 + RING_BENCH_FRAME_LEN)
+#define RING_BENCH_SPSC_OPS (1 + RING_BENCH_FRAME_LEN)
+
+ring_bench ring_bench_result = {0};
+ring_suite_result\
+  ring_suite_results[RING_IMPLS][RING_SUITE_SIZES][RING_SUITE_FILLS];
+
+static uint8_t bench_storage[16];
+static spsc_ring bench_ring;
+
+void Ring_Benchmark(void)
+{
+  volatile float temp = 25.5f;
+  volatile uint8_t led = 1;
+  uint8_t frame[RING_BENCH_FRAME_LEN];
+  uint8_t data = 0;
+  uint32_t cycles = 0;
+  uint32_t start = 0;
+  c_buf cbuf;
+  uint8_t frames;
+  uint8_t cnt;
+
+  /* The old path: a fresh buffer per cycle, masked accesses */
+  for(frames = 0; frames < RING_BENCH_FRAMES; frames++) {
+    start = Profile_Get_Cycles();
+
+    Alloc_Buffer(&cbuf, RING_BENCH_FRAME_LEN);
+    INT_Disable();
+    add_to_buffer(&cbuf, (void *)&temp, sizeof(float));
+    add_to_buffer(&cbuf, (void *)&led, sizeof(uint8_t));
+    INT_Enable();
+
+    for(cnt = 0; cnt < RING_BENCH_FRAME_LEN; cnt++) {
+      INT_Disable();
+      remove_from_buffer(&cbuf, &data, sizeof(uint8_t));
+      INT_Enable();
+    }
+    free_buffer(cbuf.buf_start);
+
+    cycles += Profile_Get_Cycles() - start;
+  }
+  ring_bench_result.cbuf_frame_cycles = cycles / RING_BENCH_FRAMES;
+  ring_bench_result.cbuf_op_cycles = cycles\
+                          / (RING_BENCH_FRAMES * RING_BENCH_CBUF_OPS);
+
+  /* The new path: static ring, nothing masked */
+  Spsc_Init(&bench_ring, bench_storage, sizeof(bench_storage));
+  cycles = 0;
+  for(frames = 0; frames < RING_BENCH_FRAMES; frames++) {
+    start = Profile_Get_Cycles();
+
+    memcpy(frame, (void *)&temp, sizeof(float));
+    frame[RING_BENCH_FRAME_LEN - 1] = led;
+    Spsc_Write(&bench_ring, frame, sizeof(frame));
+
+    for(cnt = 0; cnt < RING_BENCH_FRAME_LEN; cnt++) {
+      Spsc_Pop(&bench_ring, &data);
+    }
+
+    cycles += Profile_Get_Cycles() - start;
+  }
+  ring_bench_result.spsc_frame_cycles = cycles / RING_BENCH_FRAMES;
+  ring_bench_result.spsc_op_cycles = cycles\
+                          / (RING_BENCH_FRAMES * RING_BENCH_SPSC_OPS);
+
+  Ring_Suite_Run(Profile_Get_Cycles, CMU_ClockFreqGet(cmuClock_CORE),\
+                 ring_suite_results);
+
+  return;
+}
@@ -0,0 +1,47 @@
+/*
+ * ring_bench.h
+ *
+ *  Created on: Apr 21, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_RING_BENCH_H_
+#define SRC_RING_BENCH_H_
+
+#include<stdint.h>
+#include "ring_suite.h"
+
+/* Telemetry frames pushed through each implementation */
+#define RING_BENCH_FRAMES 64
+
+/* Size of one telemetry frame: float temperature + LED status */
+#define RING_BENCH_FRAME_LEN 5
+
+/* Average core cycles, per frame (queue it, then drain it byte by byte
+ * as the LEUART0 handler does) and per single add/remove operation
+ */
+typedef struct ring_benchmark {
+  uint32_t cbuf_frame_cycles;
+  uint32_t cbuf_op_cycles;
+  uint32_t spsc_frame_cycles;
+  uint32_t spsc_op_cycles;
+} ring_bench;
+
+extern ring_bench ring_bench_result;
+extern ring_suite_result\
+  ring_suite_results[RING_IMPLS][RING_SUITE_SIZES][RING_SUITE_FILLS];
+
+/* Function: Ring_Benchmark(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *      - Time the old telemetry path (malloc'd c_buf, interrupts masked
+ *        around every access) against the static SPSC ring. Results go
+ *        to ring_bench_result. Then run the micro-benchmark suite in
+ *        core cycles, results in ring_suite_results.
+ */
+void Ring_Benchmark(void);
+
+#endif /* SRC_RING_BENCH_H_ */
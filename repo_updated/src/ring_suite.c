@@ -0,0 +1,167 @@
+/*
+ * ring_suite.c
+ *
+ *  Created on: Apr 22, 2017
+ *      Author: vidursarin
+ */
+
+#include "ring_suite.h"
+#include "circular_buffer.h"
+#include "spsc_ring.h"
+#include "typed_ring.h"
+
+typedef struct ring_suite_struct {
+  uint8_t bytes[12];
+} suite_struct;
+
+TYPED_RING_DECLARE(suite_byte_ring, Suite_Byte, uint8_t, 256)
+TYPED_RING_DECLARE(suite_word_ring, Suite_Word, uint32_t, 64)
+TYPED_RING_DECLARE(suite_struct_ring, Suite_Struct, suite_struct, 16)
+
+static suite_byte_ring suite_bytes;
+static suite_word_ring suite_words;
+static suite_struct_ring suite_structs;
+
+/* Pre-fill one typed ring and time RING_SUITE_OPS push/pop pairs */
+#define RING_SUITE_TYPED(Prefix, ring, elem_t, capacity, fill, acc)\
+  do {\
+    elem_t item = {0};\
+    uint16_t n = ((capacity) * (fill)) / 100;\
+\
+    Prefix##_Init(&(ring));\
+    while(n--) {\
+      Prefix##_Push(&(ring), &item);\
+    }\
+    for(cnt = 0; cnt < RING_SUITE_OPS; cnt++) {\
+      start = clock();\
+      Prefix##_Push(&(ring), &item);\
+      Ring_Suite_Add((acc), clock() - start, overhead);\
+\
+      start = clock();\
+      Prefix##_Pop(&(ring), &item);\
+      Ring_Suite_Add((acc), clock() - start, overhead);\
+    }\
+  } while(0)
+
+static const uint8_t suite_sizes[RING_SUITE_SIZES] = RING_SUITE_SIZE_LIST;
+static const uint8_t suite_fills[RING_SUITE_FILLS] = RING_SUITE_FILL_LIST;
+
+static uint8_t suite_spsc_storage[RING_SUITE_SPSC_BYTES];
+
+/* Running numbers of one case */
+typedef struct ring_suite_acc {
+  uint32_t total;
+  uint32_t max;
+  uint32_t ops;
+} suite_acc;
+
+static void Ring_Suite_Add(suite_acc *acc, uint32_t ticks, uint32_t overhead)
+{
+  ticks = (ticks > overhead) ? (ticks - overhead) : 0;
+
+  acc->total += ticks;
+  acc->ops++;
+  if(ticks > acc->max) {
+    acc->max = ticks;
+  }
+
+  return;
+}
+
+static void Ring_Suite_Store(ring_suite_result *result, const suite_acc *acc,\
+                             uint32_t ticks_per_s)
+{
+  result->avg_ticks = acc->total / acc->ops;
+  result->max_ticks = acc->max;
+  result->ops_per_s = (result->avg_ticks != 0) ?\
+                        (ticks_per_s / result->avg_ticks) : 0;
+
+  return;
+}
+
+void Ring_Suite_Run(ring_suite_clock clock, uint32_t ticks_per_s,\
+        ring_suite_result results[RING_IMPLS][RING_SUITE_SIZES][RING_SUITE_FILLS])
+{
+  uint8_t element[12] = {0x5A, 0x00, 0xA5, 0x00};
+  uint32_t overhead = 0xFFFFFFFF;
+  uint32_t start = 0;
+  uint32_t ticks = 0;
+  uint8_t size_idx;
+  uint8_t fill_idx;
+  uint16_t prefill;
+  uint16_t cnt;
+  spsc_ring ring;
+  c_buf cbuf;
+
+  /* Cheapest back to back read of the clock */
+  for(cnt = 0; cnt < 16; cnt++) {
+    start = clock();
+    ticks = clock() - start;
+    if(ticks < overhead) {
+      overhead = ticks;
+    }
+  }
+
+  for(size_idx = 0; size_idx < RING_SUITE_SIZES; size_idx++) {
+    uint8_t size = suite_sizes[size_idx];
+
+    for(fill_idx = 0; fill_idx < RING_SUITE_FILLS; fill_idx++) {
+      suite_acc acc_cbuf = {0};
+      suite_acc acc_spsc = {0};
+      suite_acc acc_typed = {0};
+
+      /* c_buf */
+      Alloc_Buffer(&cbuf, RING_SUITE_CBUF_BYTES);
+      prefill = ((RING_SUITE_CBUF_BYTES / size) * suite_fills[fill_idx]) / 100;
+      for(cnt = 0; cnt < prefill; cnt++) {
+        add_to_buffer(&cbuf, element, size);
+      }
+      for(cnt = 0; cnt < RING_SUITE_OPS; cnt++) {
+        start = clock();
+        add_to_buffer(&cbuf, element, size);
+        Ring_Suite_Add(&acc_cbuf, clock() - start, overhead);
+
+        start = clock();
+        remove_from_buffer(&cbuf, element, size);
+        Ring_Suite_Add(&acc_cbuf, clock() - start, overhead);
+      }
+      free_buffer(cbuf.buf_start);
+      Ring_Suite_Store(&results[RING_IMPL_CBUF][size_idx][fill_idx],\
+                       &acc_cbuf, ticks_per_s);
+
+      /* SPSC ring */
+      Spsc_Init(&ring, suite_spsc_storage, RING_SUITE_SPSC_BYTES);
+      prefill = ((RING_SUITE_SPSC_BYTES / size) * suite_fills[fill_idx]) / 100;
+      for(cnt = 0; cnt < prefill; cnt++) {
+        Spsc_Write(&ring, element, size);
+      }
+      for(cnt = 0; cnt < RING_SUITE_OPS; cnt++) {
+        start = clock();
+        Spsc_Write(&ring, element, size);
+        Ring_Suite_Add(&acc_spsc, clock() - start, overhead);
+
+        start = clock();
+        Spsc_Read(&ring, element, size);
+        Ring_Suite_Add(&acc_spsc, clock() - start, overhead);
+      }
+      Ring_Suite_Store(&results[RING_IMPL_SPSC][size_idx][fill_idx],\
+                       &acc_spsc, ticks_per_s);
+
+      /* Typed ring of the matching element type */
+      if(size == sizeof(uint8_t)) {
+        RING_SUITE_TYPED(Suite_Byte, suite_bytes, uint8_t, 256,\
+                         suite_fills[fill_idx], &acc_typed);
+      } else if(size == sizeof(uint32_t)) {
+        RING_SUITE_TYPED(Suite_Word, suite_words, uint32_t, 64,\
+                         suite_fills[fill_idx], &acc_typed);
+      } else {
+        RING_SUITE_TYPED(Suite_Struct, suite_structs, suite_struct, 16,\
+                         suite_fills[fill_idx], &acc_typed);
+      }
+      Ring_Suite_Store(&results[RING_IMPL_TYPED][size_idx][fill_idx],\
+                       &acc_typed, ticks_per_s);
+    }
+  }
+
+  return;
+}
@@ -0,0 +1,65 @@
+/*
+ * ring_suite.h
+ *
+ *  Created on: Apr 22, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_RING_SUITE_H_
+#define SRC_RING_SUITE_H_
+
+#include<stdint.h>
+
+/* Element sizes: byte, word and a stats_summary sized struct */
+#define RING_SUITE_SIZES 3
+#define RING_SUITE_SIZE_LIST {1, 4, 12}
+
+/* Fill levels the operations run at, in percent of the capacity */
+#define RING_SUITE_FILLS 3
+#define RING_SUITE_FILL_LIST {0, 50, 90}
+
+/* Add/remove pairs timed per case */
+#define RING_SUITE_OPS 128
+
+/* Capacities: c_buf sizes are uint8_t, the SPSC ring needs a power of
+ * two. Both hold a whole number of every element size. The typed rings
+ * hold 256 bytes worth of elements, rounded down to a power of two.
+ */
+#define RING_SUITE_CBUF_BYTES 240
+#define RING_SUITE_SPSC_BYTES 256
+
+typedef enum ring_suite_implementation {
+  RING_IMPL_CBUF = 0,
+  RING_IMPL_SPSC = 1,
+  RING_IMPL_TYPED = 2,    /* TYPED_RING_DECLARE(), one instance per size */
+  RING_IMPLS = 3
+} ring_impl;
+
+/* Per case, in ticks of the clock handed to Ring_Suite_Run() */
+typedef struct ring_suite_result {
+  uint32_t avg_ticks;   /* per add or remove */
+  uint32_t max_ticks;   /* worst single add or remove */
+  uint32_t ops_per_s;
+} ring_suite_result;
+
+/* Tick source, e.g. Profile_Get_Cycles on target */
+typedef uint32_t (*ring_suite_clock)(void);
+
+/* Function: Ring_Suite_Run(ring_suite_clock clock, uint32_t ticks_per_s,
+ *            ring_suite_result
+ *              results[RING_IMPLS][RING_SUITE_SIZES][RING_SUITE_FILLS])
+ * Parameters:
+ *      - ring_suite_clock clock, uint32_t ticks_per_s: timing source
+ *      - results: one entry per implementation, size and fill level
+ * Return:
+ *      void
+ * Description:
+ *      - For every case, pre-fill the ring to the fill level and time
+ *        RING_SUITE_OPS single adds and removes. The clock overhead is
+ *        measured first and taken off every sample. No registers are
+ *        touched, so this runs on a host as well as on the target.
+ */
+void Ring_Suite_Run(ring_suite_clock clock, uint32_t ticks_per_s,\
+        ring_suite_result results[RING_IMPLS][RING_SUITE_SIZES][RING_SUITE_FILLS]);
+
+#endif /* SRC_RING_SUITE_H_ */
@@ -0,0 +1,235 @@
+/*
+ * robust_filter.c
+ *
+ *  Created on: Apr 18, 2017
+ *      Author: vidursarin
+ */
+
+#include "robust_filter.h"
+
+/* Working copy for the selections; the DMA buffer stays untouched */
+static int16_t filter_scratch[FILTER_MAX_SAMPLES];
+
+static uint16_t Filter_Copy(const volatile int16_t *samples, uint16_t n)
+{
+  uint16_t cnt;
+
+  if(n > FILTER_MAX_SAMPLES) {
+    n = FILTER_MAX_SAMPLES;
+  }
+
+  for(cnt = 0; cnt < n; cnt++) {
+    filter_scratch[cnt] = samples[cnt];
+  }
+
+  return n;
+}
+
+/* Function: Filter_Select(int16_t *buf, uint16_t lo, uint16_t hi,
+ *                         uint16_t k)
+ * Description:
+ *    - Quickselect: afterwards buf[k] holds the k-th smallest of
+ *      buf[lo..hi], everything left of it is <= and everything right of
+ *      it is >=. Median of three pivot and Hoare partitioning, which
+ *      keeps the split balanced on the many equal codes an ADC burst
+ *      has. Small ranges are finished with an insertion sort.
+ */
+static void Filter_Select(int16_t *buf, uint16_t lo, uint16_t hi, uint16_t k)
+{
+  while((hi - lo) > FILTER_INSERTION_CUTOFF) {
+    uint16_t mid = lo + ((hi - lo) >> 1);
+    int16_t tmp;
+
+    /* Order buf[lo], buf[mid], buf[hi]; the middle one is the pivot */
+    if(buf[mid] < buf[lo]) {
+      tmp = buf[mid]; buf[mid] = buf[lo]; buf[lo] = tmp;
+    }
+    if(buf[hi] < buf[lo]) {
+      tmp = buf[hi]; buf[hi] = buf[lo]; buf[lo] = tmp;
+    }
+    if(buf[hi] < buf[mid]) {
+      tmp = buf[hi]; buf[hi] = buf[mid]; buf[mid] = tmp;
+    }
+
+    int16_t pivot = buf[mid];
+    int32_t i = lo;
+    int32_t j = hi;
+
+    while(i <= j) {
+      while(buf[i] < pivot) {
+        i++;
+      }
+      while(buf[j] > pivot) {
+        j--;
+      }
+      if(i <= j) {
+        tmp = buf[i]; buf[i] = buf[j]; buf[j] = tmp;
+        i++;
+        j--;
+      }
+    }
+
+    /* buf[lo..j] <= pivot <= buf[i..hi], anything between equals it */
+    if(k <= j) {
+      hi = j;
+    } else if(k >= i) {
+      lo = i;
+    } else {
+      return;
+    }
+  }
+
+  /* Insertion sort of what is left */
+  uint16_t cnt;
+  for(cnt = lo + 1; cnt <= hi; cnt++) {
+    int16_t value = buf[cnt];
+    int32_t pos = cnt - 1;
+
+    while((pos >= lo) && (buf[pos] > value)) {
+      buf[pos + 1] = buf[pos];
+      pos--;
+    }
+    buf[pos + 1] = value;
+  }
+
+  return;
+}
+
+/* Function: Filter_Median_Of(int16_t *buf, uint16_t n)
+ * Description:
+ *    - Median of buf[0..n-1] in Q8, reorders buf.
+ */
+static int32_t Filter_Median_Of(int16_t *buf, uint16_t n)
+{
+  uint16_t half = n >> 1;
+  int32_t upper;
+  int32_t lower;
+  uint16_t cnt;
+
+  Filter_Select(buf, 0, n - 1, half);
+  upper = buf[half];
+
+  if(n & 1) {
+    return upper << FILTER_Q_BITS;
+  }
+
+  /* Even n: the other middle sample is the largest of the lower half */
+  lower = buf[0];
+  for(cnt = 1; cnt < half; cnt++) {
+    if(buf[cnt] > lower) {
+      lower = buf[cnt];
+    }
+  }
+
+  return (lower + upper) << (FILTER_Q_BITS - 1);
+}
+
+int32_t Filter_Reduce(filter_kind kind, const volatile int16_t *samples,\
+                      uint16_t n)
+{
+  switch(kind) {
+    case FILTER_TRIMMED_MEAN:
+      return Filter_Trimmed_Mean(samples, n);
+    case FILTER_MEDIAN:
+      return Filter_Median(samples, n);
+    case FILTER_HAMPEL:
+      return Filter_Hampel(samples, n);
+    case FILTER_MEAN:
+    default:
+      return Filter_Mean(samples, n);
+  }
+}
+
+int32_t Filter_Mean(const volatile int16_t *samples, uint16_t n)
+{
+  int32_t sum = 0;
+  uint16_t cnt;
+
+  if(n == 0) {
+    return 0;
+  }
+
+  for(cnt = 0; cnt < n; cnt++) {
+    sum += samples[cnt];
+  }
+
+  return (sum << FILTER_Q_BITS) / n;
+}
+
+int32_t Filter_Trimmed_Mean(const volatile int16_t *samples, uint16_t n)
+{
+  uint16_t trim;
+  uint16_t cnt;
+  int32_t sum = 0;
+
+  n = Filter_Copy(samples, n);
+  trim = n >> FILTER_TRIM_SHIFT;
+
+  if(trim == 0) {
+    return Filter_Mean(samples, n);
+  }
+
+  /* Low tail left of trim, then the high tail right of n-1-trim. The
+   * second selection only has to look at what the first put on the
+   * right.
+   */
+  Filter_Select(filter_scratch, 0, n - 1, trim);
+  Filter_Select(filter_scratch, trim, n - 1, n - 1 - trim);
+
+  for(cnt = trim; cnt < (n - trim); cnt++) {
+    sum += filter_scratch[cnt];
+  }
+
+  return (sum << FILTER_Q_BITS) / (n - (2 * trim));
+}
+
+int32_t Filter_Median(const volatile int16_t *samples, uint16_t n)
+{
+  if(n == 0) {
+    return 0;
+  }
+
+  n = Filter_Copy(samples, n);
+
+  return Filter_Median_Of(filter_scratch, n);
+}
+
+int32_t Filter_Hampel(const volatile int16_t *samples, uint16_t n)
+{
+  int32_t median_q;
+  int32_t mad_q;
+  int32_t bound_q;
+  int32_t sum = 0;
+  uint16_t kept = 0;
+  uint16_t cnt;
+
+  if(n == 0) {
+    return 0;
+  }
+
+  n = Filter_Copy(samples, n);
+  median_q = Filter_Median_Of(filter_scratch, n);
+
+  /* Absolute deviations, in half codes so the Q7 median stays exact */
+  for(cnt = 0; cnt < n; cnt++) {
+    int32_t dev = (samples[cnt] << 1) - (median_q >> (FILTER_Q_BITS - 1));
+    filter_scratch[cnt] = (dev < 0) ? -dev : dev;
+  }
+  mad_q = Filter_Median_Of(filter_scratch, n) >> 1;
+
+  if(mad_q < (1 << FILTER_Q_BITS)) {
+    mad_q = 1 << FILTER_Q_BITS;
+  }
+  bound_q = (mad_q * FILTER_HAMPEL_K_Q8) >> FILTER_Q_BITS;
+
+  for(cnt = 0; cnt < n; cnt++) {
+    int32_t dev_q = (samples[cnt] << FILTER_Q_BITS) - median_q;
+
+    if((dev_q <= bound_q) && (dev_q >= -bound_q)) {
+      sum += samples[cnt];
+      kept++;
+    }
+  }
+
+  return (sum << FILTER_Q_BITS) / kept;
+}
@@ -0,0 +1,84 @@
+/*
+ * robust_filter.h
+ *
+ *  Created on: Apr 18, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_ROBUST_FILTER_H_
+#define SRC_ROBUST_FILTER_H_
+
+#include<stdint.h>
+
+/* Fractional bits of the reduced value, same as the stats mean */
+#define FILTER_Q_BITS 8
+
+/* Largest buffer the kernels accept (size of the scratch copy) */
+#define FILTER_MAX_SAMPLES 750
+
+/* Trimmed mean: drop n/2^FILTER_TRIM_SHIFT samples at each end */
+#define FILTER_TRIM_SHIFT 3
+
+/* Hampel: reject |x - median| > K * 1.4826 * MAD with K = 3, in Q8 */
+#define FILTER_HAMPEL_K_Q8 1139
+
+/* Partitions this small are finished with an insertion sort */
+#define FILTER_INSERTION_CUTOFF 16
+
+/* The available reductions */
+typedef enum robust_filter_kind {
+  FILTER_MEAN = 0,
+  FILTER_TRIMMED_MEAN = 1,
+  FILTER_MEDIAN = 2,
+  FILTER_HAMPEL = 3,
+  FILTER_COUNT = 4
+} filter_kind;
+
+/* Function: Filter_Reduce(filter_kind kind, const volatile int16_t *samples,
+ *                         uint16_t n)
+ * Parameters:
+ *      - filter_kind kind: the reduction to use
+ *      - const volatile int16_t *samples: the buffer, e.g. the DMA buffer
+ *      - uint16_t n: number of samples, at most FILTER_MAX_SAMPLES
+ * Return:
+ *      - the reduced value in Q8 (FILTER_Q_BITS)
+ * Description:
+ *      - Dispatch to one of the kernels below. The buffer is never
+ *        modified, the selection works on a static scratch copy.
+ */
+int32_t Filter_Reduce(filter_kind kind, const volatile int16_t *samples,\
+                      uint16_t n);
+
+/* Function: Filter_Mean(const volatile int16_t *samples, uint16_t n)
+ * Return:
+ *      - the plain mean in Q8
+ */
+int32_t Filter_Mean(const volatile int16_t *samples, uint16_t n);
+
+/* Function: Filter_Trimmed_Mean(const volatile int16_t *samples, uint16_t n)
+ * Return:
+ *      - the mean of the samples left after trimming n/8 at each end, Q8
+ * Description:
+ *      - Two selections split the copy into low | middle | high; only
+ *        the middle gets summed. O(n) on average, no sort.
+ */
+int32_t Filter_Trimmed_Mean(const volatile int16_t *samples, uint16_t n);
+
+/* Function: Filter_Median(const volatile int16_t *samples, uint16_t n)
+ * Return:
+ *      - the median in Q8 (average of the two middle samples for even n)
+ */
+int32_t Filter_Median(const volatile int16_t *samples, uint16_t n);
+
+/* Function: Filter_Hampel(const volatile int16_t *samples, uint16_t n)
+ * Return:
+ *      - the mean of the samples within the Hampel bound, Q8
+ * Description:
+ *      - Median and MAD over the whole buffer, then one pass that drops
+ *        every sample further than FILTER_HAMPEL_K_Q8 * MAD from the
+ *        median. The MAD is floored at one code so a quiet, quantized
+ *        buffer does not reject everything but the median.
+ */
+int32_t Filter_Hampel(const volatile int16_t *samples, uint16_t n);
+
+#endif /* SRC_ROBUST_FILTER_H_ */
@@ -0,0 +1,184 @@
+/*
+ * sensor_stats.c
+ *
+ *  Created on: Apr 14, 2017
+ *      Author: vidursarin
+ */
+
+#include "sensor_stats.h"
+
+/* Function: Stats_Div_Round(int64_t num, uint32_t den)
+ * Return:
+ *      - num / den to the nearest, halves away from zero
+ */
+static int32_t Stats_Div_Round(int64_t num, uint32_t den)
+{
+  int64_t half = den / 2;
+
+  return (int32_t)((num + ((num < 0) ? -half : half)) / (int64_t)den);
+}
+
+void Stats_Init(sensor_stats *stats, uint8_t ema_shift)
+{
+  stats->ema_shift = ema_shift;
+  stats->ema_q = 0;
+  stats->ema_valid = false;
+  Stats_Reset(stats);
+
+  return;
+}
+
+void Stats_Reset(sensor_stats *stats)
+{
+  stats->count = 0;
+  stats->min = INT32_MAX;
+  stats->max = INT32_MIN;
+  stats->mean_q = 0;
+  stats->mean_rem = 0;
+  stats->m2_q = 0;
+
+  return;
+}
+
+void Stats_Add_Sample(sensor_stats *stats, int32_t sample)
+{
+  int32_t sample_q = sample << STATS_Q_BITS;
+  int32_t delta = sample_q - stats->mean_q;
+  int32_t half;
+
+  stats->count++;
+
+  /* Round the mean update, truncation would drift towards zero */
+  half = (int32_t)(stats->count >> 1);
+  stats->mean_q += (delta + ((delta < 0) ? -half : half))\
+                   / (int32_t)stats->count;
+  stats->m2_q += (int64_t)delta * (sample_q - stats->mean_q);
+  stats->mean_rem = 0;
+
+  if(sample < stats->min) {
+    stats->min = sample;
+  }
+  if(sample > stats->max) {
+    stats->max = sample;
+  }
+
+  if(stats->ema_valid == false) {
+    stats->ema_q = sample_q;
+    stats->ema_valid = true;
+  } else {
+    stats->ema_q += (sample_q - stats->ema_q) >> stats->ema_shift;
+  }
+
+  return;
+}
+
+void Stats_Add_Block(sensor_stats *stats, const volatile int16_t *samples,\
+                     uint16_t n)
+{
+  int32_t sum = 0;
+  uint64_t sum_sq = 0;
+  int32_t min = INT32_MAX;
+  int32_t max = INT32_MIN;
+  int32_t ema_q = stats->ema_q;
+  uint16_t cnt = 0;
+
+  if(n == 0) {
+    return;
+  }
+
+  if(stats->ema_valid == false) {
+    ema_q = samples[0] << STATS_Q_BITS;
+    stats->ema_valid = true;
+  }
+
+  while(cnt != n) {
+    int32_t sample = samples[cnt++];
+
+    sum += sample;
+    sum_sq += (uint32_t)(sample * sample);
+    if(sample < min) {
+      min = sample;
+    }
+    if(sample > max) {
+      max = sample;
+    }
+    ema_q += ((sample << STATS_Q_BITS) - ema_q) >> stats->ema_shift;
+  }
+  stats->ema_q = ema_q;
+
+  if(min < stats->min) {
+    stats->min = min;
+  }
+  if(max > stats->max) {
+    stats->max = max;
+  }
+
+  /* Statistics of the block on its own */
+  int64_t block_sum_q = (int64_t)sum << STATS_Q_BITS;
+  int32_t block_mean_q = Stats_Div_Round(block_sum_q, n);
+  uint64_t block_m2_q = ((((int64_t)sum_sq * n) - ((int64_t)sum * sum))\
+                          << (2 * STATS_Q_BITS)) / n;
+
+  /* Merge it with what we had (Chan et al.). The cross term is
+   * delta^2 * count * n / total, multiplied out before the division so
+   * a mean shift of a fraction of a code still counts; count / total is
+   * taken apart into quotient and remainder to stay within 64 bits.
+   */
+  uint32_t total = stats->count + n;
+  int64_t delta = block_mean_q - stats->mean_q;
+  uint64_t cross = (uint64_t)(delta * delta) * n;
+
+  stats->m2_q += block_m2_q\
+                 + (cross / total) * stats->count\
+                 + ((cross % total) * stats->count + total / 2) / total;
+
+  /* The new mean is exact as mean_q + mean_rem / total. Merging a short
+   * block into a long window moves the mean by less than one Q8 step;
+   * without the remainder it would never follow, and every later cross
+   * term would be measured from a stale mean.
+   */
+  int64_t mean_sum_q = (int64_t)stats->mean_q * stats->count\
+                       + stats->mean_rem + block_sum_q;
+
+  stats->mean_q = Stats_Div_Round(mean_sum_q, total);
+  stats->mean_rem = (int32_t)(mean_sum_q - (int64_t)stats->mean_q * total);
+  stats->count = total;
+
+  return;
+}
+
+uint64_t Stats_Variance(const sensor_stats *stats)
+{
+  if(stats->count < 2) {
+    return 0;
+  }
+
+  return (stats->m2_q / (stats->count - 1));
+}
+
+uint32_t Stats_Std_Dev(const sensor_stats *stats)
+{
+  return Stats_Isqrt(Stats_Variance(stats));
+}
+
+uint32_t Stats_Isqrt(uint64_t value)
+{
+  uint64_t result = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while(bit > value) {
+    bit >>= 2;
+  }
+
+  while(bit != 0) {
+    if(value >= result + bit) {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+
+  return (uint32_t)result;
+}
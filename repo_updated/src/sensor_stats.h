@@ -0,0 +1,113 @@
+/*
+ * sensor_stats.h
+ *
+ *  Created on: Apr 14, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_SENSOR_STATS_H_
+#define SRC_SENSOR_STATS_H_
+
+#include<stdint.h>
+#include<stdbool.h>
+
+/* Fractional bits of the mean and the EMA (variance uses twice as many) */
+#define STATS_Q_BITS 8
+
+/* Default EMA weight: alpha = 1/2^STATS_EMA_SHIFT */
+#define STATS_EMA_SHIFT 3
+
+/* Running statistics, all integer. Samples can be raw ADC codes or
+ * milli degrees; the statistics are in the same unit as the samples.
+ */
+typedef struct sensor_statistics {
+  uint32_t count;
+  int32_t min;
+  int32_t max;
+  int32_t mean_q;     /* Welford mean, Q8 */
+  int32_t mean_rem;   /* block merges: the mean is mean_q + mean_rem / count */
+  uint64_t m2_q;      /* sum of squared deviations, Q16 */
+  int32_t ema_q;      /* exponential moving average, Q8 */
+  uint8_t ema_shift;  /* alpha = 1/2^ema_shift */
+  bool ema_valid;
+} sensor_stats;
+
+/* Compact summary sent over the link instead of a single reading.
+ * Temperatures are in centi degrees C.
+ */
+typedef struct __attribute__((packed)) sensor_stats_summary {
+  int16_t mean_cC;
+  int16_t min_cC;
+  int16_t max_cC;
+  uint16_t std_dev_cC;
+  int16_t ema_cC;
+  uint16_t count;
+} stats_summary;
+
+/* Function: Stats_Init(sensor_stats *stats, uint8_t ema_shift)
+ * Parameters:
+ *      - sensor_stats *stats: the statistics to initialize
+ *      - uint8_t ema_shift: EMA weight, alpha = 1/2^ema_shift
+ * Return:
+ *      void
+ * Description:
+ *      - Clear everything, including the EMA.
+ */
+void Stats_Init(sensor_stats *stats, uint8_t ema_shift);
+
+/* Function: Stats_Reset(sensor_stats *stats)
+ * Parameters:
+ *      - sensor_stats *stats: the statistics to reset
+ * Return:
+ *      void
+ * Description:
+ *      - Start a new window. The EMA is carried over on purpose.
+ */
+void Stats_Reset(sensor_stats *stats);
+
+/* Function: Stats_Add_Sample(sensor_stats *stats, int32_t sample)
+ * Parameters:
+ *      - sensor_stats *stats: the statistics to update
+ *      - int32_t sample: the new sample
+ * Return:
+ *      void
+ * Description:
+ *      - Per sample update (Welford).
+ */
+void Stats_Add_Sample(sensor_stats *stats, int32_t sample);
+
+/* Function: Stats_Add_Block(sensor_stats *stats,
+ *                           const volatile int16_t *samples, uint16_t n)
+ * Parameters:
+ *      - sensor_stats *stats: the statistics to update
+ *      - samples: a block of samples, e.g. a DMA buffer
+ *      - n: number of samples in the block
+ * Return:
+ *      void
+ * Description:
+ *      - Reduce the block with plain sums first and merge it in one
+ *        step, which is much cheaper than n calls to Stats_Add_Sample().
+ */
+void Stats_Add_Block(sensor_stats *stats, const volatile int16_t *samples,\
+                     uint16_t n);
+
+/* Function: Stats_Variance(const sensor_stats *stats)
+ * Return:
+ *      - the sample variance in Q16. 64 bits wide: milli degree samples
+ *        overflow 32 bits beyond a std. dev. of 256 mC.
+ */
+uint64_t Stats_Variance(const sensor_stats *stats);
+
+/* Function: Stats_Std_Dev(const sensor_stats *stats)
+ * Return:
+ *      - the sample standard deviation in Q8
+ */
+uint32_t Stats_Std_Dev(const sensor_stats *stats);
+
+/* Function: Stats_Isqrt(uint64_t value)
+ * Return:
+ *      - floor(sqrt(value)), integer only
+ */
+uint32_t Stats_Isqrt(uint64_t value);
+
+#endif /* SRC_SENSOR_STATS_H_ */
@@ -1,37 +1,70 @@
+#include <string.h>
 #include "sleep_modes.h"
 
-/*Function:blockSleepMode(SLEEP_EnergyMode_t eMode)
+sleep_stats sleep_prof;
+
+/* The one block table: the total per mode, and what each user holds */
+static uint8_t sleep_block[NUM_SLEEP_MODES] = {0};
+static uint8_t sleep_holds[SLEEP_USERS][NUM_SLEEP_MODES] = {{0}};
+
+static sleep_clock sleep_clock_get = NULL;
+static uint32_t sleep_clock_rate = 1000;
+
+/* Clock at the end of the last sleep, or at Sleep_Stats_Init() */
+static uint32_t sleep_awake_since = 0;
+
+/*Function:blockSleepMode(SLEEP_EnergyMode_t eMode, sleep_user user)
  * Paratmers:
  *    SLEEP_EnergyMode_t  eMode: The energy mode to block the MCU in.
+ *    sleep_user user: The module taking the block.
  * Return: void
- * Description: 
+ * Description:
  *    This function is used to block the MCU in a specified Energy Mode.
  *    It acts like a semaphore that prevent the MCU from going into a lower
  *    energy state.
  */
-void blockSleepMode(SLEEP_EnergyMode_t eMode)
+void blockSleepMode(SLEEP_EnergyMode_t eMode, sleep_user user)
 {
   INT_Disable();
   sleep_block[eMode]++;
+  sleep_holds[user][eMode]++;
   INT_Enable();
 }
 
-/* Function: unblockSleepMode(SLEEP_EnergyMode_t eMode)
+/* Function: unblockSleepMode(SLEEP_EnergyMode_t eMode, sleep_user user)
  * Parameters:
  *    SLEEP_EnergyMode_t  eMode: The energy mode to block the MCU in.
+ *    sleep_user user: The module that took the block.
  *  Return: void
  *  Description:
  *    This function is used to unblock the MCU from a particular Energy Mode.
  */
-void unblockSleepMode(SLEEP_EnergyMode_t eMode)
+void unblockSleepMode(SLEEP_EnergyMode_t eMode, sleep_user user)
 {
   INT_Disable();
-  if(sleep_block[eMode] > 0) {
+  if(sleep_holds[user][eMode] > 0) {
+    sleep_holds[user][eMode]--;
     sleep_block[eMode]--;
+  } else {
+    sleep_prof.unbalanced++;
   }
   INT_Enable();
 }
 
+SLEEP_EnergyMode_t Sleep_Depth(void)
+{
+  if(sleep_block[sleepEM0] > 0) {
+    return sleepEM0;
+  } else if (sleep_block[sleepEM1] > 0) {
+    return sleepEM1;
+  } else if (sleep_block[sleepEM2] > 0) {
+    return sleepEM2;
+  }
+
+  /* Don't go beyond EM3 */
+  return sleepEM3;
+}
+
 /* Function: sleep(void)
  * Parameters:
  *    void
@@ -40,20 +73,103 @@ void unblockSleepMode(SLEEP_EnergyMode_t eMode)
  * Description:
  *    The function is used to put the MCU into a particular Energy Mode.
  *    It is dependent upon what EM is blocked by the blockSleepMode function.
+ *    The mode is picked with the interrupts masked, so a block taken by
+ *    an interrupt just before the WFI still counts; the pending interrupt
+ *    wakes the core right away and runs once they are unmasked.
  */
 void sleep(void)
 {
-  if(sleep_block[sleepEM0] > 0) {
-    /* remain in EM0 */
-    return;
-  } else if (sleep_block[sleepEM1] > 0) {
+  SLEEP_EnergyMode_t mode;
+  uint32_t start = 0;
+
+  INT_Disable();
+
+  if(sleep_clock_get != NULL) {
+    start = sleep_clock_get();
+    sleep_prof.ticks[sleepEM0] += start - sleep_awake_since;
+    sleep_awake_since = start;
+  }
+
+  mode = Sleep_Depth();
+  sleep_prof.entries[mode]++;
+
+  if(mode == sleepEM1) {
     EMU_EnterEM1();
-  } else if (sleep_block[sleepEM2] > 0) {
+  } else if (mode == sleepEM2) {
     EMU_EnterEM2(true);
-  } else if (sleep_block[sleepEM3] > 0) {
-    EMU_EnterEM3(true);
-  } else {
-    /* Don't go beyond EM3 */
+  } else if (mode == sleepEM3) {
     EMU_EnterEM3(true);
   }
+  /* remain in EM0 otherwise */
+
+  if((sleep_clock_get != NULL) && (mode != sleepEM0)) {
+    sleep_awake_since = sleep_clock_get();
+    sleep_prof.ticks[mode] += sleep_awake_since - start;
+  }
+
+  INT_Enable();
+}
+
+uint32_t Sleep_Holders(SLEEP_EnergyMode_t eMode)
+{
+  uint32_t holders = 0;
+  uint32_t user = 0;
+
+  for(user = 0; user < SLEEP_USERS; user++) {
+    if(sleep_holds[user][eMode] > 0) {
+      holders |= (1 << user);
+    }
+  }
+
+  return holders;
+}
+
+void Sleep_Stats_Init(sleep_clock clock, uint32_t ticks_per_s)
+{
+  INT_Disable();
+  memset(&sleep_prof, 0, sizeof(sleep_prof));
+  sleep_clock_get = clock;
+  sleep_clock_rate = ticks_per_s;
+  if(clock != NULL) {
+    sleep_awake_since = clock();
+  }
+  INT_Enable();
+
+  return;
+}
+
+void Sleep_Stats_Set_Rate(uint32_t ticks_per_s)
+{
+  sleep_clock_rate = ticks_per_s;
+
+  return;
+}
+
+uint32_t Sleep_Residency_ms(SLEEP_EnergyMode_t eMode)
+{
+  uint64_t ticks = 0;
+
+  INT_Disable();
+  ticks = sleep_prof.ticks[eMode];
+  INT_Enable();
+
+  return Sleep_Ticks_To_ms(ticks);
+}
+
+uint32_t Sleep_Clock_Now(void)
+{
+  uint32_t now = 0;
+
+  INT_Disable();
+  if(sleep_clock_get != NULL) {
+    now = sleep_clock_get();
+  }
+  INT_Enable();
+
+  return now;
+}
+
+uint32_t Sleep_Ticks_To_ms(uint64_t ticks)
+{
+  return (ticks * 1000) / sleep_clock_rate;
 }
@@ -1,12 +1,11 @@
+#ifndef SRC_SLEEP_MODES_H_
+#define SRC_SLEEP_MODES_H_
+
 #include "em_int.h"
 #include "em_chip.h"
 #include "em_emu.h"
 #include "em_cmu.h"
 
-#define NUM_SLEEP_MODES 3
-
-static int sleep_block[NUM_SLEEP_MODES] = {0};
-
 typedef enum {
   /* Status value for EM0. */
   sleepEM0 = 0,
@@ -24,13 +23,134 @@ typedef enum {
   sleepEM4 = 4
 } SLEEP_EnergyMode_t;
 
+/* One slot per mode, EM4 included; sleep() never goes below EM3, so the
+ * EM4 statistics stay at 0.
+ */
+#define NUM_SLEEP_MODES (sleepEM4 + 1)
+
+/* Who holds a block. Each block is charged to its user, so a module that
+ * unblocks more often than it blocked cannot release someone else's.
+ */
+typedef enum sleep_user {
+  SLEEP_USER_MAIN = 0,        /* the EM3 floor set before the main loop */
+  SLEEP_USER_ADC = 1,         /* conversions and their DMA */
+  SLEEP_USER_LEUART = 2,      /* transmitting, or on the HF clock */
+  SLEEP_USER_OSC_CAL = 3,     /* the ULFRCO calibration counts */
+  SLEEP_USER_I2C = 4,         /* the light sensor reads */
+  SLEEP_USERS = 5
+} sleep_user;
+
+/* Free running clock for the residency accounting, counting up and
+ * wrapping at 32 bits. It has to keep going in EM2/EM3.
+ */
+typedef uint32_t (*sleep_clock)(void);
+
+typedef struct sleep_statistics {
+  uint64_t ticks[NUM_SLEEP_MODES];    /* time in each mode, in clock ticks */
+  uint32_t entries[NUM_SLEEP_MODES];  /* EM0: sleep() calls that stayed awake */
+  uint32_t unbalanced;                /* unblocks without a matching block */
+} sleep_stats;
+
+extern sleep_stats sleep_prof;
+
 /* Function Prototypes */
 
-void blockSleepMode(SLEEP_EnergyMode_t eMode);
+/* Function: blockSleepMode(SLEEP_EnergyMode_t eMode, sleep_user user)
+ * Parameters:
+ *      - SLEEP_EnergyMode_t eMode: the lowest mode the user can run in
+ *      - sleep_user user: the module taking the block
+ * Return:
+ *      void
+ * Description:
+ *      - Keep sleep() from going below eMode until the same user calls
+ *        unblockSleepMode(). Blocks nest. Safe from interrupts.
+ */
+void blockSleepMode(SLEEP_EnergyMode_t eMode, sleep_user user);
 
-void unblockSleepMode(SLEEP_EnergyMode_t eMode);
+/* Function: unblockSleepMode(SLEEP_EnergyMode_t eMode, sleep_user user)
+ * Parameters:
+ *      - SLEEP_EnergyMode_t eMode: as passed to blockSleepMode()
+ *      - sleep_user user: as passed to blockSleepMode()
+ * Return:
+ *      void
+ * Description:
+ *      - Release one block. One the user does not hold is ignored and
+ *        counted in sleep_prof.unbalanced.
+ */
+void unblockSleepMode(SLEEP_EnergyMode_t eMode, sleep_user user);
 
+/* Function: sleep(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *      - Enter the lowest mode nobody blocks, EM3 at most, and charge the
+ *        time asleep to it and the time since the last sleep() to EM0.
+ */
 void sleep(void);
 
+/* Function: Sleep_Depth(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - the mode sleep() would enter now
+ */
+SLEEP_EnergyMode_t Sleep_Depth(void);
+
+/* Function: Sleep_Holders(SLEEP_EnergyMode_t eMode)
+ * Parameters:
+ *      - SLEEP_EnergyMode_t eMode: the mode to look at
+ * Return:
+ *      - a bit (1 << user) for every user holding a block on eMode
+ */
+uint32_t Sleep_Holders(SLEEP_EnergyMode_t eMode);
+
+/* Function: Sleep_Stats_Init(sleep_clock clock, uint32_t ticks_per_s)
+ * Parameters:
+ *      - sleep_clock clock: the time base, NULL to count entries only
+ *      - uint32_t ticks_per_s: its rate
+ * Return:
+ *      void
+ * Description:
+ *      - Clear sleep_prof and start the residency accounting from now.
+ */
+void Sleep_Stats_Init(sleep_clock clock, uint32_t ticks_per_s);
+
+/* Function: Sleep_Stats_Set_Rate(uint32_t ticks_per_s)
+ * Parameters:
+ *      - uint32_t ticks_per_s: a new calibration of the clock
+ * Return:
+ *      void
+ * Description:
+ *      - Used by Sleep_Residency_ms() for all the time counted so far.
+ */
+void Sleep_Stats_Set_Rate(uint32_t ticks_per_s);
+
+/* Function: Sleep_Residency_ms(SLEEP_EnergyMode_t eMode)
+ * Parameters:
+ *      - SLEEP_EnergyMode_t eMode: the mode to look at
+ * Return:
+ *      - the time spent in eMode since Sleep_Stats_Init(), in ms
+ */
+uint32_t Sleep_Residency_ms(SLEEP_EnergyMode_t eMode);
+
+/* Function: Sleep_Clock_Now(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - the residency clock now, 0 before Sleep_Stats_Init()
+ * Description:
+ *      - For modules that time their own blocks. Safe from interrupts.
+ */
+uint32_t Sleep_Clock_Now(void);
 
+/* Function: Sleep_Ticks_To_ms(uint64_t ticks)
+ * Parameters:
+ *      - uint64_t ticks: a span of the residency clock
+ * Return:
+ *      - the same in ms, at the current calibration
+ */
+uint32_t Sleep_Ticks_To_ms(uint64_t ticks);
 
+#endif /* SRC_SLEEP_MODES_H_ */
@@ -0,0 +1,321 @@
+/*
+ * soft_timer.c
+ *
+ *  Created on: Apr 28, 2017
+ *      Author: vidursarin
+ */
+
+#include "em_int.h"
+#include "em_cmu.h"
+#include "em_rtc.h"
+#include "em_letimer.h"
+#include "soft_timer.h"
+
+/* The counter, seen as counting up from 0 to SOFT_TIMER_TOP */
+#ifdef SOFT_TIMER_RTC
+#define SOFT_TIMER_COUNT()      RTC_CounterGet()
+#define SOFT_TIMER_IF_WRAP      RTC_IF_OF
+#define SOFT_TIMER_IF_COMP      RTC_IF_COMP0
+#define SOFT_TIMER_IEN_COMP     RTC_IEN_COMP0
+#define SOFT_TIMER_INT_GET()    RTC_IntGet()
+#define SOFT_TIMER_INT_CLEAR(f) RTC_IntClear(f)
+#define SOFT_TIMER_INT_ON(f)    RTC_IntEnable(f)
+#define SOFT_TIMER_INT_OFF(f)   RTC_IntDisable(f)
+#define SOFT_TIMER_COMP_SET(t)  RTC_CompareSet(SOFT_TIMER_COMP, (t))
+#else
+/* LETIMER0 counts down, so tick t of a wrap is CNT == TOP - t */
+#define SOFT_TIMER_COUNT()      (SOFT_TIMER_TOP - LETIMER_CounterGet(LETIMER0))
+#define SOFT_TIMER_IF_WRAP      LETIMER_IF_UF
+#define SOFT_TIMER_IF_COMP      LETIMER_IF_COMP1
+#define SOFT_TIMER_IEN_COMP     LETIMER_IEN_COMP1
+#define SOFT_TIMER_INT_GET()    LETIMER_IntGet(LETIMER0)
+#define SOFT_TIMER_INT_CLEAR(f) LETIMER_IntClear(LETIMER0, (f))
+#define SOFT_TIMER_INT_ON(f)    LETIMER_IntEnable(LETIMER0, (f))
+#define SOFT_TIMER_INT_OFF(f)   LETIMER_IntDisable(LETIMER0, (f))
+#define SOFT_TIMER_COMP_SET(t)  LETIMER_CompareSet(LETIMER0, SOFT_TIMER_COMP,\
+                                                   SOFT_TIMER_TOP - (t))
+#endif
+
+soft_timer_stats soft_timer_prof;
+
+/* Sorted by expiry; equal deadlines run in the order they were set */
+static soft_timer *soft_timer_head = NULL;
+
+/* Wraps counted so far, the upper bits of Soft_Timer_Now64() */
+static volatile uint32_t soft_timer_frames = 0;
+
+/* Soft_Timer_Ms64() is base_ms plus the ticks since base_ticks at rate */
+static uint32_t soft_timer_rate = 1000;
+static uint64_t soft_timer_base_ticks = 0;
+static uint64_t soft_timer_base_ms = 0;
+
+static bool soft_timer_dispatching = false;
+
+static uint32_t Soft_Timer_Ms_To_Ticks(uint32_t ms)
+{
+  uint32_t ticks = ((uint64_t)ms * soft_timer_rate) / 1000;
+
+  return (ticks == 0) ? 1 : ticks;
+}
+
+static void Soft_Timer_Insert(soft_timer *timer)
+{
+  soft_timer **link = &soft_timer_head;
+
+  while((*link != NULL) && ((int32_t)((*link)->expiry - timer->expiry) <= 0)) {
+    link = &(*link)->next;
+  }
+  timer->next = *link;
+  *link = timer;
+  timer->active = true;
+
+  return;
+}
+
+static void Soft_Timer_Remove(soft_timer *timer)
+{
+  soft_timer **link = &soft_timer_head;
+
+  if(!timer->active) {
+    return;
+  }
+  while(*link != NULL) {
+    if(*link == timer) {
+      *link = timer->next;
+      break;
+    }
+    link = &(*link)->next;
+  }
+  timer->active = false;
+
+  return;
+}
+
+/* Function: Soft_Timer_Arm(void)
+ * Description:
+ *      - Point the compare at the head of the list if it falls within
+ *        the next wrap, otherwise leave it to the overflow.
+ */
+static void Soft_Timer_Arm(void)
+{
+  uint32_t now = Soft_Timer_Now();
+  uint32_t target = 0;
+
+  if((soft_timer_head == NULL) ||\
+     ((int32_t)(soft_timer_head->expiry - now)\
+      >= (int32_t)(SOFT_TIMER_FRAME_TICKS - SOFT_TIMER_MIN_TICKS))) {
+    SOFT_TIMER_INT_OFF(SOFT_TIMER_IEN_COMP);
+    return;
+  }
+
+  target = soft_timer_head->expiry;
+  if((int32_t)(target - now) < SOFT_TIMER_MIN_TICKS) {
+    target = now + SOFT_TIMER_MIN_TICKS;
+  }
+
+  SOFT_TIMER_COMP_SET(target & SOFT_TIMER_TOP);
+  SOFT_TIMER_INT_CLEAR(SOFT_TIMER_IF_COMP);
+  SOFT_TIMER_INT_ON(SOFT_TIMER_IEN_COMP);
+
+  return;
+}
+
+void Soft_Timer_Init(uint32_t ticks_per_s)
+{
+#ifdef SOFT_TIMER_RTC
+  const RTC_Init_TypeDef rtcInit = {
+    .enable   = true,                    /* Start counting when init complete. */
+    .debugRun = false,                   /* Stop counter during debug halt. */
+    .comp0Top = false                    /* Wrap at 0xFFFFFF; COMP0 is a deadline. */
+  };
+#else
+  const LETIMER_Init_TypeDef freeRunInit = {
+    .enable         = true,              /* Enable timer when init complete. */
+    .debugRun       = false,             /* Stop counter during debug halt. */
+    .rtcComp0Enable = false,             /* Do not start counting on RTC COMP0 match. */
+    .rtcComp1Enable = false,             /* Do not start counting on RTC COMP1 match. */
+    .comp0Top       = false,             /* Wrap at 0xFFFF; COMP0 is not used. */
+    .bufTop         = false,             /* Do not load COMP1 into COMP0 when REP0 reaches 0. */
+    .out0Pol        = 0,                 /* Idle value 0 for output 0. */
+    .out1Pol        = 0,                 /* Idle value 0 for output 1. */
+    .ufoa0          = letimerUFOANone,   /* No action on underflow on output 0. */
+    .ufoa1          = letimerUFOANone,   /* No action on underflow on output 1. */
+    .repMode        = letimerRepeatFree  /* Count until stopped by SW. */
+  };
+#endif
+
+  soft_timer_head = NULL;
+  soft_timer_frames = 0;
+  soft_timer_rate = ticks_per_s;
+  soft_timer_base_ticks = 0;
+  soft_timer_base_ms = 0;
+
+#ifdef SOFT_TIMER_RTC
+  CMU_ClockEnable(cmuClock_RTC, true);
+  RTC_Init(&rtcInit);
+
+  RTC_IntClear(RTC_IFC_COMP0 | RTC_IFC_COMP1 | RTC_IFC_OF);
+  RTC_IntEnable(RTC_IEN_OF);
+  NVIC_EnableIRQ(RTC_IRQn);
+#else
+  LETIMER_Init(LETIMER0, &freeRunInit);
+
+  LETIMER_IntClear(LETIMER0, LETIMER_IFC_COMP0 | LETIMER_IFC_COMP1\
+                             | LETIMER_IFC_UF);
+  LETIMER0->IEN = LETIMER_IEN_UF;
+  NVIC_EnableIRQ(LETIMER0_IRQn);
+#endif
+
+  return;
+}
+
+void Soft_Timer_Set_Rate(uint32_t ticks_per_s)
+{
+  INT_Disable();
+  soft_timer_base_ms = Soft_Timer_Ms64();
+  soft_timer_base_ticks = Soft_Timer_Now64();
+  soft_timer_rate = ticks_per_s;
+  INT_Enable();
+
+  return;
+}
+
+uint64_t Soft_Timer_Now64(void)
+{
+  uint32_t frames = 0;
+  uint32_t count = 0;
+
+  INT_Disable();
+  frames = soft_timer_frames;
+  count = SOFT_TIMER_COUNT();
+  if(SOFT_TIMER_INT_GET() & SOFT_TIMER_IF_WRAP) {
+    /* Wrapped, but not counted yet: the count may be from either side */
+    count = SOFT_TIMER_COUNT();
+    frames++;
+  }
+  INT_Enable();
+
+  return ((uint64_t)frames * SOFT_TIMER_FRAME_TICKS) + count;
+}
+
+uint64_t Soft_Timer_Ms64(void)
+{
+  uint64_t ticks = Soft_Timer_Now64() - soft_timer_base_ticks;
+
+  return soft_timer_base_ms + (ticks * 1000) / soft_timer_rate;
+}
+
+void Soft_Timer_Start(soft_timer *timer, uint32_t delay_ms,\
+                      uint32_t period_ms, soft_timer_cb callback)
+{
+  INT_Disable();
+  Soft_Timer_Remove(timer);
+  timer->callback = callback;
+  timer->period_ms = period_ms;
+  timer->expiry = Soft_Timer_Now() + Soft_Timer_Ms_To_Ticks(delay_ms);
+  Soft_Timer_Insert(timer);
+  if(!soft_timer_dispatching) {
+    Soft_Timer_Arm();
+  }
+  INT_Enable();
+
+  return;
+}
+
+void Soft_Timer_Start_Ticks(soft_timer *timer, uint32_t delay_ticks,\
+                            soft_timer_cb callback)
+{
+  INT_Disable();
+  Soft_Timer_Remove(timer);
+  timer->callback = callback;
+  timer->period_ms = 0;
+  timer->expiry = Soft_Timer_Now() + ((delay_ticks == 0) ? 1 : delay_ticks);
+  Soft_Timer_Insert(timer);
+  if(!soft_timer_dispatching) {
+    Soft_Timer_Arm();
+  }
+  INT_Enable();
+
+  return;
+}
+
+void Soft_Timer_Set_Period(soft_timer *timer, uint32_t period_ms)
+{
+  timer->period_ms = period_ms;
+
+  return;
+}
+
+void Soft_Timer_Stop(soft_timer *timer)
+{
+  INT_Disable();
+  Soft_Timer_Remove(timer);
+  if(!soft_timer_dispatching) {
+    Soft_Timer_Arm();
+  }
+  INT_Enable();
+
+  return;
+}
+
+void Soft_Timer_IRQHandler(void)
+{
+  soft_timer *timer = NULL;
+  soft_timer_cb callback = NULL;
+  uint32_t flags = 0;
+  uint32_t now = 0;
+  uint32_t expired = 0;
+
+  INT_Disable();
+  flags = SOFT_TIMER_INT_GET();
+  SOFT_TIMER_INT_CLEAR(flags);
+  if(flags & SOFT_TIMER_IF_WRAP) {
+    soft_timer_frames++;
+  }
+  soft_timer_prof.wakeups++;
+  soft_timer_dispatching = true;
+  INT_Enable();
+
+  /* Only the list is worked on with the interrupts masked; the callbacks
+   * run with them on, so the LEUART0 and DMA handlers are not held up.
+   */
+  for(;;) {
+    INT_Disable();
+    now = Soft_Timer_Now();
+    timer = soft_timer_head;
+    if((timer == NULL) || ((int32_t)(timer->expiry - now) > 0)) {
+      INT_Enable();
+      break;
+    }
+
+    soft_timer_head = timer->next;
+    timer->active = false;
+    if(timer->period_ms != 0) {
+      timer->expiry += Soft_Timer_Ms_To_Ticks(timer->period_ms);
+      if((int32_t)(timer->expiry - now) <= 0) {
+        /* Stalled past the next deadline as well; skip it */
+        timer->expiry = now + Soft_Timer_Ms_To_Ticks(timer->period_ms);
+        soft_timer_prof.late++;
+      }
+      Soft_Timer_Insert(timer);
+    }
+    callback = timer->callback;
+    INT_Enable();
+
+    expired++;
+    callback();
+  }
+
+  INT_Disable();
+  soft_timer_dispatching = false;
+
+  soft_timer_prof.expiries += expired;
+  if(expired == 0) {
+    soft_timer_prof.idle_wakeups++;
+  }
+
+  Soft_Timer_Arm();
+  INT_Enable();
+
+  return;
+}
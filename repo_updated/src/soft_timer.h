@@ -0,0 +1,188 @@
+/*
+ * soft_timer.h
+ *
+ *  Created on: Apr 28, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_SOFT_TIMER_H_
+#define SRC_SOFT_TIMER_H_
+
+#include<stdint.h>
+#include<stdbool.h>
+#include "em_device.h"
+
+/* Software timers multiplexed on one low energy counter. The counter
+ * runs free over its whole range and a compare channel is set to the
+ * earliest deadline in the list. Deadlines further out than one wrap only
+ * arm the compare once the wrap before them is reached, so the only
+ * wake-up that is not a deadline is the overflow that keeps the time
+ * base going. The wraps are counted on top of the counter for a 64 bit
+ * monotonic time.
+ */
+
+/* Define this macro to run the timers on the 24 bit RTC: one overflow
+ * every 4.6 hours on the ULFRCO, so intervals of minutes cost nothing
+ * but their own wake-up, and LETIMER0 is left off. Without it they run
+ * on LETIMER0 COMP1, with an underflow every 65 s. Both count the LFA
+ * clock, so the ULFRCO calibration applies either way.
+ */
+#define SOFT_TIMER_RTC
+
+#ifdef SOFT_TIMER_RTC
+#define SOFT_TIMER_TOP          0xFFFFFF
+#define SOFT_TIMER_COMP         0
+#else
+#define SOFT_TIMER_TOP          0xFFFF
+#define SOFT_TIMER_COMP         1
+#endif
+#define SOFT_TIMER_FRAME_TICKS  ((uint64_t)SOFT_TIMER_TOP + 1)
+
+/* A compare write takes up to 3 LF cycles to reach the counter;
+ * deadlines closer than this are served this many ticks out.
+ */
+#define SOFT_TIMER_MIN_TICKS    3
+
+typedef void (*soft_timer_cb)(void);
+
+/* Owned by the caller, linked into the list while it is running */
+typedef struct soft_timer {
+  struct soft_timer *next;
+  uint32_t expiry;            /* in ticks of Soft_Timer_Now() */
+  uint32_t period_ms;         /* 0 for a one-shot */
+  soft_timer_cb callback;
+  bool active;
+} soft_timer;
+
+typedef struct soft_timer_statistics {
+  uint32_t wakeups;           /* counter interrupts */
+  uint32_t idle_wakeups;      /* of those, the ones with nothing due */
+  uint32_t expiries;          /* callbacks run */
+  uint32_t late;              /* periodic deadlines skipped after a stall */
+} soft_timer_stats;
+
+extern soft_timer_stats soft_timer_prof;
+
+/* Function: Soft_Timer_Init(uint32_t ticks_per_s)
+ * Parameters:
+ *      - uint32_t ticks_per_s: the LETIMER0 clock rate, calibrated or not
+ * Return:
+ *      void
+ * Description:
+ *      - Set the RTC (or LETIMER0) up as a free running counter with the
+ *        overflow and compare interrupts, and start it. The LFA clock
+ *        must already be selected.
+ */
+void Soft_Timer_Init(uint32_t ticks_per_s);
+
+/* Function: Soft_Timer_Set_Rate(uint32_t ticks_per_s)
+ * Parameters:
+ *      - uint32_t ticks_per_s: a new calibration of the LETIMER0 clock
+ * Return:
+ *      void
+ * Description:
+ *      - Soft_Timer_Ms() carries on from where it was. Deadlines already
+ *        in the list keep their tick value; periodic timers pick the new
+ *        rate up when they are rearmed.
+ */
+void Soft_Timer_Set_Rate(uint32_t ticks_per_s);
+
+/* Function: Soft_Timer_Now64(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - LFA ticks since Soft_Timer_Init(); does not wrap
+ */
+uint64_t Soft_Timer_Now64(void);
+
+/* Function: Soft_Timer_Now(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - the same, wrapping at 32 bits; what the deadlines are kept in
+ */
+static inline uint32_t Soft_Timer_Now(void)
+{
+  return (uint32_t)Soft_Timer_Now64();
+}
+
+/* Function: Soft_Timer_Ms64(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - ms since Soft_Timer_Init(), going by the calibrated rate. The
+ *        time stamp for readings; monotonic across rate changes.
+ */
+uint64_t Soft_Timer_Ms64(void);
+
+/* Function: Soft_Timer_Ms(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      - the same, wrapping at 32 bits like uptime_ms
+ */
+static inline uint32_t Soft_Timer_Ms(void)
+{
+  return (uint32_t)Soft_Timer_Ms64();
+}
+
+/* Function: Soft_Timer_Start(soft_timer *timer, uint32_t delay_ms,
+ *                            uint32_t period_ms, soft_timer_cb callback)
+ * Parameters:
+ *      - soft_timer *timer: restarted if it is already running
+ *      - uint32_t delay_ms: to the first expiry, at least one tick
+ *      - uint32_t period_ms: between expiries after that, 0 for one-shot
+ *      - soft_timer_cb callback: run from the LETIMER0 interrupt
+ * Return:
+ *      void
+ * Description:
+ *      - Periodic timers are rearmed from their deadline, not from when
+ *        the callback ran, so they do not drift. Callbacks may start and
+ *        stop timers, their own included.
+ */
+void Soft_Timer_Start(soft_timer *timer, uint32_t delay_ms,\
+                      uint32_t period_ms, soft_timer_cb callback);
+
+/* Function: Soft_Timer_Start_Ticks(soft_timer *timer, uint32_t delay_ticks,
+ *                                  soft_timer_cb callback)
+ * Parameters:
+ *      - as for Soft_Timer_Start(), one-shot with the delay in ticks
+ * Return:
+ *      void
+ */
+void Soft_Timer_Start_Ticks(soft_timer *timer, uint32_t delay_ticks,\
+                            soft_timer_cb callback);
+
+/* Function: Soft_Timer_Set_Period(soft_timer *timer, uint32_t period_ms)
+ * Parameters:
+ *      - soft_timer *timer: a periodic timer
+ *      - uint32_t period_ms: the new period
+ * Return:
+ *      void
+ * Description:
+ *      - Takes effect when the timer is next rearmed.
+ */
+void Soft_Timer_Set_Period(soft_timer *timer, uint32_t period_ms);
+
+/* Function: Soft_Timer_Stop(soft_timer *timer)
+ * Parameters:
+ *      - soft_timer *timer: may be stopped already
+ * Return:
+ *      void
+ */
+void Soft_Timer_Stop(soft_timer *timer);
+
+/* Function: Soft_Timer_IRQHandler(void)
+ * Parameters:
+ *      void
+ * Return:
+ *      void
+ * Description:
+ *      - The whole of RTC_IRQHandler() (or LETIMER0_IRQHandler()) when
+ *        the timers are in use: runs the callbacks that are due, in
+ *        deadline order, and sets the compare for the next one. The
+ *        callbacks run with the interrupts enabled.
+ */
+void Soft_Timer_IRQHandler(void);
+
+#endif /* SRC_SOFT_TIMER_H_ */
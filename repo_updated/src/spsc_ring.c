@@ -0,0 +1,147 @@
+/*
+ * spsc_ring.c
+ *
+ *  Created on: Apr 21, 2017
+ *      Author: vidursarin
+ */
+
+#include <string.h>
+#include "spsc_ring.h"
+
+bool Spsc_Init(spsc_ring *ring, uint8_t *storage, uint16_t size)
+{
+  if((size == 0) || ((size & (size - 1)) != 0)) {
+    return false;
+  }
+
+  ring->storage = storage;
+  ring->mask = size - 1;
+  ring->head = 0;
+  ring->tail = 0;
+
+  return true;
+}
+
+/* Function: Spsc_Span_Of(spsc_ring *ring, uint16_t index, uint16_t len,
+ *                        spsc_span *span)
+ * Description:
+ *    - Split len bytes starting at the free running index into the part
+ *      up to the end of the storage and the part from its start.
+ */
+static void Spsc_Span_Of(spsc_ring *ring, uint16_t index, uint16_t len,\
+                         spsc_span *span)
+{
+  uint16_t offset = index & ring->mask;
+  uint16_t to_end = (ring->mask + 1) - offset;
+
+  span->data[0] = &ring->storage[offset];
+  span->data[1] = ring->storage;
+  if(len <= to_end) {
+    span->len[0] = len;
+    span->len[1] = 0;
+  } else {
+    span->len[0] = to_end;
+    span->len[1] = len - to_end;
+  }
+
+  return;
+}
+
+bool Spsc_Reserve(spsc_ring *ring, uint16_t len, spsc_span *span)
+{
+  if(len > Spsc_Free(ring)) {
+    return false;
+  }
+
+  Spsc_Span_Of(ring, ring->head, len, span);
+
+  return true;
+}
+
+void Spsc_Commit(spsc_ring *ring, uint16_t len)
+{
+  /* Publish the whole block with one index update */
+  SPSC_BARRIER();
+  ring->head = ring->head + len;
+
+  return;
+}
+
+uint16_t Spsc_Peek(spsc_ring *ring, spsc_span *span)
+{
+  uint16_t count = Spsc_Count(ring);
+
+  /* Read the data only after the index that published it */
+  SPSC_BARRIER();
+  Spsc_Span_Of(ring, ring->tail, count, span);
+
+  return count;
+}
+
+void Spsc_Consume(spsc_ring *ring, uint16_t len)
+{
+  SPSC_BARRIER();
+  ring->tail = ring->tail + len;
+
+  return;
+}
+
+void Spsc_Span_Put(const spsc_span *span, uint16_t offset, const void *data,\
+                   uint16_t len)
+{
+  const uint8_t *byte = data;
+  uint16_t first = 0;
+
+  if(offset < span->len[0]) {
+    first = span->len[0] - offset;
+    if(first > len) {
+      first = len;
+    }
+    memcpy(&span->data[0][offset], byte, first);
+    offset = 0;
+  } else {
+    offset = offset - span->len[0];
+  }
+
+  if(len > first) {
+    memcpy(&span->data[1][offset], &byte[first], len - first);
+  }
+
+  return;
+}
+
+bool Spsc_Write(spsc_ring *ring, const void *data, uint16_t len)
+{
+  spsc_span span;
+
+  if(Spsc_Reserve(ring, len, &span) == false) {
+    return false;
+  }
+
+  Spsc_Span_Put(&span, 0, data, len);
+  Spsc_Commit(ring, len);
+
+  return true;
+}
+
+uint16_t Spsc_Read(spsc_ring *ring, void *data, uint16_t len)
+{
+  uint8_t *byte = data;
+  spsc_span span;
+  uint16_t count = Spsc_Peek(ring, &span);
+
+  if(len > count) {
+    len = count;
+  }
+
+  if(len <= span.len[0]) {
+    memcpy(byte, span.data[0], len);
+  } else {
+    memcpy(byte, span.data[0], span.len[0]);
+    memcpy(&byte[span.len[0]], span.data[1], len - span.len[0]);
+  }
+
+  Spsc_Consume(ring, len);
+
+  return len;
+}
@@ -0,0 +1,207 @@
+/*
+ * spsc_ring.h
+ *
+ *  Created on: Apr 21, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_SPSC_RING_H_
+#define SRC_SPSC_RING_H_
+
+#include<stdint.h>
+#include<stdbool.h>
+
+/* Single producer/single consumer byte ring. The producer only ever
+ * writes head, the consumer only ever writes tail, so an ISR on either
+ * side can use it without masking interrupts. Both indices run free and
+ * are masked on access, which keeps full and empty apart without a
+ * wasted slot.
+ */
+typedef struct spsc_ring_buffer {
+  uint8_t *storage;
+  uint16_t mask;            /* size - 1, size is a power of two */
+  volatile uint16_t head;   /* next slot to write */
+  volatile uint16_t tail;   /* next slot to read */
+} spsc_ring;
+
+/* A region of the ring, split in two where it wraps around. len[1] is
+ * 0 when the region is contiguous.
+ */
+typedef struct spsc_ring_span {
+  uint8_t *data[2];
+  uint16_t len[2];
+} spsc_span;
+
+/* Order the data accesses against the index update that publishes them.
+ * Can be overridden for a host build, which then needs no device header.
+ */
+#ifndef SPSC_BARRIER
+#include "em_device.h"
+#define SPSC_BARRIER() __DMB()
+#endif
+
+/* Define a ring and its storage, statically allocated. size must be a
+ * power of two, at most 32768.
+ */
+#define SPSC_RING_DEFINE(name, size)\
+  typedef char name##_size_check[(((size) & ((size) - 1)) == 0) ? 1 : -1];\
+  static uint8_t name##_storage[(size)];\
+  spsc_ring name = {name##_storage, (size) - 1, 0, 0}
+
+/* Function: Spsc_Count(const spsc_ring *ring)
+ * Return:
+ *      - bytes waiting in the ring
+ */
+static inline uint16_t Spsc_Count(const spsc_ring *ring)
+{
+  return (uint16_t)(ring->head - ring->tail);
+}
+
+/* Function: Spsc_Free(const spsc_ring *ring)
+ * Return:
+ *      - bytes that can still be pushed
+ */
+static inline uint16_t Spsc_Free(const spsc_ring *ring)
+{
+  return (ring->mask + 1) - Spsc_Count(ring);
+}
+
+/* Function: Spsc_Push(spsc_ring *ring, uint8_t data)
+ * Parameters:
+ *      - spsc_ring *ring: the ring, producer side
+ *      - uint8_t data: the byte to add
+ * Return:
+ *      - false if the ring was full
+ */
+static inline bool Spsc_Push(spsc_ring *ring, uint8_t data)
+{
+  uint16_t head = ring->head;
+
+  if((uint16_t)(head - ring->tail) > ring->mask) {
+    return false;
+  }
+
+  ring->storage[head & ring->mask] = data;
+  SPSC_BARRIER();
+  ring->head = head + 1;
+
+  return true;
+}
+
+/* Function: Spsc_Pop(spsc_ring *ring, uint8_t *data)
+ * Parameters:
+ *      - spsc_ring *ring: the ring, consumer side
+ *      - uint8_t *data: filled with the oldest byte
+ * Return:
+ *      - false if the ring was empty
+ */
+static inline bool Spsc_Pop(spsc_ring *ring, uint8_t *data)
+{
+  uint16_t tail = ring->tail;
+
+  if(ring->head == tail) {
+    return false;
+  }
+
+  *data = ring->storage[tail & ring->mask];
+  SPSC_BARRIER();
+  ring->tail = tail + 1;
+
+  return true;
+}
+
+/* Function: Spsc_Reserve(spsc_ring *ring, uint16_t len, spsc_span *span)
+ * Parameters:
+ *      - spsc_ring *ring: the ring, producer side
+ *      - uint16_t len: bytes the producer wants to write
+ *      - spsc_span *span: filled with where to write them
+ * Return:
+ *      - false, and span untouched, if len bytes are not free
+ * Description:
+ *      - Hand out free space to fill in place. Nothing is visible to
+ *        the consumer until Spsc_Commit().
+ */
+bool Spsc_Reserve(spsc_ring *ring, uint16_t len, spsc_span *span);
+
+/* Function: Spsc_Commit(spsc_ring *ring, uint16_t len)
+ * Parameters:
+ *      - spsc_ring *ring: the ring, producer side
+ *      - uint16_t len: bytes written, at most what was reserved
+ * Return:
+ *      void
+ */
+void Spsc_Commit(spsc_ring *ring, uint16_t len);
+
+/* Function: Spsc_Peek(spsc_ring *ring, spsc_span *span)
+ * Parameters:
+ *      - spsc_ring *ring: the ring, consumer side
+ *      - spsc_span *span: filled with everything that can be read
+ * Return:
+ *      - the number of bytes in span
+ * Description:
+ *      - Read (or DMA) straight out of the ring; the bytes stay put
+ *        until Spsc_Consume().
+ */
+uint16_t Spsc_Peek(spsc_ring *ring, spsc_span *span);
+
+/* Function: Spsc_Consume(spsc_ring *ring, uint16_t len)
+ * Parameters:
+ *      - spsc_ring *ring: the ring, consumer side
+ *      - uint16_t len: bytes done with, at most what was peeked
+ * Return:
+ *      void
+ */
+void Spsc_Consume(spsc_ring *ring, uint16_t len);
+
+/* Function: Spsc_Span_Put(const spsc_span *span, uint16_t offset,
+ *                         const void *data, uint16_t len)
+ * Parameters:
+ *      - const spsc_span *span: a reserved span
+ *      - uint16_t offset: where in the span to write
+ *      - const void *data, uint16_t len: what to write
+ * Return:
+ *      void
+ * Description:
+ *      - Copy into a span, across the wrap if needed. For producers
+ *        that can not write in place.
+ */
+void Spsc_Span_Put(const spsc_span *span, uint16_t offset, const void *data,\
+                   uint16_t len);
+
+/* Function: Spsc_Init(spsc_ring *ring, uint8_t *storage, uint16_t size)
+ * Parameters:
+ *      - spsc_ring *ring: the ring to set up
+ *      - uint8_t *storage: its memory, size bytes
+ *      - uint16_t size: a power of two
+ * Return:
+ *      - false if size is not a power of two
+ * Description:
+ *      - Run-time alternative to SPSC_RING_DEFINE(). Not safe while
+ *        either side is using the ring.
+ */
+bool Spsc_Init(spsc_ring *ring, uint8_t *storage, uint16_t size);
+
+/* Function: Spsc_Write(spsc_ring *ring, const void *data, uint16_t len)
+ * Parameters:
+ *      - spsc_ring *ring: the ring, producer side
+ *      - const void *data: bytes to add
+ *      - uint16_t len: number of bytes
+ * Return:
+ *      - false, and nothing written, if len bytes do not fit
+ * Description:
+ *      - All or nothing, so a frame is never split by a full ring. The
+ *        consumer sees the whole block at once.
+ */
+bool Spsc_Write(spsc_ring *ring, const void *data, uint16_t len);
+
+/* Function: Spsc_Read(spsc_ring *ring, void *data, uint16_t len)
+ * Parameters:
+ *      - spsc_ring *ring: the ring, consumer side
+ *      - void *data: filled with up to len bytes
+ *      - uint16_t len: room in data
+ * Return:
+ *      - the number of bytes read
+ */
+uint16_t Spsc_Read(spsc_ring *ring, void *data, uint16_t len);
+
+#endif /* SRC_SPSC_RING_H_ */
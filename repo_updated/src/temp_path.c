@@ -0,0 +1,75 @@
+/*
+ * temp_path.c
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+#include <string.h>
+#include "temp_path.h"
+
+int32_t Temp_Path_Reduce(sensor_stats *burst, const volatile int16_t *samples,\
+                         uint16_t n, filter_kind filter)
+{
+  /* The burst statistics see every sample, the reading itself comes
+   * from the selected reduction
+   */
+  Stats_Reset(burst);
+  Stats_Add_Block(burst, samples, n);
+
+  if(filter == FILTER_MEAN) {
+    return Temp_Ovs_To_mC(burst->mean_q, STATS_Q_BITS);
+  }
+
+  return Temp_Ovs_To_mC(Filter_Reduce(filter, samples, n), FILTER_Q_BITS);
+}
+
+void Temp_Path_Replay(const int16_t *trace, uint32_t n, uint16_t burst_len,\
+                      filter_kind filter, temp_path_clock clock,\
+                      uint32_t ticks_per_s, temp_replay *result)
+{
+  sensor_stats burst;
+  uint32_t offset = 0;
+  uint32_t start = 0;
+  int32_t reading_mC = 0;
+  int32_t bin = 0;
+
+  memset(result, 0, sizeof(temp_replay));
+  Stats_Init(&result->readings, STATS_EMA_SHIFT);
+  Stats_Init(&burst, STATS_EMA_SHIFT);
+
+  if(burst_len == 0) {
+    return;
+  }
+
+  for(offset = 0; (offset + burst_len) <= n; offset += burst_len) {
+    if(clock != NULL) {
+      start = clock();
+    }
+    reading_mC = Temp_Path_Reduce(&burst, &trace[offset], burst_len, filter);
+    if(clock != NULL) {
+      result->ticks += clock() - start;
+    }
+
+    if(result->readings.count == 0) {
+      result->histogram_base_mC = reading_mC\
+                          - ((TEMP_REPLAY_BINS / 2) * TEMP_REPLAY_BIN_MC);
+    }
+    Stats_Add_Sample(&result->readings, reading_mC);
+
+    bin = (reading_mC - result->histogram_base_mC) / TEMP_REPLAY_BIN_MC;
+    if(bin < 0) {
+      bin = 0;
+    } else if(bin >= TEMP_REPLAY_BINS) {
+      bin = TEMP_REPLAY_BINS - 1;
+    }
+    result->histogram[bin]++;
+  }
+
+  if(result->ticks != 0) {
+    result->readings_per_s = ((uint64_t)result->readings.count * ticks_per_s)\
+                             / result->ticks;
+  }
+
+  return;
+}
@@ -0,0 +1,77 @@
+/*
+ * temp_path.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_TEMP_PATH_H_
+#define SRC_TEMP_PATH_H_
+
+#include<stdint.h>
+#include "temperature.h"
+#include "sensor_stats.h"
+#include "robust_filter.h"
+
+/* Distribution of replayed readings: TEMP_REPLAY_BINS bins of
+ * TEMP_REPLAY_BIN_MC, centred on the first reading. The end bins also
+ * count everything beyond them.
+ */
+#define TEMP_REPLAY_BINS 32
+#define TEMP_REPLAY_BIN_MC 100
+
+/* Cycle/tick source for the replay timing, e.g. Profile_Get_Cycles on
+ * target. May be NULL, the timing is then left at 0.
+ */
+typedef uint32_t (*temp_path_clock)(void);
+
+/* Outcome of Temp_Path_Replay() */
+typedef struct temp_path_replay_result {
+  sensor_stats readings;                /* the readings, in mC */
+  uint32_t histogram[TEMP_REPLAY_BINS];
+  int32_t histogram_base_mC;            /* lower edge of bin 0 */
+  uint32_t ticks;                       /* spent in the reductions */
+  uint32_t readings_per_s;
+} temp_replay;
+
+/* Function: Temp_Path_Reduce(sensor_stats *burst,
+ *                            const volatile int16_t *samples, uint16_t n,
+ *                            filter_kind filter)
+ * Parameters:
+ *      - sensor_stats *burst: reset and filled with the raw codes
+ *      - const volatile int16_t *samples: one burst of temperature codes
+ *      - uint16_t n: samples in the burst
+ *      - filter_kind filter: reduction for the reading
+ * Return:
+ *      - the reading in milli degrees C
+ * Description:
+ *      - Everything cb_ADC0_DMA does between the buffer and the
+ *        published reading, without touching a register.
+ */
+int32_t Temp_Path_Reduce(sensor_stats *burst, const volatile int16_t *samples,\
+                         uint16_t n, filter_kind filter);
+
+/* Function: Temp_Path_Replay(const int16_t *trace, uint32_t n,
+ *                            uint16_t burst_len, filter_kind filter,
+ *                            temp_path_clock clock, uint32_t ticks_per_s,
+ *                            temp_replay *result)
+ * Parameters:
+ *      - const int16_t *trace, uint32_t n: recorded or synthetic ADC codes
+ *      - uint16_t burst_len: samples per reading (MAX_CONVERSION on target)
+ *      - filter_kind filter: reduction under test
+ *      - temp_path_clock clock, uint32_t ticks_per_s: timing source
+ *      - temp_replay *result: filled with the outcome
+ * Return:
+ *      void
+ * Description:
+ *      - Cut the trace into bursts, run each through Temp_Path_Reduce()
+ *        and collect the readings' statistics, their distribution and
+ *        the throughput. A trailing partial burst is ignored. Needs the
+ *        calibration from Temp_Cal_Init(), so a host build can replay
+ *        with the constants of any node.
+ */
+void Temp_Path_Replay(const int16_t *trace, uint32_t n, uint16_t burst_len,\
+                      filter_kind filter, temp_path_clock clock,\
+                      uint32_t ticks_per_s, temp_replay *result);
+
+#endif /* SRC_TEMP_PATH_H_ */
@@ -0,0 +1,40 @@
+/*
+ * temperature.c
+ *
+ *  Created on: Apr 12, 2017
+ *      Author: vidursarin
+ */
+
+#include "temperature.h"
+
+/* Calibration in use. Only touched by Temp_Cal_Init() */
+static temp_cal calibration = {0};
+
+void Temp_Cal_Init(uint8_t cal_temp, uint16_t cal_code)
+{
+  calibration.cal_temp = cal_temp;
+  calibration.cal_code = cal_code;
+
+  /* T = cal_temp + (cal_code - code)/6.27, folded into one intercept */
+  calibration.intercept_q10 = ((int32_t)cal_temp * 1000 << TEMP_Q_BITS)\
+                              + ((int32_t)cal_code * TEMP_SLOPE_MC_Q10);
+
+  return;
+}
+
+int32_t Temp_Code_To_mC(int32_t code)
+{
+  int32_t temp_q10 = calibration.intercept_q10 - (code * TEMP_SLOPE_MC_Q10);
+
+  /* Round to the nearest milli degree */
+  return ((temp_q10 + (1 << (TEMP_Q_BITS - 1))) >> TEMP_Q_BITS);
+}
+
+int32_t Temp_Ovs_To_mC(int32_t code, uint8_t frac_bits)
+{
+  int64_t temp_q10 = ((int64_t)calibration.intercept_q10 << frac_bits)\
+                     - ((int64_t)code * TEMP_SLOPE_MC_Q10);
+
+  return (int32_t)((temp_q10 + ((int64_t)1 << (TEMP_Q_BITS + frac_bits - 1)))\
+                    >> (TEMP_Q_BITS + frac_bits));
+}
@@ -0,0 +1,63 @@
+/*
+ * temperature.h
+ *
+ *  Created on: Apr 12, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_TEMPERATURE_H_
+#define SRC_TEMPERATURE_H_
+
+#include<stdint.h>
+
+/* Fixed point format of the cached calibration */
+#define TEMP_Q_BITS 10
+
+/* Sensor gradient (SET_TEMP_GRADIENT, -6.27 codes/C) expressed as
+ * milli degrees per ADC code: 1000/6.27 in Q10.
+ */
+#define TEMP_SLOPE_MC_Q10 163317
+
+/* Convert milli degrees to degrees */
+#define TEMP_MC_TO_C(mC) ((float)(mC) * 0.001f)
+
+/* Calibration cached at boot, so a conversion is one multiply-add */
+typedef struct temp_calibration {
+  int32_t intercept_q10;  /* temperature at ADC code 0, mC in Q10 */
+  uint16_t cal_code;      /* factory ADC code at cal_temp */
+  uint8_t cal_temp;       /* factory calibration temperature in C */
+} temp_cal;
+
+/* Function: Temp_Cal_Init(uint8_t cal_temp, uint16_t cal_code)
+ * Parameters:
+ *      - cal_temp: factory calibration temperature in C (DEVINFO->CAL)
+ *      - cal_code: ADC code measured at cal_temp (DEVINFO->ADC0CAL2)
+ * Return:
+ *      void
+ * Description:
+ *      - Pre-compute the conversion constants. Call once at boot.
+ */
+void Temp_Cal_Init(uint8_t cal_temp, uint16_t cal_code);
+
+/* Function: Temp_Code_To_mC(int32_t code)
+ * Parameters:
+ *      - code: a 12 bit ADC code of the temperature sensor
+ * Return:
+ *      - the temperature in milli degrees C
+ * Description:
+ *      - Integer only equivalent of convertToCelsius().
+ */
+int32_t Temp_Code_To_mC(int32_t code);
+
+/* Function: Temp_Ovs_To_mC(int32_t code, uint8_t frac_bits)
+ * Parameters:
+ *      - code: an ADC code with frac_bits fractional bits
+ *      - frac_bits: number of fractional bits in code
+ * Return:
+ *      - the temperature in milli degrees C
+ * Description:
+ *      - Same as Temp_Code_To_mC() for oversampled/averaged codes.
+ */
+int32_t Temp_Ovs_To_mC(int32_t code, uint8_t frac_bits);
+
+#endif /* SRC_TEMPERATURE_H_ */
@@ -0,0 +1,104 @@
+/*
+ * typed_ring.h
+ *
+ *  Created on: Apr 24, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef SRC_TYPED_RING_H_
+#define SRC_TYPED_RING_H_
+
+#include<stdint.h>
+#include<stdbool.h>
+
+/* Order the element accesses against the index update that publishes
+ * them. Can be overridden for a host build, which then needs no device
+ * header.
+ */
+#ifndef TYPED_RING_BARRIER
+#include "em_device.h"
+#define TYPED_RING_BARRIER() __DMB()
+#endif
+
+/* TYPED_RING_DECLARE(ring_t, Prefix, elem_t, size)
+ *
+ * Declares ring_t, a ring of size elem_t (size a power of two, at most
+ * 32768), and its functions:
+ *    Prefix_Init(ring)                   - empty the ring
+ *    Prefix_Count(ring)                  - elements held
+ *    Prefix_Push(ring, &item)            - false if full
+ *    Prefix_Pop(ring, &item)             - false if empty
+ *    Prefix_Push_Overwrite(ring, &item)  - drops the oldest if full
+ *    Prefix_At(ring, index)              - index 0 is the oldest
+ *
+ * Element type and size are fixed at compile time, so every index is
+ * masked with a constant and elements are copied by assignment. Push
+ * and Pop are safe for one producer and one consumer without masking
+ * interrupts; Push_Overwrite also moves the tail, so the caller has to
+ * keep readers out while it runs.
+ */
+#define TYPED_RING_DECLARE(ring_t, Prefix, elem_t, size)\
+\
+typedef char ring_t##_size_check[(((size) & ((size) - 1)) == 0) ? 1 : -1];\
+\
+typedef struct ring_t##_struct {\
+  elem_t data[(size)];\
+  volatile uint16_t head;\
+  volatile uint16_t tail;\
+} ring_t;\
+\
+static inline void Prefix##_Init(ring_t *ring)\
+{\
+  ring->head = 0;\
+  ring->tail = 0;\
+}\
+\
+static inline uint16_t Prefix##_Count(const ring_t *ring)\
+{\
+  return (uint16_t)(ring->head - ring->tail);\
+}\
+\
+static inline bool Prefix##_Push(ring_t *ring, const elem_t *item)\
+{\
+  uint16_t head = ring->head;\
+\
+  if((uint16_t)(head - ring->tail) >= (size)) {\
+    return false;\
+  }\
+  ring->data[head & ((size) - 1)] = *item;\
+  TYPED_RING_BARRIER();\
+  ring->head = head + 1;\
+\
+  return true;\
+}\
+\
+static inline bool Prefix##_Pop(ring_t *ring, elem_t *item)\
+{\
+  uint16_t tail = ring->tail;\
+\
+  if(ring->head == tail) {\
+    return false;\
+  }\
+  *item = ring->data[tail & ((size) - 1)];\
+  TYPED_RING_BARRIER();\
+  ring->tail = tail + 1;\
+\
+  return true;\
+}\
+\
+static inline void Prefix##_Push_Overwrite(ring_t *ring, const elem_t *item)\
+{\
+  if((uint16_t)(ring->head - ring->tail) >= (size)) {\
+    ring->tail = ring->tail + 1;\
+  }\
+  ring->data[ring->head & ((size) - 1)] = *item;\
+  TYPED_RING_BARRIER();\
+  ring->head = ring->head + 1;\
+}\
+\
+static inline const elem_t *Prefix##_At(const ring_t *ring, uint16_t index)\
+{\
+  return &ring->data[(uint16_t)(ring->tail + index) & ((size) - 1)];\
+}
+
+#endif /* SRC_TYPED_RING_H_ */
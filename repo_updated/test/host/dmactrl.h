@@ -0,0 +1,17 @@
+/*
+ * dmactrl.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-in for the DMA control block of dma_ctrl.c */
+
+#ifndef HOST_DMACTRL_H_
+#define HOST_DMACTRL_H_
+
+#include "em_device.h"
+
+extern DMA_DESCRIPTOR_TypeDef dmaControlBlock[];
+
+#endif /* HOST_DMACTRL_H_ */
@@ -0,0 +1,88 @@
+/*
+ * em_adc.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-in for emlib's ADC API. ADC_IntClear() moves the next code
+ * of the replayed trace into SINGLEDATA, see host_emlib.h.
+ */
+
+#ifndef HOST_EM_ADC_H_
+#define HOST_EM_ADC_H_
+
+#include "em_device.h"
+
+typedef enum {
+  adcOvsRateSel2, adcOvsRateSel4, adcOvsRateSel8, adcOvsRateSel16,
+  adcOvsRateSel32, adcOvsRateSel64, adcOvsRateSel128, adcOvsRateSel256,
+  adcOvsRateSel512, adcOvsRateSel1024, adcOvsRateSel2048, adcOvsRateSel4096
+} ADC_OvsRateSel_TypeDef;
+
+typedef enum {
+  adcLPFilterBypass, adcLPFilterRC, adcLPFilterDeCap
+} ADC_LPFilter_TypeDef;
+
+typedef enum {
+  adcWarmupNormal, adcWarmupFastBG, adcWarmupKeepScanRefWarm,
+  adcWarmupKeepADCWarm
+} ADC_Warmup_TypeDef;
+
+typedef enum {
+  adcAcqTime1, adcAcqTime2, adcAcqTime4, adcAcqTime8, adcAcqTime16,
+  adcAcqTime32, adcAcqTime64, adcAcqTime128, adcAcqTime256
+} ADC_AcqTime_TypeDef;
+
+typedef enum {
+  adcRef1V25, adcRef2V5, adcRefVDD, adcRef5VDIFF, adcRefExtSingle,
+  adcRef2xExtDiff, adcRef2xVDD
+} ADC_Ref_TypeDef;
+
+typedef enum {
+  adcRes12Bit, adcRes8Bit, adcRes6Bit, adcResOVS
+} ADC_Res_TypeDef;
+
+typedef enum {
+  adcSingleInputCh0, adcSingleInputCh1, adcSingleInputCh2, adcSingleInputCh3,
+  adcSingleInputCh4, adcSingleInputCh5, adcSingleInputCh6, adcSingleInputCh7,
+  adcSingleInputTemp, adcSingleInputVDDDiv3, adcSingleInputVDD,
+  adcSingleInputVSS, adcSingleInputVrefDiv2
+} ADC_SingleInput_TypeDef;
+
+typedef enum {
+  adcPRSSELCh0, adcPRSSELCh1, adcPRSSELCh2, adcPRSSELCh3
+} ADC_PRSSEL_TypeDef;
+
+typedef enum {
+  adcStartSingle, adcStartScan, adcStartScanAndSingle
+} ADC_Start_TypeDef;
+
+typedef struct {
+  ADC_OvsRateSel_TypeDef ovsRateSel;
+  ADC_LPFilter_TypeDef lpfMode;
+  ADC_Warmup_TypeDef warmUpMode;
+  uint8_t timebase;
+  uint8_t prescale;
+  bool tailgate;
+} ADC_Init_TypeDef;
+
+typedef struct {
+  ADC_PRSSEL_TypeDef prsSel;
+  ADC_AcqTime_TypeDef acqTime;
+  ADC_Ref_TypeDef reference;
+  ADC_Res_TypeDef resolution;
+  ADC_SingleInput_TypeDef input;
+  bool diff;
+  bool prsEnable;
+  bool leftAdjust;
+  bool rep;
+} ADC_InitSingle_TypeDef;
+
+void ADC_Init(ADC_TypeDef *adc, const ADC_Init_TypeDef *init);
+void ADC_InitSingle(ADC_TypeDef *adc, const ADC_InitSingle_TypeDef *init);
+void ADC_Start(ADC_TypeDef *adc, ADC_Start_TypeDef cmd);
+void ADC_IntClear(ADC_TypeDef *adc, uint32_t flags);
+uint8_t ADC_TimebaseCalc(uint32_t hfperFreq);
+
+#endif /* HOST_EM_ADC_H_ */
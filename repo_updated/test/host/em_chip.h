@@ -0,0 +1,15 @@
+/*
+ * em_chip.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-in; nothing of it is used on the host */
+
+#ifndef HOST_EM_CHIP_H_
+#define HOST_EM_CHIP_H_
+
+#include "em_device.h"
+
+#endif /* HOST_EM_CHIP_H_ */
@@ -0,0 +1,23 @@
+/*
+ * em_cmu.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-in for emlib's CMU API */
+
+#ifndef HOST_EM_CMU_H_
+#define HOST_EM_CMU_H_
+
+#include "em_device.h"
+
+typedef enum {
+  cmuClock_HFPER, cmuClock_CORE, cmuClock_ADC0, cmuClock_DMA, cmuClock_PRS,
+  cmuClock_TIMER2
+} CMU_Clock_TypeDef;
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable);
+uint32_t CMU_ClockFreqGet(CMU_Clock_TypeDef clock);
+
+#endif /* HOST_EM_CMU_H_ */
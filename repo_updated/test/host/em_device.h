@@ -0,0 +1,97 @@
+/*
+ * em_device.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-in for the EFM32LG device header: only the registers and
+ * fields the modules under test touch. The peripherals are plain structs
+ * in host_emlib.c, so reads and writes just land in memory.
+ */
+
+#ifndef HOST_EM_DEVICE_H_
+#define HOST_EM_DEVICE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define __IO volatile
+
+typedef struct {
+  __IO uint32_t CTRL, CMD, STATUS, SINGLECTRL, SCANCTRL, IEN, IF, IFS, IFC;
+  __IO uint32_t SINGLEDATA, SCANDATA, SINGLEDATAP, SCANDATAP, CAL, BIASPROG;
+} ADC_TypeDef;
+
+typedef struct {
+  __IO uint32_t CTRL, CMD, STATUS, IEN, IF, IFS, IFC, TOP, TOPB, CNT, ROUTE;
+  struct {
+    __IO uint32_t CTRL, CCV, CCVP, CCVB;
+  } CC[3];
+} TIMER_TypeDef;
+
+typedef struct {
+  __IO uint32_t CAL, ADC0CAL0, ADC0CAL1, ADC0CAL2;
+} DEVINFO_TypeDef;
+
+typedef struct {
+  void * volatile SRCEND;
+  void * volatile DSTEND;
+  __IO uint32_t CTRL;
+  __IO uint32_t USER;
+} DMA_DESCRIPTOR_TypeDef;
+
+typedef struct {
+  __IO uint32_t CTRL, CYCCNT;
+} DWT_Type;
+
+typedef struct {
+  __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern ADC_TypeDef *ADC0;
+extern TIMER_TypeDef *TIMER2;
+extern DEVINFO_TypeDef *DEVINFO;
+extern DWT_Type *DWT;
+extern CoreDebug_Type *CoreDebug;
+
+#define CoreDebug_DEMCR_TRCENA_Msk (1u << 24)
+#define DWT_CTRL_CYCCNTENA_Msk 1u
+
+#define _DEVINFO_CAL_TEMP_MASK 0xFF0000u
+#define _DEVINFO_CAL_TEMP_SHIFT 16
+#define _DEVINFO_ADC0CAL2_TEMP1V25_MASK 0xFFF00000u
+#define _DEVINFO_ADC0CAL2_TEMP1V25_SHIFT 20
+
+#define ADC_IFS_SINGLE 1u
+#define ADC_IFC_SINGLE 1u
+#define ADC_IEN_SINGLE 1u
+#define ADC_CMD_SINGLESTOP 2u
+#define _ADC_CAL_SINGLEOFFSET_MASK 0x7Fu
+#define _ADC_CAL_SINGLEOFFSET_SHIFT 0
+#define _ADC_CAL_SINGLEGAIN_MASK 0x7F00u
+#define _ADC_CAL_SINGLEGAIN_SHIFT 8
+#define _ADC_SINGLECTRL_INPUTSEL_MASK 0xF00u
+#define _ADC_SINGLECTRL_INPUTSEL_SHIFT 8
+
+#define _TIMER_CTRL_RISEA_MASK 0x300u
+#define TIMER_CTRL_RISEA_RELOADSTART 0x300u
+#define TIMER_CMD_STOP 2u
+
+#define DMAREQ_ADC0_SINGLE 0x080000u
+
+#define FLASH_BASE 0u
+#define FLASH_SIZE 0x40000u
+#define FLASH_PAGE_SIZE 2048u
+
+typedef enum {
+  DMA_IRQn = 0,
+  ADC0_IRQn = 7
+} IRQn_Type;
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+
+#endif /* HOST_EM_DEVICE_H_ */
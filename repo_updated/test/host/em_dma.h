@@ -0,0 +1,93 @@
+/*
+ * em_dma.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-in for emlib's DMA API. Nothing moves by itself: the host
+ * driver fills the buffers and calls the callbacks.
+ */
+
+#ifndef HOST_EM_DMA_H_
+#define HOST_EM_DMA_H_
+
+#include "em_device.h"
+
+typedef void (*DMA_FuncPtr_TypeDef)(unsigned int channel, bool primary,\
+                                    void *user);
+
+typedef struct {
+  DMA_FuncPtr_TypeDef cbFunc;
+  void *userPtr;
+  uint8_t primary;
+} DMA_CB_TypeDef;
+
+typedef enum {
+  dmaArbitrate1, dmaArbitrate2, dmaArbitrate4
+} DMA_ArbiterConfig_TypeDef;
+
+typedef enum {
+  dmaDataInc1, dmaDataInc2, dmaDataInc4, dmaDataIncNone
+} DMA_DataInc_TypeDef;
+
+typedef enum {
+  dmaDataSize1, dmaDataSize2, dmaDataSize4
+} DMA_DataSize_TypeDef;
+
+typedef struct {
+  DMA_DataInc_TypeDef dstInc;
+  DMA_DataInc_TypeDef srcInc;
+  DMA_DataSize_TypeDef size;
+  DMA_ArbiterConfig_TypeDef arbRate;
+  uint8_t hprot;
+} DMA_CfgDescr_TypeDef;
+
+typedef struct {
+  bool highPri;
+  bool enableInt;
+  uint32_t select;
+  DMA_CB_TypeDef *cb;
+} DMA_CfgChannel_TypeDef;
+
+typedef struct {
+  void *src;
+  void *dst;
+  DMA_DataInc_TypeDef srcInc;
+  DMA_DataInc_TypeDef dstInc;
+  DMA_DataSize_TypeDef size;
+  DMA_ArbiterConfig_TypeDef arbRate;
+  uint8_t hprot;
+  uint16_t nMinus1;
+  bool peripheral;
+} DMA_CfgDescrSGAlt_TypeDef;
+
+typedef struct {
+  uint8_t hprot;
+  DMA_DESCRIPTOR_TypeDef *controlBlock;
+} DMA_Init_TypeDef;
+
+void DMA_Init(DMA_Init_TypeDef *init);
+void DMA_CfgChannel(unsigned int channel, DMA_CfgChannel_TypeDef *cfg);
+void DMA_CfgDescr(unsigned int channel, bool primary,\
+                  DMA_CfgDescr_TypeDef *cfg);
+void DMA_CfgDescrScatterGather(DMA_DESCRIPTOR_TypeDef *descr,\
+                               unsigned int indx,\
+                               DMA_CfgDescrSGAlt_TypeDef *cfg);
+void DMA_ActivateBasic(unsigned int channel, bool primary, bool useBurst,\
+                       void *dst, void *src, unsigned int nMinus1);
+void DMA_ActivatePingPong(unsigned int channel, bool useBurst,\
+                          void *primDst, void *primSrc,\
+                          unsigned int primNMinus1,\
+                          void *altDst, void *altSrc,\
+                          unsigned int altNMinus1);
+void DMA_ActivateScatterGather(unsigned int channel, bool useBurst,\
+                               DMA_DESCRIPTOR_TypeDef *altDescr,\
+                               unsigned int count);
+void DMA_RefreshPingPong(unsigned int channel, bool primary, bool useBurst,\
+                         void *dst, void *src, unsigned int nMinus1,\
+                         bool last);
+void DMA_IntClear(uint32_t flags);
+void DMA_IntEnable(uint32_t flags);
+
+#endif /* HOST_EM_DMA_H_ */
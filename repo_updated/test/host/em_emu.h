@@ -0,0 +1,19 @@
+/*
+ * em_emu.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-in: the energy modes return right away */
+
+#ifndef HOST_EM_EMU_H_
+#define HOST_EM_EMU_H_
+
+#include "em_device.h"
+
+void EMU_EnterEM1(void);
+void EMU_EnterEM2(bool restore);
+void EMU_EnterEM3(bool restore);
+
+#endif /* HOST_EM_EMU_H_ */
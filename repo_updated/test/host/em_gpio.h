@@ -0,0 +1,22 @@
+/*
+ * em_gpio.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-in for emlib's GPIO API; host_emlib.c keeps the LED state */
+
+#ifndef HOST_EM_GPIO_H_
+#define HOST_EM_GPIO_H_
+
+#include "em_device.h"
+
+typedef enum {
+  gpioPortA, gpioPortB, gpioPortC, gpioPortD, gpioPortE, gpioPortF
+} GPIO_Port_TypeDef;
+
+void GPIO_PinOutSet(GPIO_Port_TypeDef port, unsigned int pin);
+void GPIO_PinOutClear(GPIO_Port_TypeDef port, unsigned int pin);
+
+#endif /* HOST_EM_GPIO_H_ */
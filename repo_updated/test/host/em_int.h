@@ -0,0 +1,18 @@
+/*
+ * em_int.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-in: one thread, so masking interrupts only nests a count */
+
+#ifndef HOST_EM_INT_H_
+#define HOST_EM_INT_H_
+
+#include "em_device.h"
+
+uint32_t INT_Disable(void);
+uint32_t INT_Enable(void);
+
+#endif /* HOST_EM_INT_H_ */
@@ -0,0 +1,27 @@
+/*
+ * em_prs.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-in for emlib's PRS API */
+
+#ifndef HOST_EM_PRS_H_
+#define HOST_EM_PRS_H_
+
+#include "em_device.h"
+
+#define PRS_CH_CTRL_SOURCESEL_LETIMER0 0x340000u
+#define PRS_CH_CTRL_SIGSEL_LETIMER0CH0 0u
+#define PRS_CH_CTRL_SOURCESEL_TIMER2 0x1E0000u
+#define PRS_CH_CTRL_SIGSEL_TIMER2OF 1u
+
+typedef enum {
+  prsEdgeOff, prsEdgePos, prsEdgeNeg, prsEdgeBoth
+} PRS_Edge_TypeDef;
+
+void PRS_SourceSignalSet(unsigned int ch, uint32_t source, uint32_t signal,\
+                         PRS_Edge_TypeDef edge);
+
+#endif /* HOST_EM_PRS_H_ */
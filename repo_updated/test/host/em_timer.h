@@ -0,0 +1,87 @@
+/*
+ * em_timer.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-in for emlib's TIMER API */
+
+#ifndef HOST_EM_TIMER_H_
+#define HOST_EM_TIMER_H_
+
+#include "em_device.h"
+
+typedef enum {
+  timerPrescale1
+} TIMER_Prescale_TypeDef;
+
+typedef enum {
+  timerClkSelHFPerClk, timerClkSelCC1, timerClkSelCascade
+} TIMER_ClkSel_TypeDef;
+
+typedef enum {
+  timerInputActionNone, timerInputActionStart, timerInputActionStop,
+  timerInputActionReloadStart
+} TIMER_InputAction_TypeDef;
+
+typedef enum {
+  timerModeUp, timerModeDown
+} TIMER_Mode_TypeDef;
+
+typedef enum {
+  timerEventEveryEdge
+} TIMER_Event_TypeDef;
+
+typedef enum {
+  timerEdgeRising, timerEdgeFalling, timerEdgeBoth, timerEdgeNone
+} TIMER_Edge_TypeDef;
+
+typedef enum {
+  timerPRSSELCh0, timerPRSSELCh1, timerPRSSELCh2, timerPRSSELCh3
+} TIMER_PRSSEL_TypeDef;
+
+typedef enum {
+  timerOutputActionNone
+} TIMER_OutputAction_TypeDef;
+
+typedef enum {
+  timerCCModeOff, timerCCModeCapture, timerCCModeCompare, timerCCModePWM
+} TIMER_CCMode_TypeDef;
+
+typedef struct {
+  bool enable;
+  bool debugRun;
+  TIMER_Prescale_TypeDef prescale;
+  TIMER_ClkSel_TypeDef clkSel;
+  bool count2x;
+  bool ati;
+  TIMER_InputAction_TypeDef fallAction;
+  TIMER_InputAction_TypeDef riseAction;
+  TIMER_Mode_TypeDef mode;
+  bool dmaClrAct;
+  bool quadModeX4;
+  bool oneShot;
+  bool sync;
+} TIMER_Init_TypeDef;
+
+typedef struct {
+  TIMER_Event_TypeDef eventCtrl;
+  TIMER_Edge_TypeDef edge;
+  TIMER_PRSSEL_TypeDef prsSel;
+  TIMER_OutputAction_TypeDef cufoa;
+  TIMER_OutputAction_TypeDef cofoa;
+  TIMER_OutputAction_TypeDef cmoa;
+  TIMER_CCMode_TypeDef mode;
+  bool filter;
+  bool prsInput;
+  bool coist;
+  bool outInvert;
+} TIMER_InitCC_TypeDef;
+
+void TIMER_Init(TIMER_TypeDef *timer, const TIMER_Init_TypeDef *init);
+void TIMER_InitCC(TIMER_TypeDef *timer, unsigned int ch,\
+                  const TIMER_InitCC_TypeDef *init);
+void TIMER_TopSet(TIMER_TypeDef *timer, uint32_t val);
+
+#endif /* HOST_EM_TIMER_H_ */
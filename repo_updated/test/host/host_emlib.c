@@ -0,0 +1,280 @@
+/*
+ * host_emlib.c
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host stand-ins for the peripherals and the emlib calls of adc.c and the
+ * modules under it. Registers are plain memory; only the ADC single
+ * conversion and the DEVINFO page behave like the hardware.
+ */
+
+#include "host_emlib.h"
+#include "em_adc.h"
+#include "em_cmu.h"
+#include "em_dma.h"
+#include "em_emu.h"
+#include "em_gpio.h"
+#include "em_int.h"
+#include "em_msc.h"
+#include "em_prs.h"
+#include "em_timer.h"
+#include "dmactrl.h"
+
+/* HFPER and core clock of the target, for the us conversions */
+#define HOST_CORE_HZ 14000000
+
+static ADC_TypeDef host_adc0;
+static TIMER_TypeDef host_timer2;
+static DEVINFO_TypeDef host_devinfo;
+static DWT_Type host_dwt;
+static CoreDebug_Type host_core_debug;
+
+ADC_TypeDef *ADC0 = &host_adc0;
+TIMER_TypeDef *TIMER2 = &host_timer2;
+DEVINFO_TypeDef *DEVINFO = &host_devinfo;
+DWT_Type *DWT = &host_dwt;
+CoreDebug_Type *CoreDebug = &host_core_debug;
+
+DMA_DESCRIPTOR_TypeDef dmaControlBlock[32];
+
+uint32_t host_gpio_out[6];
+
+static const int16_t *adc_codes = NULL;
+static uint32_t adc_codes_n = 0;
+static uint32_t adc_codes_next = 0;
+static uint32_t int_disable_depth = 0;
+
+void Host_ADC_Feed(const int16_t *codes, uint32_t n)
+{
+  adc_codes = codes;
+  adc_codes_n = n;
+  adc_codes_next = 0;
+  ADC0->SINGLEDATA = 0;
+
+  return;
+}
+
+void Host_DEVINFO_Set(uint8_t cal_temp, uint16_t cal_code)
+{
+  DEVINFO->CAL = ((uint32_t)cal_temp << _DEVINFO_CAL_TEMP_SHIFT)\
+                 & _DEVINFO_CAL_TEMP_MASK;
+  DEVINFO->ADC0CAL2 = ((uint32_t)cal_code << _DEVINFO_ADC0CAL2_TEMP1V25_SHIFT)\
+                      & _DEVINFO_ADC0CAL2_TEMP1V25_MASK;
+
+  return;
+}
+
+void ADC_Start(ADC_TypeDef *adc, ADC_Start_TypeDef cmd)
+{
+  adc->IF |= ADC_IFS_SINGLE;
+
+  return;
+}
+
+void ADC_IntClear(ADC_TypeDef *adc, uint32_t flags)
+{
+  /* The next conversion is done by the time anyone looks */
+  if((flags & ADC_IFC_SINGLE) && (adc_codes_n != 0)) {
+    adc->SINGLEDATA = adc_codes[adc_codes_next];
+    if(adc_codes_next < (adc_codes_n - 1)) {
+      adc_codes_next++;
+    }
+  }
+
+  return;
+}
+
+void ADC_Init(ADC_TypeDef *adc, const ADC_Init_TypeDef *init)
+{
+  return;
+}
+
+void ADC_InitSingle(ADC_TypeDef *adc, const ADC_InitSingle_TypeDef *init)
+{
+  adc->SINGLECTRL = ((uint32_t)init->input << _ADC_SINGLECTRL_INPUTSEL_SHIFT)\
+                    & _ADC_SINGLECTRL_INPUTSEL_MASK;
+
+  return;
+}
+
+uint8_t ADC_TimebaseCalc(uint32_t hfperFreq)
+{
+  return (hfperFreq + 999999) / 1000000 - 1;
+}
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable)
+{
+  return;
+}
+
+uint32_t CMU_ClockFreqGet(CMU_Clock_TypeDef clock)
+{
+  return HOST_CORE_HZ;
+}
+
+void DMA_Init(DMA_Init_TypeDef *init)
+{
+  return;
+}
+
+void DMA_CfgChannel(unsigned int channel, DMA_CfgChannel_TypeDef *cfg)
+{
+  return;
+}
+
+void DMA_CfgDescr(unsigned int channel, bool primary,\
+                  DMA_CfgDescr_TypeDef *cfg)
+{
+  return;
+}
+
+void DMA_CfgDescrScatterGather(DMA_DESCRIPTOR_TypeDef *descr,\
+                               unsigned int indx,\
+                               DMA_CfgDescrSGAlt_TypeDef *cfg)
+{
+  return;
+}
+
+void DMA_ActivateBasic(unsigned int channel, bool primary, bool useBurst,\
+                       void *dst, void *src, unsigned int nMinus1)
+{
+  return;
+}
+
+void DMA_ActivatePingPong(unsigned int channel, bool useBurst,\
+                          void *primDst, void *primSrc,\
+                          unsigned int primNMinus1,\
+                          void *altDst, void *altSrc,\
+                          unsigned int altNMinus1)
+{
+  return;
+}
+
+void DMA_ActivateScatterGather(unsigned int channel, bool useBurst,\
+                               DMA_DESCRIPTOR_TypeDef *altDescr,\
+                               unsigned int count)
+{
+  return;
+}
+
+void DMA_RefreshPingPong(unsigned int channel, bool primary, bool useBurst,\
+                         void *dst, void *src, unsigned int nMinus1,\
+                         bool last)
+{
+  return;
+}
+
+void DMA_IntClear(uint32_t flags)
+{
+  return;
+}
+
+void DMA_IntEnable(uint32_t flags)
+{
+  return;
+}
+
+void EMU_EnterEM1(void)
+{
+  return;
+}
+
+void EMU_EnterEM2(bool restore)
+{
+  return;
+}
+
+void EMU_EnterEM3(bool restore)
+{
+  return;
+}
+
+void GPIO_PinOutSet(GPIO_Port_TypeDef port, unsigned int pin)
+{
+  host_gpio_out[port] |= (1u << pin);
+
+  return;
+}
+
+void GPIO_PinOutClear(GPIO_Port_TypeDef port, unsigned int pin)
+{
+  host_gpio_out[port] &= ~(1u << pin);
+
+  return;
+}
+
+uint32_t INT_Disable(void)
+{
+  return ++int_disable_depth;
+}
+
+uint32_t INT_Enable(void)
+{
+  if(int_disable_depth > 0) {
+    int_disable_depth--;
+  }
+
+  return int_disable_depth;
+}
+
+void MSC_Init(void)
+{
+  return;
+}
+
+void MSC_Deinit(void)
+{
+  return;
+}
+
+MSC_Status_TypeDef MSC_ErasePage(uint32_t *startAddress)
+{
+  return mscReturnLocked;
+}
+
+MSC_Status_TypeDef MSC_WriteWord(uint32_t *address, void const *data,\
+                                 uint32_t numBytes)
+{
+  return mscReturnLocked;
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+  return;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq)
+{
+  return;
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irq)
+{
+  return;
+}
+
+void PRS_SourceSignalSet(unsigned int ch, uint32_t source, uint32_t signal,\
+                         PRS_Edge_TypeDef edge)
+{
+  return;
+}
+
+void TIMER_Init(TIMER_TypeDef *timer, const TIMER_Init_TypeDef *init)
+{
+  return;
+}
+
+void TIMER_InitCC(TIMER_TypeDef *timer, unsigned int ch,\
+                  const TIMER_InitCC_TypeDef *init)
+{
+  return;
+}
+
+void TIMER_TopSet(TIMER_TypeDef *timer, uint32_t val)
+{
+  timer->TOP = val;
+
+  return;
+}
@@ -0,0 +1,39 @@
+/*
+ * host_emlib.h
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+#ifndef HOST_EMLIB_H_
+#define HOST_EMLIB_H_
+
+#include <stdint.h>
+#include "em_device.h"
+
+/* Function: Host_ADC_Feed(const int16_t *codes, uint32_t n)
+ * Parameters:
+ *      - codes, n: the codes the stand-in ADC0 converts next
+ * Return:
+ *      void
+ * Description:
+ *      - Each ADC_IntClear() of the single flag moves the next code into
+ *        ADC0->SINGLEDATA, the way a repeated conversion would. Past the
+ *        end the last code is repeated.
+ */
+void Host_ADC_Feed(const int16_t *codes, uint32_t n);
+
+/* Function: Host_DEVINFO_Set(uint8_t cal_temp, uint16_t cal_code)
+ * Parameters:
+ *      - cal_temp, cal_code: the factory temperature calibration
+ * Return:
+ *      void
+ * Description:
+ *      - Fill the stand-in DEVINFO page the way the factory would.
+ */
+void Host_DEVINFO_Set(uint8_t cal_temp, uint16_t cal_code);
+
+/* Set by GPIO_PinOutSet()/GPIO_PinOutClear(), one bit per pin */
+extern uint32_t host_gpio_out[6];
+
+#endif /* HOST_EMLIB_H_ */
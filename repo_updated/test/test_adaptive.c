@@ -0,0 +1,180 @@
+/*
+ * test_adaptive.c
+ *
+ *  Created on: Apr 17, 2017
+ *      Author: vidursarin
+ */
+
+/* Host driver of Adapt_Replay(): runs the adaptive controller over the
+ * traces given on the command line and reports the ADC conversions it
+ * needs against the fixed MAX_CONVERSION every CYCLE_PERIOD setup.
+ *
+ * A trace is one "temp_mC,std_dev_mC" reading per line; lines starting
+ * with '#' are comments, "# period_ms N" sets the time between readings.
+ * Every trace has to be followed within MAX_MEAN_ERR_MC on average, and
+ * within MAX_TRACK_ERR_MC plus what one ADAPT_MAX_PERIOD_MS could hide at
+ * worst: a controller resting at the longest period only sees a change
+ * at its next reading. A trace whose name starts with "quiet" has to
+ * save energy; any other one is moving, and the controller has to come
+ * down to MOVING_PERIOD_MS or shorter.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "adaptive.h"
+
+#define MAX_TRACE_LEN 100000
+
+/* Lag of the last reading behind the trace: on average, and at worst
+ * on top of the change over one ADAPT_MAX_PERIOD_MS
+ */
+#define MAX_MEAN_ERR_MC 150
+#define MAX_TRACK_ERR_MC 500
+
+/* Period a moving trace has to bring the controller down to */
+#define MOVING_PERIOD_MS 20000
+
+static int32_t trace_temp_mC[MAX_TRACE_LEN];
+static uint32_t trace_std_dev_mC[MAX_TRACE_LEN];
+
+/* Function: Load_Trace(const char *path, uint32_t *period_ms)
+ * Parameters:
+ *      - path: the trace file
+ *      - period_ms: set from the "# period_ms" line, left alone otherwise
+ * Return:
+ *      - number of readings, -1 if the file can't be read
+ */
+static int32_t Load_Trace(const char *path, uint32_t *period_ms)
+{
+  char line[128];
+  int32_t n = 0;
+  long temp = 0;
+  unsigned long std_dev = 0;
+  FILE *fp = fopen(path, "r");
+
+  if(fp == NULL) {
+    return -1;
+  }
+
+  while((fgets(line, sizeof(line), fp) != NULL) && (n < MAX_TRACE_LEN)) {
+    if(line[0] == '#') {
+      sscanf(line, "# period_ms %u", period_ms);
+      continue;
+    }
+    if(sscanf(line, "%ld,%lu", &temp, &std_dev) == 2) {
+      trace_temp_mC[n] = temp;
+      trace_std_dev_mC[n] = std_dev;
+      n++;
+    }
+  }
+
+  fclose(fp);
+
+  return n;
+}
+
+/* Function: Max_Change(int32_t n, uint32_t period_ms, uint32_t window_ms)
+ * Parameters:
+ *      - n, period_ms: the trace loaded
+ *      - window_ms: the time span to look over
+ * Return:
+ *      - the largest change of the trace within window_ms, in mC
+ */
+static uint32_t Max_Change(int32_t n, uint32_t period_ms, uint32_t window_ms)
+{
+  uint32_t span = window_ms / period_ms;
+  uint32_t change = 0;
+  uint32_t worst = 0;
+  int32_t i = 0;
+  int32_t j = 0;
+
+  for(i = 0; i < n; i++) {
+    for(j = i + 1; (j < n) && ((uint32_t)(j - i) <= span); j++) {
+      change = (trace_temp_mC[j] > trace_temp_mC[i])\
+               ? (trace_temp_mC[j] - trace_temp_mC[i])\
+               : (trace_temp_mC[i] - trace_temp_mC[j]);
+      if(change > worst) {
+        worst = change;
+      }
+    }
+  }
+
+  return worst;
+}
+
+int main(int argc, char **argv)
+{
+  adapt_replay result;
+  uint32_t period_ms = 0;
+  int32_t n = 0;
+  uint32_t max_err_mC = 0;
+  int failures = 0;
+  int i = 0;
+  const char *name = NULL;
+
+  if(argc < 2) {
+    fprintf(stderr, "usage: %s trace.csv...\n", argv[0]);
+    return 2;
+  }
+
+  printf("%-12s %8s %8s %10s %10s %8s %8s %8s %13s\n", "trace",\
+         "readings", "fixed", "conv", "fixed conv", "energy", "max err",\
+         "mean err", "period ms");
+
+  for(i = 1; i < argc; i++) {
+    period_ms = 1000;
+    n = Load_Trace(argv[i], &period_ms);
+    if(n <= 0) {
+      printf("%s: no readings\n", argv[i]);
+      failures++;
+      continue;
+    }
+
+    Adapt_Replay(trace_temp_mC, trace_std_dev_mC, n, period_ms, &result);
+
+    name = strrchr(argv[i], '/');
+    name = (name != NULL) ? (name + 1) : argv[i];
+
+    printf("%-12s %8u %8u %10llu %10llu %6u.%u%% %8u %8u %6u-%-6u\n",\
+           name, result.readings, result.fixed_readings,\
+           (unsigned long long)result.conversions,\
+           (unsigned long long)result.fixed_conversions,\
+           result.energy_permille / 10, result.energy_permille % 10,\
+           result.max_error_mC, result.mean_error_mC,\
+           result.cut_period_ms, result.max_period_ms);
+
+    if((result.readings == 0) || (result.fixed_conversions == 0)) {
+      printf("FAIL %s: empty replay\n", name);
+      failures++;
+    }
+    max_err_mC = MAX_TRACK_ERR_MC\
+                 + Max_Change(n, period_ms, ADAPT_MAX_PERIOD_MS);
+    if(result.max_error_mC > max_err_mC) {
+      printf("FAIL %s: lagged %u mC behind the trace (bound %u)\n", name,\
+             result.max_error_mC, max_err_mC);
+      failures++;
+    }
+    if(result.mean_error_mC > MAX_MEAN_ERR_MC) {
+      printf("FAIL %s: %u mC behind the trace on average\n", name,\
+             result.mean_error_mC);
+      failures++;
+    }
+    if(strncmp(name, "quiet", 5) == 0) {
+      if(result.energy_permille >= 1000) {
+        printf("FAIL %s: no saving on a quiet trace\n", name);
+        failures++;
+      }
+    } else if((result.cut_period_ms == 0) ||\
+              (result.cut_period_ms > MOVING_PERIOD_MS)) {
+      printf("FAIL %s: period never came down while it was moving\n",\
+             name);
+      failures++;
+    }
+  }
+
+  printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/*
+ * test_link.c
+ *
+ *  Created on: Apr 25, 2017
+ *      Author: vidursarin
+ */
+
+/* Host driver of Link_Fuzz(): the link_proto.c and crc.c that both the
+ * EFM32 and the SAMB11 build, fed a clean stream first and then streams
+ * with a growing share of corrupted frames. Checks that
+ *  - a clean stream comes through whole, with no error counted
+ *  - no corrupted frame is ever accepted as a good one
+ *  - every clean frame after a corruption is back within
+ *    MAX_RESYNC_BYTES of wire
+ *  - the sequence gaps the parser counts are the frames it really lost,
+ *    and it only skips bytes when something was corrupted
+ * and prints the parse throughput on the host.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "link_proto.h"
+
+#define FUZZ_FRAMES 50000
+
+/* The corrupted frame, the one after it that a broken length can eat,
+ * and the clean one after that
+ */
+#define MAX_RESYNC_BYTES (3 * LINK_FRAME_LEN(LINK_MAX_PAYLOAD))
+
+#define CHECK(cond)\
+  do {\
+    if(!(cond)) {\
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);\
+      failures++;\
+    }\
+  } while(0)
+
+static int failures = 0;
+
+static uint32_t Host_Clock_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint32_t)((ts.tv_sec * 1000000000ull) + ts.tv_nsec);
+}
+
+static void Print_Result(uint8_t faults, const link_fuzz_result *result)
+{
+  printf("%2u/16 %7u %7u %7u %6u %6u %6u %6u %6u %6u %6u %9u\n", faults,\
+         result->sent, result->received, result->clean_lost,\
+         result->false_accepts, result->count.crc_errors,\
+         result->count.hdr_errors, result->count.skipped,\
+         result->count.gaps, result->expected_gaps,\
+         result->max_resync_bytes, result->bytes_per_s);
+
+  return;
+}
+
+/* Function: Test_Clean(void)
+ * Description:
+ *      - No corruption: every frame arrives and nothing is counted.
+ */
+static void Test_Clean(void)
+{
+  link_fuzz_result result;
+
+  Link_Fuzz(FUZZ_FRAMES, 1, 0, Host_Clock_ns, 1000000000, &result);
+  Print_Result(0, &result);
+
+  CHECK(result.clean == FUZZ_FRAMES);
+  CHECK(result.received == FUZZ_FRAMES);
+  CHECK(result.clean_lost == 0);
+  CHECK(result.false_accepts == 0);
+  CHECK(result.count.crc_errors == 0);
+  CHECK(result.count.hdr_errors == 0);
+  CHECK(result.count.skipped == 0);
+  CHECK(result.count.gaps == 0);
+
+  return;
+}
+
+/* Function: Test_Faults(uint8_t faults, uint32_t seed)
+ * Parameters:
+ *      - faults: frames in sixteen to corrupt
+ *      - seed: for Link_Fuzz()
+ */
+static void Test_Faults(uint8_t faults, uint32_t seed)
+{
+  link_fuzz_result result;
+  uint32_t hurt = 0;
+
+  Link_Fuzz(FUZZ_FRAMES, seed, faults, Host_Clock_ns, 1000000000, &result);
+  Print_Result(faults, &result);
+
+  hurt = result.sent - result.clean;
+
+  CHECK(result.false_accepts == 0);
+  CHECK(result.max_resync_bytes <= MAX_RESYNC_BYTES);
+  CHECK(result.count.gaps == result.expected_gaps);
+  /* Each corruption costs at most its own frame and the one after */
+  CHECK(result.clean_lost <= hurt);
+  /* Bytes are only skipped around a corrupted frame */
+  CHECK((hurt == 0) == (result.count.skipped == 0));
+  CHECK(result.count.skipped <= hurt * MAX_RESYNC_BYTES);
+
+  return;
+}
+
+int main(void)
+{
+  printf("%5s %7s %7s %7s %6s %6s %6s %6s %6s %6s %6s %9s\n", "hurt",\
+         "sent", "recv", "c.lost", "false", "crc", "hdr", "skip", "gaps",\
+         "expect", "resync", "bytes/s");
+
+  Test_Clean();
+  Test_Faults(1, 2);
+  Test_Faults(LINK_FUZZ_FAULTS, 3);
+  Test_Faults(LINK_FUZZ_FAULTS, 4);
+  Test_Faults(12, 5);
+
+  printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+/*
+ * test_rings.c
+ *
+ *  Created on: Apr 22, 2017
+ *      Author: vidursarin
+ */
+
+/* Host driver of the ring buffers: checks the SPSC ring and a typed ring
+ * at their edges (full, empty, wrap-around, split spans), runs the SPSC
+ * ring between two threads, then prints the timings of Ring_Suite_Run().
+ * The barriers come from the command line, so no device header is used.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "spsc_ring.h"
+#include "typed_ring.h"
+#include "ring_suite.h"
+
+/* Bytes sent through the ring by the two thread test */
+#define THREAD_BYTES 4000000
+
+#define CHECK(cond)\
+  do {\
+    if(!(cond)) {\
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);\
+      failures++;\
+    }\
+  } while(0)
+
+TYPED_RING_DECLARE(test_word_ring, Test_Word, uint32_t, 8)
+
+static int failures = 0;
+
+static uint8_t small_storage[16];
+static uint8_t thread_storage[64];
+static spsc_ring thread_ring;
+
+static uint32_t Host_Clock_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint32_t)((ts.tv_sec * 1000000000ull) + ts.tv_nsec);
+}
+
+static void Test_Spsc_Edges(void)
+{
+  spsc_ring ring;
+  spsc_span span;
+  uint8_t in[16];
+  uint8_t out[16];
+  uint8_t byte = 0;
+  uint16_t i = 0;
+
+  CHECK(Spsc_Init(&ring, small_storage, 12) == false);
+  CHECK(Spsc_Init(&ring, small_storage, sizeof(small_storage)) == true);
+
+  for(i = 0; i < sizeof(in); i++) {
+    in[i] = i + 1;
+  }
+
+  /* Empty and full, with no slot lost */
+  CHECK(Spsc_Pop(&ring, &byte) == false);
+  CHECK(Spsc_Write(&ring, in, 16) == true);
+  CHECK(Spsc_Count(&ring) == 16);
+  CHECK(Spsc_Push(&ring, 0) == false);
+  CHECK(Spsc_Read(&ring, out, 16) == 16);
+  CHECK(memcmp(in, out, 16) == 0);
+
+  /* Move the indices so the next region wraps */
+  CHECK(Spsc_Write(&ring, in, 10) == true);
+  CHECK(Spsc_Read(&ring, out, 10) == 10);
+
+  CHECK(Spsc_Reserve(&ring, 17, &span) == false);
+  CHECK(Spsc_Reserve(&ring, 12, &span) == true);
+  CHECK((span.len[0] == 6) && (span.len[1] == 6));
+  Spsc_Span_Put(&span, 0, in, 12);
+  Spsc_Commit(&ring, 12);
+
+  CHECK(Spsc_Peek(&ring, &span) == 12);
+  CHECK((span.len[0] == 6) && (span.len[1] == 6));
+  CHECK((span.data[0][0] == 1) && (span.data[1][5] == 12));
+  Spsc_Consume(&ring, 4);
+  CHECK(Spsc_Count(&ring) == 8);
+  CHECK(Spsc_Read(&ring, out, 16) == 8);
+  CHECK((out[0] == 5) && (out[7] == 12));
+
+  /* Free running indices across the 16 bit wrap */
+  ring.head = 0xFFFE;
+  ring.tail = 0xFFFE;
+  CHECK(Spsc_Write(&ring, in, 5) == true);
+  CHECK(Spsc_Count(&ring) == 5);
+  CHECK(Spsc_Read(&ring, out, 5) == 5);
+  CHECK(memcmp(in, out, 5) == 0);
+
+  return;
+}
+
+static void Test_Typed_Edges(void)
+{
+  test_word_ring ring;
+  uint32_t item = 0;
+  uint32_t i = 0;
+
+  Test_Word_Init(&ring);
+  CHECK(Test_Word_Pop(&ring, &item) == false);
+
+  for(i = 0; i < 8; i++) {
+    CHECK(Test_Word_Push(&ring, &i) == true);
+  }
+  CHECK(Test_Word_Push(&ring, &i) == false);
+  CHECK(Test_Word_Count(&ring) == 8);
+
+  /* Overwrite drops the oldest */
+  i = 100;
+  Test_Word_Push_Overwrite(&ring, &i);
+  CHECK(Test_Word_Count(&ring) == 8);
+  CHECK(*Test_Word_At(&ring, 0) == 1);
+  CHECK(*Test_Word_At(&ring, 7) == 100);
+
+  for(i = 1; i < 8; i++) {
+    CHECK((Test_Word_Pop(&ring, &item) == true) && (item == i));
+  }
+  CHECK((Test_Word_Pop(&ring, &item) == true) && (item == 100));
+  CHECK(Test_Word_Pop(&ring, &item) == false);
+
+  return;
+}
+
+static void *Producer(void *arg)
+{
+  uint32_t sent = 0;
+
+  while(sent < THREAD_BYTES) {
+    if(Spsc_Push(&thread_ring, (uint8_t)(sent * 7))) {
+      sent++;
+    } else {
+      sched_yield();
+    }
+  }
+
+  return NULL;
+}
+
+/* One thread per side, no lock: every byte has to arrive, in order. A
+ * side that finds the ring full or empty yields, for single core hosts.
+ */
+static void Test_Spsc_Threads(void)
+{
+  pthread_t producer;
+  uint32_t received = 0;
+  uint32_t wrong = 0;
+  uint8_t byte = 0;
+
+  CHECK(Spsc_Init(&thread_ring, thread_storage, sizeof(thread_storage)));
+  CHECK(pthread_create(&producer, NULL, Producer, NULL) == 0);
+
+  while(received < THREAD_BYTES) {
+    if(Spsc_Pop(&thread_ring, &byte)) {
+      if(byte != (uint8_t)(received * 7)) {
+        wrong++;
+      }
+      received++;
+    } else {
+      sched_yield();
+    }
+  }
+
+  pthread_join(producer, NULL);
+
+  printf("two threads: %u bytes, %u out of order\n", received, wrong);
+  CHECK(wrong == 0);
+  CHECK(Spsc_Count(&thread_ring) == 0);
+
+  return;
+}
+
+int main(void)
+{
+  static ring_suite_result
+    results[RING_IMPLS][RING_SUITE_SIZES][RING_SUITE_FILLS];
+  static const char *impl_names[RING_IMPLS] = {"c_buf", "spsc", "typed"};
+  static const uint8_t sizes[RING_SUITE_SIZES] = RING_SUITE_SIZE_LIST;
+  static const uint8_t fills[RING_SUITE_FILLS] = RING_SUITE_FILL_LIST;
+  uint32_t impl = 0;
+  uint32_t size = 0;
+  uint32_t fill = 0;
+
+  Test_Spsc_Edges();
+  Test_Typed_Edges();
+  Test_Spsc_Threads();
+
+  Ring_Suite_Run(Host_Clock_ns, 1000000000, results);
+
+  printf("%-6s %5s %5s %9s %9s %12s\n", "ring", "bytes", "fill",\
+         "avg ns", "max ns", "ops/s");
+  for(impl = 0; impl < RING_IMPLS; impl++) {
+    for(size = 0; size < RING_SUITE_SIZES; size++) {
+      for(fill = 0; fill < RING_SUITE_FILLS; fill++) {
+        printf("%-6s %5u %4u%% %9u %9u %12u\n", impl_names[impl],\
+               sizes[size], fills[fill],\
+               results[impl][size][fill].avg_ticks,\
+               results[impl][size][fill].max_ticks,\
+               results[impl][size][fill].ops_per_s);
+      }
+    }
+  }
+
+  printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/*
+ * test_stats.c
+ *
+ *  Created on: Apr 14, 2017
+ *      Author: vidursarin
+ */
+
+/* Host test of the block merge in sensor_stats.c: bursts of ADC codes
+ * merged with Stats_Add_Block() into thousands of samples, against a two
+ * pass variance in double. The bursts either creep by a fraction of a
+ * code each, or step by a fraction of a code half way through. The
+ * shift only shows up in the Chan cross term, so these are the cases
+ * that term has to get right.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "sensor_stats.h"
+
+#define BURST   50
+#define BURSTS  200
+#define SAMPLES (BURST * BURSTS)
+
+/* Merged variance against the reference, in percent */
+#define MAX_VAR_ERR_PCT 1.0
+
+static int16_t codes[SAMPLES];
+
+/* Function: Check_Merge(const char *name)
+ * Parameters:
+ *      - name: what was loaded into codes[]
+ * Return:
+ *      - number of failures
+ */
+static int Check_Merge(const char *name)
+{
+  sensor_stats stats;
+  double mean = 0;
+  double m2 = 0;
+  double ref = 0;
+  double var = 0;
+  double err_pct = 0;
+  uint32_t i = 0;
+  uint32_t burst = 0;
+
+  for(i = 0; i < SAMPLES; i++) {
+    mean += codes[i];
+  }
+  mean /= SAMPLES;
+  for(i = 0; i < SAMPLES; i++) {
+    m2 += (codes[i] - mean) * (codes[i] - mean);
+  }
+  ref = m2 / (SAMPLES - 1);
+
+  Stats_Init(&stats, STATS_EMA_SHIFT);
+  for(burst = 0; burst < BURSTS; burst++) {
+    Stats_Add_Block(&stats, &codes[burst * BURST], BURST);
+  }
+
+  var = (double)Stats_Variance(&stats) / (1 << (2 * STATS_Q_BITS));
+  err_pct = 100.0 * (var - ref) / ref;
+
+  printf("%-36s variance %9.4f, reference %9.4f (%+.3f%%)\n", name, var,\
+         ref, err_pct);
+
+  if((err_pct > MAX_VAR_ERR_PCT) || (err_pct < -MAX_VAR_ERR_PCT)) {
+    printf("FAIL merged variance off by more than %.1f%%\n",\
+           MAX_VAR_ERR_PCT);
+    return 1;
+  }
+
+  return 0;
+}
+
+/* Function: Run_Drift(int32_t drift_milli_codes, uint32_t noise_codes)
+ * Parameters:
+ *      - drift_milli_codes: mean shift per burst, in 1/1000 code
+ *      - noise_codes: peak to peak of the noise on top
+ * Return:
+ *      - number of failures
+ */
+static int Run_Drift(int32_t drift_milli_codes, uint32_t noise_codes)
+{
+  char name[64];
+  uint32_t i = 0;
+
+  srand(drift_milli_codes * 31 + noise_codes);
+  for(i = 0; i < SAMPLES; i++) {
+    codes[i] = 2300 + (int32_t)(((int64_t)drift_milli_codes * (i / BURST))\
+                                / 1000)\
+               + ((noise_codes != 0) ? (rand() % (noise_codes + 1)) : 0);
+  }
+
+  snprintf(name, sizeof(name), "drift %5.3f codes/burst, noise %u:",\
+           drift_milli_codes / 1000.0, noise_codes);
+
+  return Check_Merge(name);
+}
+
+/* Function: Run_Step(uint32_t before_pct, uint32_t after_pct)
+ * Parameters:
+ *      - before_pct, after_pct: share of the bursts' samples one code up,
+ *        in the first and the second half
+ * Return:
+ *      - number of failures
+ */
+static int Run_Step(uint32_t before_pct, uint32_t after_pct)
+{
+  char name[64];
+  uint32_t pct = 0;
+  uint32_t i = 0;
+
+  for(i = 0; i < SAMPLES; i++) {
+    pct = (i < (SAMPLES / 2)) ? before_pct : after_pct;
+    codes[i] = 2300 + ((((i % BURST) * 100) < (pct * BURST)) ? 1 : 0);
+  }
+
+  snprintf(name, sizeof(name), "step %u%% to %u%% of a code:", before_pct,\
+           after_pct);
+
+  return Check_Merge(name);
+}
+
+int main(void)
+{
+  int failures = 0;
+
+  failures += Run_Drift(100, 0);
+  failures += Run_Drift(300, 2);
+  failures += Run_Drift(50, 4);
+  failures += Run_Drift(1000, 8);
+  failures += Run_Step(50, 70);
+  failures += Run_Step(10, 30);
+
+  printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+/*
+ * test_temp_path.c
+ *
+ *  Created on: Apr 20, 2017
+ *      Author: vidursarin
+ */
+
+/* Host driver of the ADC0 temperature path. adc.c is built unchanged
+ * against the stand-in ADC0/DMA/DEVINFO registers in host/, and every
+ * sample file given on the command line is pushed through:
+ *  - cb_ADC0_DMA(), one MAX_CONVERSION burst at a time, with each filter;
+ *    its readings must match Temp_Path_Replay() over the same codes
+ *  - Get_Avg_Temperature(), whose fixed point reading must match
+ *    convertToCelsius() of the same average
+ * It reports readings per second on the host and the distribution of
+ * the readings.
+ *
+ * A sample file is one ADC code per line; lines starting with '#' are
+ * comments, "# cal_temp N" and "# cal_code N" set the DEVINFO page.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "host_emlib.h"
+#include "adc.h"
+#include "sleep_modes.h"
+#include "temp_path.h"
+
+#define MAX_CODES 200000
+
+/* Passes over a file when timing cb_ADC0_DMA() */
+#define TIMING_PASSES 20
+
+/* convertToCelsius() against the fixed point reading, in mC */
+#define MAX_FLOAT_ERR_MC 2
+
+#define HISTOGRAM_WIDTH 50
+
+/* Set by the polled path; lives in main.c on target */
+float temp_sense_output;
+
+static int16_t codes[MAX_CODES];
+
+static const char *filter_names[FILTER_COUNT] = {
+  "mean", "trimmed", "median", "hampel"
+};
+
+static uint32_t Host_Clock_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint32_t)((ts.tv_sec * 1000000000ull) + ts.tv_nsec);
+}
+
+/* Function: Load_Codes(const char *path, uint8_t *cal_temp,
+ *                      uint16_t *cal_code)
+ * Parameters:
+ *      - path: the sample file
+ *      - cal_temp, cal_code: set from the file, left alone otherwise
+ * Return:
+ *      - number of codes, -1 if the file can't be read
+ */
+static int32_t Load_Codes(const char *path, uint8_t *cal_temp,\
+                          uint16_t *cal_code)
+{
+  char line[128];
+  int32_t n = 0;
+  unsigned int value = 0;
+  int code = 0;
+  FILE *fp = fopen(path, "r");
+
+  if(fp == NULL) {
+    return -1;
+  }
+
+  while((fgets(line, sizeof(line), fp) != NULL) && (n < MAX_CODES)) {
+    if(line[0] == '#') {
+      if(sscanf(line, "# cal_temp %u", &value) == 1) {
+        *cal_temp = value;
+      } else if(sscanf(line, "# cal_code %u", &value) == 1) {
+        *cal_code = value;
+      }
+      continue;
+    }
+    if(sscanf(line, "%d", &code) == 1) {
+      codes[n++] = code;
+    }
+  }
+
+  fclose(fp);
+
+  return n;
+}
+
+/* Function: Run_DMA_Path(uint32_t n, filter_kind filter,
+ *                        sensor_stats *readings)
+ * Parameters:
+ *      - n: codes loaded
+ *      - filter: reduction for cb_ADC0_DMA()
+ *      - readings: reset and filled with the readings, in mC
+ * Return:
+ *      - number of failures
+ * Description:
+ *      - Hand every whole burst to cb_ADC0_DMA() as the DMA would, with
+ *        EM1 blocked like ADC0_Start_DMA() does, and check it lets go.
+ */
+static int Run_DMA_Path(uint32_t n, filter_kind filter, sensor_stats *readings)
+{
+  uint32_t offset = 0;
+  uint32_t i = 0;
+  int failures = 0;
+
+  adc0_filter = filter;
+  Stats_Init(readings, STATS_EMA_SHIFT);
+
+  for(offset = 0; (offset + MAX_CONVERSION) <= n; offset += MAX_CONVERSION) {
+    for(i = 0; i < MAX_CONVERSION; i++) {
+      ADC0_DMArambuffer[i] = codes[offset + i];
+    }
+
+    blockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+    cb_ADC0_DMA(ADC0_DMA_Channel, true, NULL);
+    if(Sleep_Holders(ADC_SLEEP_MODE) != 0) {
+      printf("FAIL cb_ADC0_DMA kept EM1 blocked\n");
+      unblockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+      failures++;
+    }
+
+    Stats_Add_Sample(readings, adc0_last_reading_mC);
+  }
+
+  return failures;
+}
+
+/* Function: Run_Polled_Path(uint32_t n)
+ * Parameters:
+ *      - n: codes loaded
+ * Return:
+ *      - number of failures
+ * Description:
+ *      - Convert every whole burst through Get_Avg_Temperature() and
+ *        check its reading against convertToCelsius().
+ */
+static int Run_Polled_Path(uint32_t n)
+{
+  uint32_t offset = 0;
+  int32_t float_mC = 0;
+  int32_t err = 0;
+  int32_t worst = 0;
+  int failures = 0;
+
+  adc0_conversions = MAX_CONVERSION;
+
+  for(offset = 0; (offset + MAX_CONVERSION) <= n; offset += MAX_CONVERSION) {
+    Host_ADC_Feed(&codes[offset], MAX_CONVERSION);
+    blockSleepMode(ADC_SLEEP_MODE, SLEEP_USER_ADC);
+    Get_Avg_Temperature();
+
+    float_mC = (int32_t)(convertToCelsius(conversion_val) * 1000.0f\
+                         + ((conversion_val < 0) ? -0.5f : 0.5f));
+    err = float_mC - adc0_last_reading_mC;
+    if(err < 0) {
+      err = -err;
+    }
+    if(err > worst) {
+      worst = err;
+    }
+  }
+
+  printf("  polled:  worst |convertToCelsius - fixed| %d mC (bound %d)\n",\
+         worst, MAX_FLOAT_ERR_MC);
+  if(worst > MAX_FLOAT_ERR_MC) {
+    printf("FAIL Get_Avg_Temperature disagrees with convertToCelsius\n");
+    failures++;
+  }
+
+  return failures;
+}
+
+static void Print_Histogram(const temp_replay *replay)
+{
+  uint32_t peak = 0;
+  uint32_t bar = 0;
+  int32_t bin = 0;
+  int32_t first = -1;
+  int32_t last = 0;
+
+  for(bin = 0; bin < TEMP_REPLAY_BINS; bin++) {
+    if(replay->histogram[bin] != 0) {
+      if(first < 0) {
+        first = bin;
+      }
+      last = bin;
+    }
+    if(replay->histogram[bin] > peak) {
+      peak = replay->histogram[bin];
+    }
+  }
+
+  for(bin = first; (first >= 0) && (bin <= last); bin++) {
+    /* The end bins also hold everything beyond them */
+    bar = (replay->histogram[bin] * HISTOGRAM_WIDTH + peak - 1) / peak;
+    printf("  %c%7.1f C %5u |%.*s\n",\
+           (bin == 0) ? '<' : ((bin == (TEMP_REPLAY_BINS - 1)) ? '>' : ' '),\
+           (replay->histogram_base_mC + bin * TEMP_REPLAY_BIN_MC) / 1000.0,\
+           replay->histogram[bin], (int)bar,\
+           "##################################################");
+  }
+
+  return;
+}
+
+static int Run_File(const char *path)
+{
+  uint8_t cal_temp = 25;
+  uint16_t cal_code = 2300;
+  sensor_stats readings;
+  temp_replay replay;
+  filter_kind filter = FILTER_MEAN;
+  uint32_t start = 0;
+  uint64_t elapsed_ns = 0;
+  int32_t n = Load_Codes(path, &cal_temp, &cal_code);
+  int failures = 0;
+  int pass = 0;
+
+  if(n < MAX_CONVERSION) {
+    printf("FAIL %s: not one burst of %d codes\n", path, MAX_CONVERSION);
+    return 1;
+  }
+
+  printf("%s: %d codes, cal %u C at code %u\n", path, n, cal_temp, cal_code);
+
+  Host_DEVINFO_Set(cal_temp, cal_code);
+  ADC0_Init();
+  ADC0_Stats_Init();
+
+  printf("  %-8s %8s %9s %9s %11s\n", "filter", "readings", "mean C",\
+         "std mC", "readings/s");
+
+  for(filter = FILTER_MEAN; filter < FILTER_COUNT; filter++) {
+    start = Host_Clock_ns();
+    for(pass = 0; pass < TIMING_PASSES; pass++) {
+      failures += Run_DMA_Path(n, filter, &readings);
+    }
+    elapsed_ns = (uint32_t)(Host_Clock_ns() - start);
+
+    printf("  %-8s %8u %9.3f %9u %11.0f\n", filter_names[filter],\
+           readings.count, (readings.mean_q >> STATS_Q_BITS) / 1000.0,\
+           Stats_Std_Dev(&readings) >> STATS_Q_BITS,\
+           (elapsed_ns != 0) ?\
+             (readings.count * TIMING_PASSES * 1e9) / elapsed_ns : 0.0);
+
+    /* The callback is the replay path plus the register work */
+    Temp_Path_Replay(codes, n, MAX_CONVERSION, filter, Host_Clock_ns,\
+                     1000000000, &replay);
+    if((replay.readings.count != readings.count) ||\
+       (replay.readings.mean_q != readings.mean_q) ||\
+       (replay.readings.min != readings.min) ||\
+       (replay.readings.max != readings.max)) {
+      printf("FAIL %s: cb_ADC0_DMA and Temp_Path_Replay differ\n",\
+             filter_names[filter]);
+      failures++;
+    }
+
+    if(filter == ADC0_FILTER) {
+      printf("  replay (%s): %u readings/s\n", filter_names[filter],\
+             replay.readings_per_s);
+      Print_Histogram(&replay);
+    }
+  }
+
+  failures += Run_Polled_Path(n);
+
+  return failures;
+}
+
+int main(int argc, char **argv)
+{
+  int failures = 0;
+  int i = 0;
+
+  if(argc < 2) {
+    fprintf(stderr, "usage: %s samples.codes...\n", argv[0]);
+    return 2;
+  }
+
+  Sleep_Stats_Init(NULL, 1000);
+
+  for(i = 1; i < argc; i++) {
+    failures += Run_File(argv[i]);
+  }
+
+  printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+/*
+ * test_temperature.c
+ *
+ *  Created on: Apr 12, 2017
+ *      Author: vidursarin
+ */
+
+/* Host test of the fixed point conversion in temperature.c: every 12 bit
+ * code, for a spread of factory calibrations, against the float math of
+ * convertToCelsius(). Also times both paths on the host; the host has an
+ * FPU, so the M3 figures come from ADC0_Conv_Benchmark() (ADC_BENCHMARK).
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "temperature.h"
+
+/* SET_TEMP_GRADIENT in adc.h */
+#define REF_TEMP_GRADIENT (-6.27)
+
+/* Worst difference allowed against the float reference, in mC. The Q10
+ * slope is 0.4/1024 mC per code short, which adds up to about 1 mC at the
+ * far end of the range, plus 0.5 mC of rounding.
+ */
+#define MAX_ERR_MC 2
+
+#define CODES (1 << 12)
+
+/* convertToCelsius() with the DEVINFO fields passed in */
+static float Ref_To_Celsius(uint8_t cal_temp, uint16_t cal_code,\
+                            int32_t adcSample)
+{
+  float cal_temp_0 = (float)cal_temp;
+  float cal_value_0 = (float)cal_code;
+  float gradient = REF_TEMP_GRADIENT;
+
+  return (cal_temp_0 - ((cal_value_0 - adcSample)/gradient));
+}
+
+static double Now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+int main(void)
+{
+  static const uint8_t cal_temps[] = {0, 20, 25, 30, 85, 255};
+  static const uint16_t cal_codes[] = {0, 1500, 1900, 2300, 2700, 4095};
+  volatile int32_t fixed_mC = 0;
+  volatile float float_C = 0;
+  int32_t err = 0;
+  int32_t max_err = 0;
+  int32_t code = 0;
+  uint32_t i = 0;
+  uint32_t j = 0;
+  uint32_t rep = 0;
+  double start = 0;
+  double fixed_ns = 0;
+  double float_ns = 0;
+  int failed = 0;
+
+  for(i = 0; i < sizeof(cal_temps); i++) {
+    for(j = 0; j < sizeof(cal_codes) / sizeof(cal_codes[0]); j++) {
+      Temp_Cal_Init(cal_temps[i], cal_codes[j]);
+
+      for(code = 0; code < CODES; code++) {
+        err = Temp_Code_To_mC(code)\
+              - (int32_t)lround(Ref_To_Celsius(cal_temps[i], cal_codes[j],\
+                                               code) * 1000.0);
+        if(err < 0) {
+          err = -err;
+        }
+        if(err > max_err) {
+          max_err = err;
+        }
+        if(err > MAX_ERR_MC) {
+          printf("FAIL cal %u C / %u code %d: off by %d mC\n",\
+                 cal_temps[i], cal_codes[j], code, err);
+          failed = 1;
+        }
+
+        /* The oversampled path with no fractional bits is the same */
+        if(Temp_Ovs_To_mC(code << 4, 4) != Temp_Code_To_mC(code)) {
+          printf("FAIL Temp_Ovs_To_mC code %d\n", code);
+          failed = 1;
+        }
+      }
+    }
+  }
+
+  /* Time both over the whole range, with a typical calibration */
+  Temp_Cal_Init(25, 1900);
+  start = Now_ns();
+  for(rep = 0; rep < 1000; rep++) {
+    for(code = 0; code < CODES; code++) {
+      fixed_mC = Temp_Code_To_mC(code);
+    }
+  }
+  fixed_ns = (Now_ns() - start) / (1000.0 * CODES);
+
+  start = Now_ns();
+  for(rep = 0; rep < 1000; rep++) {
+    for(code = 0; code < CODES; code++) {
+      float_C = Ref_To_Celsius(25, 1900, code);
+    }
+  }
+  float_ns = (Now_ns() - start) / (1000.0 * CODES);
+
+  printf("max error %d mC (bound %d), host ns/conversion fixed %.2f float %.2f\n",\
+         max_err, MAX_ERR_MC, fixed_ns, float_ns);
+  printf("%s\n", failed ? "FAIL" : "PASS");
+  (void)fixed_mC;
+  (void)float_C;
+
+  return failed;
+}